@@ -0,0 +1,1061 @@
+// Compile: g++ -O2 -std=c++17 -pthread benchmark.cpp -o benchmark.exe -I SFML/SFML-3.0.2/include -L SFML/SFML-3.0.2/lib -lsfml-graphics -lsfml-window -lsfml-system
+// Rendering numbers are meant for a software renderer (e.g. LIBGL_ALWAYS_SOFTWARE=1 with Mesa).
+
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "canvas_scene.h"
+#include "desktop_backend.h"
+#include "icon_assignment.h"
+#include "icon_atlas.h"
+#include "icon_grid.h"
+#include "icon_physics.h"
+#include "icon_preview.h"
+#include "layout.h"
+#include "shape_recognition.h"
+#include "software_raster.h"
+#include "stipple.h"
+#include "stroke_batch.h"
+#include "stroke_bvh.h"
+#include "stroke_history.h"
+#include "stroke_tessellator.h"
+#include "text_outline.h"
+#include "tile_cache.h"
+
+using namespace std;
+
+using Clock = chrono::steady_clock;
+
+double millisecondsSince(Clock::time_point start) {
+    return chrono::duration<double, milli>(Clock::now() - start).count();
+}
+
+// Waits for the GPU to finish drawing into target by reading it back, so the
+// time taken includes the drawing and not just queueing it
+void finishDrawing(const sf::RenderTexture& target) {
+    sf::Image pixels = target.getTexture().copyToImage();
+    (void)pixels;
+}
+
+// Random-walk strokes scattered over a canvas, like a large hand-drawn scene
+vector<StrokePtr> makeSyntheticStrokes(StrokeHistory& history, size_t strokeCount, size_t segmentsPerStroke, float canvasSize) {
+    mt19937 rng(1234);
+    uniform_real_distribution<float> start(0.0f, canvasSize);
+    uniform_real_distribution<float> step(-3.0f, 3.0f);
+
+    vector<StrokePtr> strokes;
+    for (size_t s = 0; s < strokeCount; ++s) {
+        StrokeSamples samples;
+        sf::Vector2f p(start(rng), start(rng));
+        for (size_t i = 0; i <= segmentsPerStroke; ++i) {
+            samples.push(p, 5.0f, i * 0.01f);
+            p += sf::Vector2f(step(rng), step(rng));
+        }
+        strokes.push_back(history.commit(std::move(samples)));
+    }
+    return strokes;
+}
+
+// 1M-segment scene: BVH culling and picking against a linear scan
+void benchmarkStrokeBvh() {
+    const size_t STROKES = 10000;
+    const size_t SEGMENTS = 100;
+    const float CANVAS = 20000.0f;
+    const int QUERIES = 1000;
+
+    printf("== Stroke BVH: %zu strokes x %zu segments ==\n", STROKES, SEGMENTS);
+    StrokeHistory history(1);
+    vector<StrokePtr> strokes = makeSyntheticStrokes(history, STROKES, SEGMENTS, CANVAS);
+
+    StrokeIndex index(2.5f);
+    auto start = Clock::now();
+    for (const auto& stroke : strokes) index.insert(stroke);
+    printf("build: %.2f ms, tree height %d\n", millisecondsSince(start), index.height());
+
+    mt19937 rng(99);
+    uniform_real_distribution<float> position(0.0f, CANVAS - 800.0f);
+    vector<Box> views;
+    for (int i = 0; i < QUERIES; ++i) {
+        float x = position(rng), y = position(rng);
+        views.push_back(Box{x, y, x + 800.0f, y + 800.0f});
+    }
+
+    size_t visibleSegments = 0;
+    start = Clock::now();
+    for (const auto& view : views) {
+        index.forEachVisible(view, [&](uint32_t, const vector<sf::Vector2f>&, size_t first, size_t end) {
+            visibleSegments += end - first;
+        });
+    }
+    double bvhCull = millisecondsSince(start) / QUERIES;
+
+    size_t scannedSegments = 0;
+    start = Clock::now();
+    for (const auto& view : views) {
+        for (const auto& stroke : strokes) {
+            const auto& points = stroke->points();
+            for (size_t i = 0; i + 1 < points.size(); ++i) {
+                Box segment;
+                segment.expand(points[i]);
+                segment.expand(points[i + 1]);
+                if (segment.padded(2.5f).intersects(view)) ++scannedSegments;
+            }
+        }
+    }
+    double linearCull = millisecondsSince(start) / QUERIES;
+    printf("cull 800x800 view: bvh %.4f ms (%zu segments submitted), linear %.4f ms (%zu segments)\n",
+           bvhCull, visibleSegments / QUERIES, linearCull, scannedSegments / QUERIES);
+
+    size_t picked = 0;
+    start = Clock::now();
+    for (const auto& view : views) {
+        if (index.pick(sf::Vector2f(view.minX, view.minY), 5.0f)) ++picked;
+    }
+    printf("point pick: %.4f ms (%zu hits)\n", millisecondsSince(start) / QUERIES, picked);
+
+    size_t boxHits = 0;
+    start = Clock::now();
+    for (const auto& view : views) {
+        boxHits += index.queryBox(Box{view.minX, view.minY, view.minX + 100.0f, view.minY + 100.0f}).size();
+    }
+    printf("box query 100x100: %.4f ms (%.2f strokes avg)\n", millisecondsSince(start) / QUERIES, static_cast<double>(boxHits) / QUERIES);
+}
+
+// The per-segment path main.cpp used before batching: one rotated rectangle per segment
+sf::RectangleShape makeSegmentShape(sf::Vector2f a, sf::Vector2f b, float thickness) {
+    sf::Vector2f direction = b - a;
+    sf::RectangleShape line(sf::Vector2f(std::sqrt(direction.x * direction.x + direction.y * direction.y), thickness));
+    line.setRotation(sf::radians(std::atan2(direction.y, direction.x)));
+    line.setOrigin(sf::Vector2f(0.0f, thickness / 2.0f));
+    line.setPosition(a);
+    return line;
+}
+
+// 100k segments on screen: one draw call per segment against one batched call,
+// plus the cost of growing the live stroke point by point
+void benchmarkBatchedRendering() {
+    const size_t STROKES = 1000;
+    const size_t SEGMENTS = 100;
+    const int FRAMES = 20;
+
+    printf("== Batched rendering: %zu strokes x %zu segments ==\n", STROKES, SEGMENTS);
+    sf::RenderTexture target;
+    if (!target.resize({800, 800})) {
+        printf("no render texture available, skipped\n");
+        return;
+    }
+
+    StrokeHistory history(1);
+    vector<StrokePtr> strokes = makeSyntheticStrokes(history, STROKES, SEGMENTS, 800.0f);
+
+    vector<sf::RectangleShape> shapes;
+    for (const auto& stroke : strokes) {
+        for (size_t i = 0; i + 1 < stroke->size(); ++i) {
+            shapes.push_back(makeSegmentShape(stroke->points()[i], stroke->points()[i + 1], 5.0f));
+        }
+    }
+
+    StrokeBatch batch;
+    auto start = Clock::now();
+    for (const auto& stroke : strokes) batch.add(stroke);
+    printf("batch build: %.2f ms, %zu vertices\n", millisecondsSince(start), batch.vertexCount());
+
+    // Reading a pixel back makes sure the GPU (or llvmpipe) has finished the frames
+    auto finish = [&]() {
+        target.display();
+        return target.getTexture().copyToImage().getPixel({0, 0});
+    };
+
+    finish();
+    start = Clock::now();
+    for (int frame = 0; frame < FRAMES; ++frame) {
+        target.clear();
+        for (const auto& shape : shapes) target.draw(shape);
+        target.display();
+    }
+    finish();
+    double perSegment = millisecondsSince(start) / FRAMES;
+
+    start = Clock::now();
+    for (int frame = 0; frame < FRAMES; ++frame) {
+        target.clear();
+        batch.draw(target);
+        target.display();
+    }
+    finish();
+    double batched = millisecondsSince(start) / FRAMES;
+    printf("frame: per-segment %.2f ms (%zu draw calls), batched %.2f ms (1 draw call, vertex buffer %s)\n",
+           perSegment, shapes.size(), batched, sf::VertexBuffer::isAvailable() ? "on" : "off");
+
+    // A live stroke of 1000 points drawn on top of the 100k segments
+    StrokeSamples samples;
+    StrokeTessellator tessellator;
+    size_t uploadedBefore = batch.uploadedVertices();
+    start = Clock::now();
+    for (int i = 0; i < 1000; ++i) {
+        samples.push(sf::Vector2f(100.0f + i * 0.6f, 400.0f + 50.0f * std::sin(i * 0.05f)), 5.0f, i * 0.01f);
+        size_t changed = tessellator.append(samples);
+        batch.updateLive(tessellator.strip(), changed);
+        target.clear();
+        batch.draw(target);
+        batch.drawLive(target);
+        target.display();
+    }
+    finish();
+    printf("live stroke: %.3f ms per point incl. frame, %.1f vertices uploaded per point\n",
+           millisecondsSince(start) / 1000, static_cast<double>(batch.uploadedVertices() - uploadedBefore) / 1000);
+}
+
+// Coverage of a triangle list sampled on a grid: how many samples each triangle hits
+struct CoverageGrid {
+    float minX, minY, step;
+    int width, height;
+    vector<uint8_t> hits;
+
+    CoverageGrid(const Box& box, float step) : minX(box.minX), minY(box.minY), step(step) {
+        width = static_cast<int>((box.maxX - box.minX) / step) + 1;
+        height = static_cast<int>((box.maxY - box.minY) / step) + 1;
+        hits.assign(static_cast<size_t>(width) * height, 0);
+    }
+
+    sf::Vector2f sample(int x, int y) const {
+        return sf::Vector2f(minX + (x + 0.5f) * step, minY + (y + 0.5f) * step);
+    }
+
+    void addTriangle(sf::Vector2f a, sf::Vector2f b, sf::Vector2f c) {
+        float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+        if (std::abs(area) < 1e-6f) return;
+        int x0 = max(0, static_cast<int>((min({a.x, b.x, c.x}) - minX) / step) - 1);
+        int x1 = min(width - 1, static_cast<int>((max({a.x, b.x, c.x}) - minX) / step) + 1);
+        int y0 = max(0, static_cast<int>((min({a.y, b.y, c.y}) - minY) / step) - 1);
+        int y1 = min(height - 1, static_cast<int>((max({a.y, b.y, c.y}) - minY) / step) + 1);
+        for (int y = y0; y <= y1; ++y) {
+            for (int x = x0; x <= x1; ++x) {
+                sf::Vector2f p = sample(x, y);
+                float w0 = (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x);
+                float w1 = (c.x - b.x) * (p.y - b.y) - (c.y - b.y) * (p.x - b.x);
+                float w2 = (a.x - c.x) * (p.y - c.y) - (a.y - c.y) * (p.x - c.x);
+                bool inside = area > 0 ? (w0 >= 0 && w1 >= 0 && w2 >= 0) : (w0 <= 0 && w1 <= 0 && w2 <= 0);
+                if (inside && hits[y * width + x] < 255) ++hits[y * width + x];
+            }
+        }
+    }
+};
+
+// Compares the old per-segment rectangles with the tessellator's strips:
+// vertices per input point, time, and coverage against the ideal outline
+// (every point within half the local width of the polyline). Gaps are ideal
+// samples left uncovered; overlaps are samples covered more than once, which
+// show up as dark seams once strokes are translucent.
+void benchmarkTessellation() {
+    const int STROKES = 20;
+    const size_t POINTS = 60;
+    printf("== Tessellation: %d strokes x %zu points ==\n", STROKES, POINTS);
+
+    mt19937 rng(7);
+    uniform_real_distribution<float> turn(-1.2f, 1.2f);
+    vector<StrokeSamples> strokes;
+    for (int s = 0; s < STROKES; ++s) {
+        StrokeSamples samples;
+        sf::Vector2f p(0.0f, 0.0f);
+        float angle = 0.0f;
+        for (size_t i = 0; i < POINTS; ++i) {
+            angle += (i % 20 < 10) ? 0.05f : turn(rng); // smooth arcs, then sharp zigzags
+            p += sf::Vector2f(std::cos(angle), std::sin(angle)) * 4.0f;
+            samples.push(p, 6.0f + 4.0f * std::sin(i * 0.2f), i * 0.01f);
+        }
+        strokes.push_back(std::move(samples));
+    }
+
+    auto measure = [&](const char* name, auto&& triangulate) {
+        size_t vertices = 0, ideal = 0, gaps = 0, overlaps = 0, outside = 0;
+        auto start = Clock::now();
+        vector<vector<sf::Vertex>> lists;
+        for (const auto& samples : strokes) lists.push_back(triangulate(samples, vertices));
+        double elapsed = millisecondsSince(start);
+
+        for (size_t s = 0; s < strokes.size(); ++s) {
+            const auto& samples = strokes[s];
+            Box box;
+            for (const auto& p : samples.points) box.expand(p);
+            CoverageGrid grid(box.padded(12.0f), 0.5f);
+            const auto& list = lists[s];
+            for (size_t i = 0; i + 2 < list.size(); i += 3) grid.addTriangle(list[i].position, list[i + 1].position, list[i + 2].position);
+
+            for (int y = 0; y < grid.height; ++y) {
+                for (int x = 0; x < grid.width; ++x) {
+                    sf::Vector2f p = grid.sample(x, y);
+                    bool inside = false;
+                    for (size_t i = 0; i + 1 < samples.size() && !inside; ++i) {
+                        sf::Vector2f a = samples.points[i], d = samples.points[i + 1] - a;
+                        float t = std::clamp(((p.x - a.x) * d.x + (p.y - a.y) * d.y) / (d.x * d.x + d.y * d.y), 0.0f, 1.0f);
+                        float width = samples.widths[i] + (samples.widths[i + 1] - samples.widths[i]) * t;
+                        inside = DistanceToSegment(p, a, samples.points[i + 1]) <= width / 2.0f;
+                    }
+                    uint8_t hits = grid.hits[y * grid.width + x];
+                    if (inside) {
+                        ++ideal;
+                        if (hits == 0) ++gaps;
+                    } else if (hits > 0) {
+                        ++outside;
+                    }
+                    if (hits > 1) ++overlaps;
+                }
+            }
+        }
+        printf("%-16s %5.2f vertices/point, %.3f ms, gaps %.2f%%, overlaps %.2f%%, outside %.2f%% of ideal area\n",
+               name, static_cast<double>(vertices) / (STROKES * POINTS), elapsed,
+               100.0 * gaps / ideal, 100.0 * overlaps / ideal, 100.0 * outside / ideal);
+    };
+
+    // Old path: an independent rectangle per segment (4 vertices, drawn as 2 triangles)
+    measure("rectangles", [](const StrokeSamples& samples, size_t& vertices) {
+        vector<sf::Vertex> list;
+        for (size_t i = 0; i + 1 < samples.size(); ++i) {
+            sf::Vector2f a = samples.points[i], b = samples.points[i + 1];
+            sf::Vector2f d = b - a;
+            float length = std::sqrt(d.x * d.x + d.y * d.y);
+            sf::Vector2f n = sf::Vector2f(-d.y, d.x) / length * ((samples.widths[i] + samples.widths[i + 1]) / 4.0f);
+            sf::Vertex quad[4] = {{a + n}, {a - n}, {b + n}, {b - n}};
+            for (int v : {0, 1, 2, 1, 3, 2}) list.push_back(quad[v]);
+            vertices += 4;
+        }
+        return list;
+    });
+
+    for (JoinStyle join : {JoinStyle::Miter, JoinStyle::Bevel, JoinStyle::Round}) {
+        StrokeStyle style;
+        style.join = join;
+        string name = string("strip, ") + JoinStyleName(join);
+        measure(name.c_str(), [&](const StrokeSamples& samples, size_t& vertices) {
+            vector<sf::Vertex> strip = TessellateStroke(samples, style, sf::Color::White);
+            vertices += strip.size();
+            vector<sf::Vertex> list;
+            for (size_t t = 0; t + 2 < strip.size(); ++t) {
+                list.insert(list.end(), {strip[t], strip[t + 1], strip[t + 2]});
+            }
+            return list;
+        });
+    }
+}
+
+// Headless 1920x1080 export of an 800x800 canvas, single-threaded and band-parallel
+void benchmarkSoftwareRaster() {
+    const int RUNS = 10;
+    printf("== Software rasterizer: 1920x1080 ==\n");
+    sf::Transform view;
+    view.scale(sf::Vector2f(1920.0f / 800.0f, 1080.0f / 800.0f));
+
+    for (size_t strokeCount : {20, 200, 1000}) {
+        StrokeHistory history(1);
+        vector<StrokePtr> strokes = makeSyntheticStrokes(history, strokeCount, 100, 800.0f);
+        for (unsigned threads : {1u, 0u}) {
+            SoftwareRasterizer rasterizer(1920, 1080, threads);
+            auto start = Clock::now();
+            for (int run = 0; run < RUNS; ++run) {
+                rasterizer.clear(sf::Color::Black);
+                rasterizer.drawStrokes(strokes, sf::Color::White, view);
+            }
+            printf("%zu segments, %s: %.2f ms\n", strokeCount * 100,
+                   threads == 1 ? "1 thread" : "all threads", millisecondsSince(start) / RUNS);
+        }
+    }
+}
+
+// Per-frame cost of the live icon preview while a stroke is being drawn:
+// incremental layout plus rewriting the marker batch. Needs no window.
+void benchmarkIconPreview() {
+    const int ICONS = 1000;
+    const int FRAMES = 2000;
+    printf("== Icon preview: %d icons ==\n", ICONS);
+
+    for (size_t strokeCount : {10, 100, 1000}) {
+        StrokeHistory history(1);
+        vector<StrokePtr> strokes = makeSyntheticStrokes(history, strokeCount, 100, 800.0f);
+        IncrementalLayout layout;
+        layout.setStrokes(strokes);
+        IconPreview preview;
+        vector<sf::Vector2f> current(ICONS, sf::Vector2f(20.0f, 20.0f));
+
+        mt19937 rng(7);
+        uniform_real_distribution<float> step(-3.0f, 3.0f);
+        StrokeSamples live;
+        sf::Vector2f p(400.0f, 400.0f);
+        double worst = 0.0;
+        auto start = Clock::now();
+        for (int frame = 0; frame < FRAMES; ++frame) {
+            auto frameStart = Clock::now();
+            p += sf::Vector2f(step(rng), step(rng));
+            live.push(p, 5.0f, frame / 120.0f);
+            layout.updateLive(live);
+            preview.update(layout.place(ICONS, 0.5f), current);
+            worst = max(worst, millisecondsSince(frameStart));
+        }
+        printf("%zu strokes + live stroke: %.3f ms avg, %.3f ms max per frame (%zu vertices)\n",
+               strokeCount, millisecondsSince(start) / FRAMES, worst, preview.vertexCount());
+    }
+}
+
+// Placement along a 1M-point path whose point density varies tenfold, like a
+// stroke drawn alternately slow and fast. Picking every n/k-th point bunches
+// icons where points are dense; arc-length placement keeps the gaps even.
+void benchmarkArcLengthPlacement() {
+    const size_t POINTS = 1000000;
+    const int RUNS = 20;
+    printf("== Arc-length placement: %zu points ==\n", POINTS);
+
+    // A long spiral in 100 strokes; step length swings between 0.1 and 1 unit
+    vector<StrokeProgress> progress(100);
+    double angle = 0.0;
+    auto start = Clock::now();
+    for (size_t i = 0; i < POINTS; ++i) {
+        double radius = 200.0 + angle * 2.0;
+        double step = 0.55 + 0.45 * sin(i * 0.001);
+        angle += step / radius;
+        progress[i * progress.size() / POINTS].append(sf::Vector2f(float(radius * cos(angle)), float(radius * sin(angle))), i * 0.001f);
+    }
+    double buildMs = millisecondsSince(start);
+    vector<const StrokeProgress*> strokes;
+    double totalLength = 0.0;
+    for (const auto& stroke : progress) {
+        strokes.push_back(&stroke);
+        totalLength += stroke.totalLength();
+    }
+    printf("running lengths: %.1f ms for %.0f units\n", buildMs, totalLength);
+
+    // Largest gap between neighbouring icons over the smallest; the unweighted
+    // step between two strokes shows up as a little spread too
+    auto gapSpread = [](const vector<sf::Vector2f>& placed) {
+        double lo = 1e30, hi = 0.0;
+        for (size_t i = 1; i < placed.size(); ++i) {
+            sf::Vector2f d = placed[i] - placed[i - 1];
+            double gap = sqrt(double(d.x) * d.x + double(d.y) * d.y);
+            lo = min(lo, gap);
+            hi = max(hi, gap);
+        }
+        return hi / max(lo, 1e-9);
+    };
+
+    for (int count : {1000, 100000}) {
+        vector<sf::Vector2f> byIndex;
+        for (int k = 0; k < count; ++k) {
+            size_t target = size_t(k) * (POINTS - 1) / (count - 1);
+            for (const auto& stroke : progress) {
+                if (target < stroke.size()) {
+                    byIndex.push_back(stroke.points[target]);
+                    break;
+                }
+                target -= stroke.size();
+            }
+        }
+
+        vector<sf::Vector2f> byLength;
+        start = Clock::now();
+        for (int run = 0; run < RUNS; ++run) byLength = PlaceAlongProgress(strokes, count, 0.0f);
+        double lengthMs = millisecondsSince(start) / RUNS;
+
+        float spacing = float(totalLength / count);
+        vector<sf::Vector2f> spaced;
+        start = Clock::now();
+        for (int run = 0; run < RUNS; ++run) spaced = PlaceEvenlySpaced(strokes, spacing, count + int(strokes.size()));
+        double spacedMs = millisecondsSince(start) / RUNS;
+
+        printf("%d icons: by index max/min gap %.2f; by length %.3f ms, gap %.3f; every %.1f units %.3f ms (%zu icons)\n",
+               count, gapSpread(byIndex), lengthMs, gapSpread(byLength), spacing, spacedMs, spaced.size());
+    }
+}
+
+// Per-stroke layout of 10k strokes: every stroke gets its share of the icons
+// and is laid out on its own, on one thread and on all of them
+void benchmarkPerStrokeLayout() {
+    const size_t STROKES = 10000;
+    const int RUNS = 10;
+    printf("== Per-stroke layout: %zu strokes ==\n", STROKES);
+
+    StrokeHistory history(1);
+    vector<StrokeProgress> progress;
+    for (const auto& stroke : makeSyntheticStrokes(history, STROKES, 100, 20000.0f)) {
+        progress.push_back(MakeProgress(stroke->worldPoints(), stroke->times()));
+    }
+    vector<const StrokeProgress*> strokes;
+    for (const auto& stroke : progress) strokes.push_back(&stroke);
+
+    unsigned cores = max(1u, thread::hardware_concurrency());
+    for (int count : {1000, 100000}) {
+        for (unsigned threads : {1u, cores}) {
+            vector<sf::Vector2f> placed;
+            auto start = Clock::now();
+            for (int run = 0; run < RUNS; ++run) placed = PlacePerStroke(strokes, count, 0.5f, {}, threads);
+            printf("%d icons, %u threads: %.3f ms (%zu placed)\n", count, threads, millisecondsSince(start) / RUNS, placed.size());
+            if (cores == 1) break;
+        }
+    }
+}
+
+// Filling closed shapes with blue noise: a screen-sized ellipse and a heart,
+// each outline 4000 points. Reports the closest pair against the spacing the
+// icon count allows, so evenness shows next to speed.
+void benchmarkShapeFill() {
+    const int RUNS = 20;
+    printf("== Shape fill ==\n");
+
+    vector<sf::Vector2f> ellipse, heart;
+    for (int i = 0; i < 4000; ++i) {
+        float t = i * 6.2831853f / 4000;
+        ellipse.push_back(sf::Vector2f(960 + 950 * cos(t), 540 + 530 * sin(t)));
+        float x = 16 * pow(sin(t), 3), y = 13 * cos(t) - 5 * cos(2 * t) - 2 * cos(3 * t) - cos(4 * t);
+        heart.push_back(sf::Vector2f(960 + 30 * x, 500 - 30 * y));
+    }
+    for (const auto& shape : {make_pair("ellipse", &ellipse), make_pair("heart", &heart)}) {
+        for (int count : {100, 1000, 10000}) {
+            vector<sf::Vector2f> placed;
+            auto start = Clock::now();
+            for (int run = 0; run < RUNS; ++run) placed = FillShape(ShapeMask({shape.second}), count);
+            double ms = millisecondsSince(start) / RUNS;
+
+            ShapeMask mask({shape.second});
+            float closest = INFINITY;
+            size_t outside = 0;
+            for (size_t i = 0; i < placed.size(); ++i) {
+                if (!mask.contains(placed[i])) ++outside;
+                for (size_t j = 0; j < i; ++j) {
+                    sf::Vector2f d = placed[i] - placed[j];
+                    closest = min(closest, d.x * d.x + d.y * d.y);
+                }
+            }
+            printf("%s, %d icons: %.2f ms, %zu placed, %zu outside, closest pair %.1f (spacing %.1f)\n", shape.first, count, ms,
+                   placed.size(), outside, sqrt(closest), sqrt(mask.area() / count));
+        }
+    }
+}
+
+// Snapping layouts to a grid, one icon per cell, with targets along strokes
+// crowded enough that many cells are contested
+void benchmarkGridAssignment() {
+    printf("== Grid assignment ==\n");
+    StrokeHistory history(1);
+    vector<StrokeProgress> progress;
+    for (const auto& stroke : makeSyntheticStrokes(history, 200, 400, 4000.0f)) {
+        progress.push_back(MakeProgress(stroke->worldPoints(), stroke->times()));
+    }
+    vector<const StrokeProgress*> strokes;
+    for (const auto& stroke : progress) strokes.push_back(&stroke);
+
+    DesktopGrid grid;
+    grid.spacing = sf::Vector2i(8, 8);
+    grid.cells = sf::Vector2i(520, 520);
+    for (int count : {1000, 10000, 100000}) {
+        vector<sf::Vector2f> targets = PlaceAlongProgress(strokes, count, 0.0f);
+        auto start = Clock::now();
+        vector<sf::Vector2i> cells = AssignGridCells(targets, grid);
+        double ms = millisecondsSince(start);
+        size_t home = 0;
+        for (size_t i = 0; i < cells.size(); ++i) home += cells[i] == grid.cellAt(targets[i]);
+        printf("%d icons: %.3f ms, %.1f%% in their nearest cell\n", count, ms, 100.0 * home / max<size_t>(1, cells.size()));
+    }
+}
+
+// Which icon goes to which slot: icons start in Explorer's column grid and
+// move onto a layout along strokes. Total travel of the index-order mapping
+// against the auction solver, exact and fast.
+// Returns false if a solve came out worse than it should: exact mode more
+// than a pixel over the optimum, or fast mode worse than index order
+bool benchmarkIconAssignment() {
+    printf("== Icon assignment ==\n");
+    bool ok = true;
+    for (int count : {100, 1000, 10000}) {
+        // A screen with room for the icons, strokes drawn all over it
+        float scale = sqrt(count * 76.0f * 96.0f * 1.2f / (1920.0f * 1080.0f));
+        sf::Vector2u screen(unsigned(1920 * scale), unsigned(1080 * scale));
+        StrokeHistory history(1);
+        vector<StrokeProgress> progress;
+        for (const auto& stroke : makeSyntheticStrokes(history, 20, 300, float(screen.y))) {
+            progress.push_back(MakeProgress(stroke->worldPoints(), stroke->times()));
+        }
+        vector<const StrokeProgress*> strokes;
+        for (const auto& stroke : progress) strokes.push_back(&stroke);
+
+        SimulatedDesktop desktop = SimulatedDesktop::grid(count, screen);
+        vector<sf::Vector2f> icons;
+        for (const auto& icon : desktop.icons()) icons.push_back(sf::Vector2f(icon.position));
+
+        IconAssignment solver;
+        // Every icon placed, then layouts with room for only some of them
+        for (size_t slotCount : {size_t(count), size_t(count * 6 / 10), size_t(count / 2), size_t(count * 4 / 10)}) {
+            vector<sf::Vector2f> slots = PlaceAlongProgress(strokes, slotCount, 0.0f);
+            double indexTravel = TotalTravel(icons, slots, AssignByIndex(slots.size()));
+            printf("%d icons, %zu slots: index order %.0f px", count, slots.size(), indexTravel);
+            for (auto mode : {IconAssignment::Mode::Exact, IconAssignment::Mode::Fast}) {
+                if (mode == IconAssignment::Mode::Exact && count > 1000) continue;
+                auto start = Clock::now();
+                vector<int> assignment = solver.solve(icons, slots, mode);
+                double travel = TotalTravel(icons, slots, assignment);
+                printf(", %s %.0f px in %.2f ms", mode == IconAssignment::Mode::Exact ? "exact" : "fast", travel, millisecondsSince(start));
+                if (travel > indexTravel) {
+                    printf(" (WORSE than index order)");
+                    ok = false;
+                }
+            }
+            printf("\n");
+        }
+    }
+
+    // Fast mode against index order with icons to spare: desktop grids or
+    // scattered icons, and a circle, a blob or a wave drawn somewhere on or
+    // off them. Index order can be close to optimal here, so this catches a
+    // fast solve whose candidates miss the icons the optimum uses.
+    {
+        mt19937 rng(11);
+        uniform_real_distribution<float> unit(0.0f, 1.0f);
+        const int LAYOUTS = 100;
+        int worse = 0;
+        double fastTotal = 0.0, indexTotal = 0.0, worstMs = 0.0;
+        IconAssignment solver;
+        for (int c = 0; c < LAYOUTS; ++c) {
+            vector<sf::Vector2f> icons(1000), slots(300 + rng() % 700);
+            int iconLayout = rng() % 3, shape = rng() % 3;
+            float width = 500.0f + 3000.0f * unit(rng), height = 500.0f + 2000.0f * unit(rng);
+            for (size_t i = 0; i < icons.size(); ++i) {
+                if (iconLayout == 0) icons[i] = sf::Vector2f(width * unit(rng), height * unit(rng));
+                else if (iconLayout == 1) icons[i] = sf::Vector2f(40.0f + 76.0f * (i / 14), 40.0f + 96.0f * (i % 14));
+                else icons[i] = sf::Vector2f(40.0f + 76.0f * (i % 25), 40.0f + 96.0f * (i / 25));
+            }
+            sf::Vector2f center(1.5f * width * unit(rng), height * unit(rng));
+            float radius = 100.0f + 1000.0f * unit(rng);
+            for (size_t s = 0; s < slots.size(); ++s) {
+                float t = static_cast<float>(s) / slots.size();
+                if (shape == 0) slots[s] = center + radius * sf::Vector2f(cos(6.2832f * t), sin(6.2832f * t));
+                else if (shape == 1) slots[s] = center + radius * sf::Vector2f(unit(rng) - 0.5f, unit(rng) - 0.5f);
+                else slots[s] = center + sf::Vector2f(2.0f * radius * t, 50.0f * sin(18.85f * t));
+            }
+            double indexTravel = TotalTravel(icons, slots, AssignByIndex(slots.size()));
+            auto start = Clock::now();
+            double travel = TotalTravel(icons, slots, solver.solve(icons, slots, IconAssignment::Mode::Fast));
+            worstMs = max(worstMs, millisecondsSince(start));
+            fastTotal += travel;
+            indexTotal += indexTravel;
+            if (travel > indexTravel) ++worse;
+        }
+        printf("fast vs index order, 1000 icons and 300-999 slots: %d of %d layouts worse, %.0f%% of index order's travel overall, worst %.2f ms\n",
+               worse, LAYOUTS, 100.0 * fastTotal / indexTotal, worstMs);
+        ok = ok && worse == 0;
+    }
+
+    // Exact mode against trying every assignment, mostly with icons to spare
+    mt19937 rng(7);
+    uniform_real_distribution<float> coordinate(0.0f, 1000.0f);
+    int worse = 0;
+    const int CASES = 300;
+    for (int c = 0; c < CASES; ++c) {
+        vector<sf::Vector2f> icons(2 + rng() % 7), slots(1 + rng() % icons.size());
+        for (auto& icon : icons) icon = sf::Vector2f(coordinate(rng), coordinate(rng));
+        for (auto& slot : slots) slot = sf::Vector2f(coordinate(rng), coordinate(rng));
+        double best = numeric_limits<double>::max();
+        vector<int> order(icons.size());
+        for (size_t i = 0; i < order.size(); ++i) order[i] = int(i);
+        do {
+            best = min(best, TotalTravel(icons, slots, order));
+        } while (next_permutation(order.begin(), order.end()));
+        IconAssignment solver;
+        if (TotalTravel(icons, slots, solver.solve(icons, slots, IconAssignment::Mode::Exact)) > best + 1.0) ++worse;
+    }
+    printf("exact vs brute force: %d of %d cases more than a pixel over the optimum\n", worse, CASES);
+    return ok && worse == 0;
+}
+
+// Icon pictures packed once into the atlas, then the per-frame cost of
+// emitting a picture and a label for every icon into the single draw
+void benchmarkIconAtlas() {
+    const int ICONS = 1000;
+    const int FRAMES = 2000;
+    const unsigned SIDE = 24;
+    printf("== Icon atlas: %d icons ==\n", ICONS);
+
+    SimulatedDesktop desktop = SimulatedDesktop::grid(ICONS);
+    vector<IconRecord> icons = desktop.icons();
+    IconAtlas atlas;
+    if (!atlas.create()) return;
+    vector<IconVisual> visuals;
+    for (int pass = 0; pass < 2; ++pass) {
+        auto start = Clock::now();
+        visuals.clear();
+        for (const auto& icon : icons) {
+            visuals.push_back(atlas.visual(icon.name, atlas.hasImage(icon.name) ? sf::Image() : desktop.iconImage(icon, SIDE), SIDE));
+        }
+        printf("%s: %.2f ms, %zu pictures fetched so far, atlas %.1f%% used\n", pass == 0 ? "packing" : "cached",
+               millisecondsSince(start), desktop.imageRequestCount(), atlas.occupancy() * 100.0f);
+    }
+
+    // Labels need a font; ten stand-in glyphs per icon cost the same to emit
+    for (auto& visual : visuals) {
+        for (int i = 0; i < 10; ++i) visual.label.push_back(GlyphQuad{{{-30.0f + 6.0f * i, 0.0f}, {6.0f, 10.0f}}, {{0.0f, 0.0f}, {6.0f, 10.0f}}});
+    }
+    StrokeHistory history(1);
+    IncrementalLayout layout;
+    layout.setStrokes(makeSyntheticStrokes(history, 100, 100, 800.0f));
+    IconPreview preview;
+    preview.setVisuals(visuals, &atlas.texture(), atlas.whiteTexel());
+    double worst = 0.0;
+    auto start = Clock::now();
+    for (int frame = 0; frame < FRAMES; ++frame) {
+        auto frameStart = Clock::now();
+        preview.update(layout.place(ICONS, 0.5f), {}, 1.0f + frame % 4);
+        worst = max(worst, millisecondsSince(frameStart));
+    }
+    printf("pictures + labels: %.3f ms avg, %.3f ms max per frame (%zu vertices, one draw)\n",
+           millisecondsSince(start) / FRAMES, worst, preview.vertexCount());
+}
+
+// Spelling a sentence with icons: tracing the glyphs the first time, then
+// laying out from the cached outlines
+void benchmarkTextLayout() {
+    const int RUNS = 100;
+    printf("== Text layout ==\n");
+    sf::Font font;
+    if (!font.openFromFile("SFML/SFML-3.0.2/examples/opengl/resources/tuffy.ttf")) {
+        printf("no font, skipped\n");
+        return;
+    }
+    u32string sentence = U"The quick brown fox\njumps over the lazy dog";
+    sf::FloatRect screen({192.0f, 108.0f}, {1536.0f, 864.0f});
+
+    GlyphOutlineCache cache;
+    auto start = Clock::now();
+    vector<vector<sf::Vector2f>> loops = TextLoops(cache, font, sentence, screen);
+    double coldMs = millisecondsSince(start);
+    start = Clock::now();
+    for (int run = 0; run < RUNS; ++run) loops = TextLoops(cache, font, sentence, screen);
+    size_t points = 0;
+    for (const auto& loop : loops) points += loop.size();
+    printf("outlines: %.2f ms first time, %.3f ms cached (%zu glyphs, %zu loops, %zu points)\n", coldMs,
+           millisecondsSince(start) / RUNS, cache.glyphCount(), loops.size(), points);
+
+    TextLayout layout;
+    layout.set(font, sentence, screen);
+    for (int count : {100, 500, 2000}) {
+        vector<sf::Vector2f> placed;
+        start = Clock::now();
+        for (int run = 0; run < RUNS; ++run) placed = layout.place(count);
+        printf("%d icons: %.3f ms (%zu placed)\n", count, millisecondsSince(start) / RUNS, placed.size());
+    }
+}
+
+// Stippling the screenshot shipped with the repo, at the app's working
+// resolution and at full resolution, on one thread and on every core
+void benchmarkStippling() {
+    printf("== Stippling coords.png ==\n");
+    sf::Image image;
+    if (!image.loadFromFile("coords.png")) {
+        printf("no coords.png, skipped\n");
+        return;
+    }
+    unsigned cores = max(1u, thread::hardware_concurrency());
+    size_t fullSize = static_cast<size_t>(image.getSize().x) * image.getSize().y;
+    for (int count : {500, 2000}) {
+        for (size_t pixels : {max<size_t>(count * STIPPLE_PIXELS_PER_ICON, 65536), fullSize}) {
+            DensityMap density = DensityMap::fromImage(image, pixels);
+            for (unsigned threads : {1u, cores}) {
+                StippleSettings settings;
+                settings.threads = threads;
+                auto start = Clock::now();
+                StippleResult result = StippleDensity(density, count, settings);
+                printf("%d icons, %ux%u working, %u threads: %.1f ms, %d iterations%s\n", count, density.width, density.height,
+                       threads, millisecondsSince(start), result.iterations, result.converged ? "" : " (not converged)");
+                if (cores == 1) break;
+            }
+        }
+    }
+}
+
+// Hand-drawn looking strokes of known shapes: the ideal outline with a slow
+// wobble of the given size and a little jitter, starting anywhere on closed
+// shapes and missing or overshooting the start at the end like a real stroke
+vector<sf::Vector2f> wobblyStroke(const vector<sf::Vector2f>& ideal, bool closed, float wobble, mt19937& rng) {
+    normal_distribution<float> jitter(0.0f, wobble * 0.3f);
+    uniform_real_distribution<float> unit(0.0f, 1.0f);
+    float phase1 = unit(rng) * 6.283f, phase2 = unit(rng) * 6.283f;
+    size_t n = ideal.size(), start = closed ? static_cast<size_t>(unit(rng) * n) % n : 0;
+    vector<sf::Vector2f> stroke;
+    for (size_t i = 0; i < n; ++i) {
+        sf::Vector2f a = ideal[(start + i) % n], d = ideal[(start + i + 1) % n] - a;
+        float length = sqrt(d.x * d.x + d.y * d.y);
+        sf::Vector2f normal = length > 0.0f ? sf::Vector2f(-d.y, d.x) / length : sf::Vector2f();
+        float t = static_cast<float>(i) / n;
+        float offset = wobble * (0.7f * sin(12.566f * t + phase1) + 0.3f * sin(31.4f * t + phase2)) + jitter(rng);
+        stroke.push_back(a + normal * offset);
+    }
+    if (closed) {
+        int overshoot = static_cast<int>((unit(rng) * 0.09f - 0.03f) * n);
+        for (int i = 0; i < overshoot; ++i) stroke.push_back(stroke[i]);
+        if (overshoot < 0) stroke.resize(n + overshoot);
+    }
+    return stroke;
+}
+
+void benchmarkShapeRecognition() {
+    const int STROKES = 700;
+    printf("== Shape recognition ==\n");
+    auto polygon = [](const vector<sf::Vector2f>& corners, int perSide) {
+        vector<sf::Vector2f> outline;
+        for (size_t k = 0; k < corners.size(); ++k) {
+            for (int i = 0; i < perSide; ++i) outline.push_back(corners[k] + (corners[(k + 1) % corners.size()] - corners[k]) * (float(i) / perSide));
+        }
+        return outline;
+    };
+    const char* names[] = {"line", "circle", "ellipse", "rectangle", "triangle", "pentagon", "scribble"};
+    ShapeKind expected[] = {ShapeKind::Line, ShapeKind::Circle, ShapeKind::Ellipse, ShapeKind::Rectangle, ShapeKind::Polygon, ShapeKind::Polygon, ShapeKind::None};
+
+    for (float wobble : {0.01f, 0.02f, 0.04f}) {
+        mt19937 rng(7);
+        uniform_real_distribution<float> unit(0.0f, 1.0f);
+        int correct[7] = {}, tried[7] = {};
+        size_t pointsBefore = 0, pointsAfter = 0;
+        double ms = 0.0;
+        for (int k = 0; k < STROKES; ++k) {
+            int kind = k % 7;
+            float size = 60.0f + 300.0f * unit(rng), turn = unit(rng) * 6.283f, aspect = 0.35f + 0.45f * unit(rng);
+            auto at = [&](float x, float y) { return sf::Vector2f(960 + x * cos(turn) - y * sin(turn), 540 + x * sin(turn) + y * cos(turn)); };
+            vector<sf::Vector2f> ideal;
+            if (kind == 0 || kind == 6) {
+                for (int i = 0; i < 300; ++i) ideal.push_back(at(size * (i / 149.5f - 1), kind == 6 ? size * 0.5f * sin(i / 25.0f) : 0.0f));
+            } else if (kind <= 2) {
+                for (int i = 0; i < 300; ++i) ideal.push_back(at(size * cos(i / 47.75f), (kind == 2 ? aspect : 1.0f) * size * sin(i / 47.75f)));
+            } else if (kind == 3) {
+                ideal = polygon({at(-size, -size * aspect), at(size, -size * aspect), at(size, size * aspect), at(-size, size * aspect)}, 80);
+            } else {
+                int sides = kind == 4 ? 3 : 5;
+                vector<sf::Vector2f> corners;
+                for (int c = 0; c < sides; ++c) corners.push_back(at(size * cos(6.283f * c / sides), size * sin(6.283f * c / sides)));
+                ideal = polygon(corners, 300 / sides);
+            }
+            vector<sf::Vector2f> stroke = wobblyStroke(ideal, kind != 0 && kind != 6, wobble * size, rng);
+
+            auto start = Clock::now();
+            RecognizedShape shape = RecognizeShape(stroke);
+            ms += millisecondsSince(start);
+            ++tried[kind];
+            bool cornersRight = shape.kind != ShapeKind::Polygon || shape.corners.size() == (kind == 4 ? 3u : 5u);
+            if (shape.kind == expected[kind] && cornersRight) ++correct[kind];
+            pointsBefore += stroke.size();
+            pointsAfter += shape.kind == ShapeKind::None ? stroke.size() : ShapeOutline(shape).size();
+        }
+        printf("wobble %.0f%% of size: %.1f us per stroke, points %zu -> %zu; recognized", wobble * 100.0f, ms * 1000.0 / STROKES, pointsBefore, pointsAfter);
+        for (int kind = 0; kind < 7; ++kind) printf(" %s %d/%d", names[kind], correct[kind], tried[kind]);
+        printf("\n");
+    }
+}
+
+// Icons settling on a long spiral from a bunched-up rigid layout (drawn
+// slower and slower outwards, so speed-weighted placement crowds the icons there).
+// Reports the step time on one thread and on every core against the 60 Hz
+// frame budget, and how much the icons overlap before and after.
+void benchmarkIconPhysics() {
+    printf("== Icon physics ==\n");
+    const float SPACING = 12.0f;
+    unsigned cores = max(1u, thread::hardware_concurrency());
+
+    // Icon pairs closer than three quarters of the spacing
+    const float CROWDED = 0.75f * SPACING;
+    auto crowded = [&](const vector<sf::Vector2f>& icons) {
+        size_t close = 0;
+        vector<pair<float, size_t>> byX;
+        for (size_t i = 0; i < icons.size(); ++i) byX.push_back({icons[i].x, i});
+        sort(byX.begin(), byX.end());
+        for (size_t a = 0; a < byX.size(); ++a) {
+            for (size_t b = a + 1; b < byX.size() && byX[b].first - byX[a].first < CROWDED; ++b) {
+                sf::Vector2f d = icons[byX[a].second] - icons[byX[b].second];
+                if (d.x * d.x + d.y * d.y < CROWDED * CROWDED) ++close;
+            }
+        }
+        return close;
+    };
+
+    for (int count : {1000, 10000}) {
+        // An Archimedean spiral with turns far enough apart not to interact,
+        // long enough for every icon at about the spacing
+        const float GAP = 4.0f * SPACING;
+        StrokeProgress spiral;
+        float turns = sqrt(count * SPACING * 1.05f / (3.14159f * GAP)), maxRadius = turns * GAP;
+        for (float t = 0.0f; t < 1.0f; t += 0.2f / (count + 100)) {
+            float r = maxRadius * sqrt(t), angle = 6.2832f * turns * sqrt(t);
+            spiral.append(sf::Vector2f(r * cos(angle), r * sin(angle)), t * t * 60.0f);
+        }
+        vector<sf::Vector2f> start = PlaceAlongProgress({&spiral}, count, 0.7f);
+
+        vector<sf::Vector2f> settled[2];
+        for (unsigned threads : {1u, cores}) {
+            PhysicsSettings settings;
+            settings.spacing = SPACING;
+            settings.threads = threads;
+            IconPhysics physics(settings);
+            auto begin = Clock::now();
+            physics.setPath({&spiral});
+            physics.reset(start);
+            double setupMs = millisecondsSince(begin);
+            begin = Clock::now();
+            int steps = physics.settle(600);
+            double ms = millisecondsSince(begin);
+            settled[threads == 1 ? 0 : 1] = physics.positions();
+
+            // Brute force, so only for the small run
+            double offPath = 0.0;
+            if (count <= 1000) {
+                for (const auto& p : settled[threads == 1 ? 0 : 1]) {
+                    float best = INFINITY;
+                    for (size_t k = 0; k + 1 < spiral.size(); ++k) best = min(best, DistanceToSegment(p, spiral.points[k], spiral.points[k + 1]));
+                    offPath += best;
+                }
+            }
+            printf("%d icons, %u threads: setup %.1f ms, %d steps to settle, %.3f ms per step (%.0f%% of a 60 Hz frame)%s\n", count, threads,
+                   setupMs, steps, ms / max(steps, 1), ms / max(steps, 1) / (1000.0 / 60.0) * 100.0, physics.settled() ? "" : ", not settled");
+            if (count <= 1000) printf("  mean distance from the path %.2f (spacing %.0f)\n", offPath / physics.size(), SPACING);
+            if (cores == 1) break;
+        }
+        printf("  crowded pairs: %zu before, %zu after%s\n", crowded(start), crowded(settled[0]),
+               cores > 1 && settled[0] != settled[1] ? "; threads disagree" : "");
+    }
+}
+
+// Panning across drawings of growing size at the same stroke density: with
+// tiles the frame cost should stay flat while the drawing grows
+void benchmarkTiledCanvas() {
+    const int FRAMES = 200;
+    const float PAN_STEP = 40.0f;
+    printf("== Tiled canvas: panning an 800x800 view ==\n");
+
+    for (float canvasSize : {800.0f, 4000.0f, 12000.0f}) {
+        sf::RenderTexture target;
+        if (!target.resize({800, 800})) {
+            printf("no render texture available, skipped\n");
+            return;
+        }
+        size_t strokeCount = static_cast<size_t>(200 * (canvasSize / 800.0f) * (canvasSize / 800.0f));
+        StrokeHistory history(1);
+        vector<StrokePtr> strokes = makeSyntheticStrokes(history, strokeCount, 40, canvasSize);
+        StrokeBatch batch;
+        StrokeIndex index(2.5f);
+        for (const auto& stroke : strokes) {
+            batch.add(stroke);
+            index.insert(stroke);
+        }
+        TiledStrokeLayer layer(2.5f, 32 * 1024 * 1024);
+
+        sf::View view(sf::FloatRect({0.0f, 0.0f}, {800.0f, 800.0f}));
+        float travel = max(0.0f, canvasSize - 800.0f);
+        double worst = 0.0;
+        auto start = Clock::now();
+        for (int frame = 0; frame < FRAMES; ++frame) {
+            auto frameStart = Clock::now();
+            // Pan back and forth along the diagonal
+            float offset = fmod(frame * PAN_STEP, 2.0f * travel + 1.0f);
+            if (offset > travel) offset = 2.0f * travel - offset;
+            view.setCenter(sf::Vector2f(400.0f + offset, 400.0f + offset));
+            target.setView(view);
+            target.clear();
+            layer.update(batch, index, {}, view, target.getSize());
+            layer.draw(target);
+            target.display();
+            worst = max(worst, millisecondsSince(frameStart));
+        }
+        finishDrawing(target);
+        printf("%zu strokes over %.0fx%.0f: frame %.3f ms avg, %.3f ms max, %zu tile renders, %zu cached (%zu MB), %zu evicted\n",
+               strokeCount, canvasSize, canvasSize, millisecondsSince(start) / FRAMES, worst, layer.tileRenders(),
+               layer.tileCount(), layer.memoryUsage() / (1024 * 1024), layer.evictions());
+
+        // The whole drawing in view: simplified levels keep the submitted
+        // vertices proportional to the pixels instead of the points
+        view = sf::View(sf::FloatRect({0.0f, 0.0f}, {canvasSize, canvasSize}));
+        target.setView(view);
+        size_t lodBefore = batch.lodVertices();
+        start = Clock::now();
+        target.clear();
+        layer.update(batch, index, {}, view, target.getSize());
+        layer.draw(target);
+        target.display();
+        finishDrawing(target);
+        printf("  zoomed out to fit: %.2f ms, %zu simplified vertices for %zu full-detail ones\n",
+               millisecondsSince(start), batch.lodVertices() - lodBefore, batch.vertexCount());
+    }
+}
+
+// Dragging the eraser across 100k segments, one dab per frame as in the
+// window: the edit alone, then with the tiles under the view re-rendered.
+// Once as a single long scribble, where each dab cuts a huge stroke, and
+// once as many short strokes.
+void benchmarkEraser() {
+    const size_t SEGMENTS = 100000;
+    const int DABS = 200;
+    const float RADIUS = 12.0f;
+    printf("== Eraser drag: %zu segments, %d dabs ==\n", SEGMENTS, DABS);
+    sf::RenderTexture target;
+    bool rendering = target.resize({800, 800});
+
+    for (size_t strokeCount : {size_t(1), size_t(100)}) {
+        CanvasScene scene(StrokeStyle{}, 5.0f, 30.0f);
+        StrokeDelta drawing;
+        drawing.added = makeSyntheticStrokes(scene.history, strokeCount, SEGMENTS / strokeCount, 800.0f);
+        scene.apply(drawing);
+        Box bounds;
+        for (const auto& stroke : drawing.added) bounds = Union(bounds, scene.index.bounds(stroke->id));
+
+        sf::Vector2f center((bounds.minX + bounds.maxX) / 2.0f, (bounds.minY + bounds.maxY) / 2.0f);
+        sf::View view(center, sf::Vector2f(800.0f, 800.0f));
+        Selection selection;
+        auto renderFrame = [&]() {
+            if (!rendering) return;
+            target.setView(view);
+            target.clear();
+            scene.render(target, selection);
+            target.display();
+        };
+        renderFrame();
+        finishDrawing(target);
+
+        // Back and forth through the middle of the drawing
+        double edit = 0.0, worstEdit = 0.0;
+        auto start = Clock::now();
+        for (int dab = 0; dab < DABS; ++dab) {
+            float t = static_cast<float>(dab % 100) / 99.0f;
+            float x = dab < 100 ? bounds.minX + t * (bounds.maxX - bounds.minX) : bounds.maxX - t * (bounds.maxX - bounds.minX);
+            float y = center.y + (dab < 100 ? 0.0f : 3.0f * RADIUS);
+            auto editStart = Clock::now();
+            scene.erase(sf::Vector2f(x, y), RADIUS, dab > 0);
+            double ms = millisecondsSince(editStart);
+            edit += ms;
+            worstEdit = max(worstEdit, ms);
+            renderFrame();
+        }
+        if (rendering) finishDrawing(target);
+        printf("%zu stroke%s: erase %.3f ms avg, %.3f ms max; with tiles re-rendered %.3f ms per frame; %zu strokes left\n",
+               strokeCount, strokeCount == 1 ? "" : "s", edit / DABS, worstEdit,
+               rendering ? millisecondsSince(start) / DABS : 0.0, StrokeCount(scene.history.current()));
+    }
+}
+
+int main() {
+    benchmarkStrokeBvh();
+    benchmarkArcLengthPlacement();
+    benchmarkPerStrokeLayout();
+    benchmarkShapeFill();
+    benchmarkTextLayout();
+    benchmarkStippling();
+    benchmarkShapeRecognition();
+    benchmarkIconPhysics();
+    benchmarkGridAssignment();
+    bool assignmentOk = benchmarkIconAssignment();
+    benchmarkIconPreview();
+    benchmarkIconAtlas();
+    benchmarkTessellation();
+    benchmarkSoftwareRaster();
+    benchmarkBatchedRendering();
+    benchmarkTiledCanvas();
+    benchmarkEraser();
+    return assignmentOk ? 0 : 1;
+}
@@ -0,0 +1,402 @@
+#ifndef CANVAS_SCENE_H
+#define CANVAS_SCENE_H
+
+#include <SFML/Graphics/CircleShape.hpp>
+#include <SFML/Graphics/RectangleShape.hpp>
+#include <SFML/Graphics/RenderTarget.hpp>
+#include <istream>
+#include <map>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "eraser.h"
+#include "selection.h"
+#include "shape_recognition.h"
+#include "spatial_grid.h"
+#include "stroke_batch.h"
+#include "stroke_bvh.h"
+#include "stroke_history.h"
+#include "stroke_tessellator.h"
+#include "tile_cache.h"
+
+// The drawing and everything needed to show it: the history, the vertex
+// batch, the raster tiles and the spatial indexes, kept in step by every
+// edit. The window and the headless render tests drive the same scene.
+//
+// While recording, every edit is written to a text session, one operation
+// per line, and replaying that session into a fresh scene rebuilds the same
+// drawing frame by frame. Strokes are referred to by their position in the
+// drawing (oldest first), which does not depend on how ids were handed out.
+class CanvasScene {
+public:
+    CanvasScene(const StrokeStyle& style, float maxLineWidth, float cellSize)
+        : batch(style, sf::Color::White), layer(style.miterLimit * maxLineWidth / 2.0f),
+          grid(cellSize, maxLineWidth / 2.0f), index(maxLineWidth / 2.0f),
+          style(style), liveTessellator(style, sf::Color::White) {}
+
+    // Starts writing operations to out (nullptr stops). The current drawing
+    // is written first so the session replays from an empty canvas.
+    void record(std::ostream* out) {
+        recording = out;
+        if (!recording) return;
+        recording->precision(9);
+        *recording << "style " << static_cast<int>(style.join) << "\n";
+        for (const auto& stroke : CollectStrokes(history.current())) {
+            *recording << "begin\n";
+            std::vector<sf::Vector2f> points = stroke->worldPoints();
+            float scale = TransformScale(stroke->transform);
+            for (size_t i = 0; i < points.size(); ++i) {
+                *recording << "point " << points[i].x << " " << points[i].y << " " << stroke->widths()[i] * scale
+                           << " " << stroke->times()[i] << "\n";
+            }
+            *recording << "end\n";
+        }
+    }
+
+    bool isRecording() const { return recording != nullptr; }
+
+    // The stroke being drawn
+    void beginStroke() {
+        log("begin");
+        currentStroke.clear();
+        liveTessellator.reset();
+        batch.cancelLive();
+        index.updateLive(currentStroke.points);
+    }
+
+    void addPoint(sf::Vector2f point, float width, float time) {
+        if (recording) *recording << "point " << point.x << " " << point.y << " " << width << " " << time << "\n";
+        currentStroke.push(point, width, time);
+        size_t changed = liveTessellator.append(currentStroke);
+        batch.updateLive(liveTessellator.strip(), changed);
+        index.updateLive(currentStroke.points);
+    }
+
+    // Commits the stroke being drawn; returns nullptr if it was too short
+    StrokePtr endStroke() {
+        log("end");
+        StrokePtr stroke;
+        if (currentStroke.size() >= 2) {
+            stroke = history.commit(std::move(currentStroke));
+            batch.commitLive(stroke, liveTessellator);
+            layer.addStroke(stroke->id);
+            grid.insert(stroke);
+            index.insert(stroke);
+        } else {
+            batch.cancelLive();
+        }
+        currentStroke.clear();
+        liveTessellator.reset();
+        index.updateLive(currentStroke.points);
+        return stroke;
+    }
+
+    const StrokeSamples& liveStroke() const { return currentStroke; }
+
+    bool undo() { return step(true); }
+    bool redo() { return step(false); }
+
+    // Removes every stroke as one undoable edit
+    bool clear() {
+        log("clear");
+        currentStroke.clear();
+        liveTessellator.reset();
+        batch.cancelLive();
+        index.updateLive(currentStroke.points);
+        if (!history.clear()) return false;
+        batch.clear();
+        layer.invalidateAll();
+        grid.clear();
+        index.clear();
+        return true;
+    }
+
+    // Cuts everything under a circle; merge joins the previous erase's undo
+    // entry. The pieces take over what the batch, the BVH and the grid hold
+    // for the stroke they came from, so a dab costs what it changes near the
+    // circle, and only the tiles under the triangles that changed go stale.
+    bool erase(sf::Vector2f center, float radius, bool merge) {
+        if (recording) *recording << "erase " << center.x << " " << center.y << " " << radius << " " << merge << "\n";
+        StrokeDelta delta;
+        std::vector<StrokeCut> cuts;
+        if (!EraseAt(history, grid, center, radius, merge, delta, &cuts)) return false;
+        auto added = delta.added.begin();
+        for (const auto& cut : cuts) {
+            std::vector<StrokePtr> pieces(added, added + cut.pieces.size());
+            added += cut.pieces.size();
+            if (cut.stroke->transform != sf::Transform::Identity) {
+                // The pieces have the transform baked in, so nothing carries over
+                apply(StrokeDelta{pieces, {cut.stroke}});
+                continue;
+            }
+            layer.invalidate(batch.split(cut.stroke, pieces, cut.pieces));
+            layer.replaceStroke(cut.stroke->id, pieces);
+            index.split(cut.stroke, pieces, cut.pieces);
+            grid.split(cut.stroke, pieces, cut.pieces);
+        }
+        return true;
+    }
+
+    std::vector<StrokePtr> retransform(const std::vector<StrokePtr>& strokes, const sf::Transform& transform) {
+        if (recording) {
+            const float* m = transform.getMatrix();
+            *recording << "transform " << m[0] << " " << m[4] << " " << m[12] << " " << m[1] << " " << m[5] << " "
+                       << m[13] << " " << m[3] << " " << m[7] << " " << m[15];
+            writePositions(strokes);
+        }
+        StrokeDelta delta;
+        delta.removed = strokes;
+        delta.added = history.retransform(strokes, transform, false);
+        apply(delta);
+        return delta.added;
+    }
+
+    std::vector<StrokePtr> bake(const std::vector<StrokePtr>& strokes) {
+        if (recording) {
+            *recording << "bake";
+            writePositions(strokes);
+        }
+        StrokeDelta delta;
+        delta.removed = strokes;
+        delta.added = history.bake(strokes);
+        apply(delta);
+        return delta.added;
+    }
+
+    // Replaces the strokes recognized as lines, circles, ellipses, rectangles
+    // or polygons with their ideal shapes as one edit; the rest stay as drawn.
+    // merge joins the previous edit, so a stroke straightened as it is
+    // finished goes away in one undo. Returns what each stroke was recognized as.
+    std::vector<RecognizedShape> regularize(const std::vector<StrokePtr>& strokes, bool merge) {
+        if (recording) {
+            *recording << "regularize " << merge;
+            writePositions(strokes);
+        }
+        std::vector<RecognizedShape> shapes;
+        std::vector<StrokePtr> replaced;
+        std::vector<StrokeSamples> ideal;
+        for (const auto& stroke : strokes) {
+            shapes.push_back(RecognizeShape(stroke->worldPoints()));
+            if (shapes.back().kind == ShapeKind::None) continue;
+            StrokeSamples samples = ShapeSamples(*stroke, shapes.back());
+            if (samples.size() < 2) continue;
+            replaced.push_back(stroke);
+            ideal.push_back(std::move(samples));
+        }
+        if (replaced.empty()) return shapes;
+        StrokeDelta delta;
+        delta.removed = replaced;
+        delta.added = history.replace(replaced, std::move(ideal), merge);
+        apply(delta);
+        return shapes;
+    }
+
+    // Re-tessellates every stroke with a new style
+    void setStyle(const StrokeStyle& newStyle) {
+        if (recording) *recording << "style " << static_cast<int>(newStyle.join) << "\n";
+        style = newStyle;
+        liveTessellator = StrokeTessellator(style, sf::Color::White);
+        batch.setStyle(style);
+        layer.invalidateAll();
+    }
+
+    const StrokeStyle& strokeStyle() const { return style; }
+
+    // Marks a rendered frame in the session
+    void frameRendered() { log("frame"); }
+
+    // Finished strokes come from the cached tiles under the target's view, with the
+    // live stroke on top. Strokes being dragged are kept off the tiles and drawn with
+    // the drag transform, followed by the selection bounds and handles, which keep
+    // their size on screen at any zoom.
+    void render(sf::RenderTarget& target, const Selection& selection) {
+        float unitsPerPixel = target.getView().getSize().x / target.getSize().x;
+        bool dragging = selection.transforming();
+        std::unordered_set<uint32_t> draggedIds;
+        if (dragging) {
+            for (const auto& stroke : selection.strokes) draggedIds.insert(stroke->id);
+        }
+        layer.update(batch, index, draggedIds, target.getView(), target.getSize());
+        layer.draw(target);
+        batch.drawLive(target);
+
+        if (!selection.empty()) {
+            sf::RenderStates dragStates;
+            dragStates.transform = selection.dragTransform;
+            if (dragging) {
+                for (const auto& stroke : selection.strokes) batch.drawStroke(target, stroke->id, dragStates);
+            }
+
+            sf::RectangleShape outline(sf::Vector2f(selection.bounds.maxX - selection.bounds.minX, selection.bounds.maxY - selection.bounds.minY));
+            outline.setPosition(sf::Vector2f(selection.bounds.minX, selection.bounds.minY));
+            outline.setFillColor(sf::Color::Transparent);
+            outline.setOutlineColor(sf::Color(100, 160, 255));
+            outline.setOutlineThickness(unitsPerPixel);
+            target.draw(outline, dragStates);
+
+            float handleSize = HANDLE_SIZE * unitsPerPixel;
+            for (const auto& corner : selection.scaleHandles()) {
+                sf::RectangleShape handle(sf::Vector2f(handleSize, handleSize));
+                handle.setOrigin(sf::Vector2f(handleSize / 2.0f, handleSize / 2.0f));
+                handle.setPosition(dragStates.transform.transformPoint(corner));
+                handle.setFillColor(sf::Color(100, 160, 255));
+                target.draw(handle);
+            }
+
+            sf::CircleShape rotateHandle(handleSize / 2.0f);
+            rotateHandle.setOrigin(sf::Vector2f(handleSize / 2.0f, handleSize / 2.0f));
+            rotateHandle.setPosition(dragStates.transform.transformPoint(selection.rotateHandle(unitsPerPixel)));
+            rotateHandle.setFillColor(sf::Color(100, 160, 255));
+            target.draw(rotateHandle);
+        }
+
+        // Rubber-band rectangle while box-selecting
+        if (selection.drag == SelectionDrag::Box) {
+            Box box = selection.dragBox();
+            sf::RectangleShape band(sf::Vector2f(box.maxX - box.minX, box.maxY - box.minY));
+            band.setPosition(sf::Vector2f(box.minX, box.minY));
+            band.setFillColor(sf::Color(100, 160, 255, 40));
+            band.setOutlineColor(sf::Color(100, 160, 255));
+            band.setOutlineThickness(unitsPerPixel);
+            target.draw(band);
+        }
+    }
+
+    // Applies an undo/redo/erase/transform delta to the stroke batch, the segment grid and
+    // the stroke BVH, touching only the affected strokes. A stroke that only got a new
+    // transform keeps its place in the batch and its chunk boxes. The tiles under the old
+    // and new bounds of every affected stroke are re-rendered.
+    void apply(const StrokeDelta& delta) {
+        std::map<const std::vector<sf::Vector2f>*, StrokePtr> removedGeometry;
+        for (const auto& stroke : delta.removed) {
+            layer.invalidate(index.bounds(stroke->id));
+            removedGeometry[&stroke->points()] = stroke;
+            grid.remove(stroke);
+        }
+        for (const auto& stroke : delta.added) {
+            auto moved = removedGeometry.find(&stroke->points());
+            if (moved != removedGeometry.end()) {
+                batch.retransform(moved->second, stroke);
+                index.retransform(moved->second, stroke);
+                removedGeometry.erase(moved);
+            } else {
+                batch.add(stroke);
+                index.insert(stroke);
+            }
+            grid.insert(stroke);
+            layer.invalidate(index.bounds(stroke->id));
+        }
+        for (const auto& [geometry, stroke] : removedGeometry) {
+            batch.remove(stroke);
+            index.remove(stroke);
+        }
+    }
+
+    StrokeHistory history;
+    StrokeBatch batch;
+    TiledStrokeLayer layer;
+    SegmentGrid grid;
+    StrokeIndex index;
+
+private:
+    bool step(bool backwards) {
+        log(backwards ? "undo" : "redo");
+        StrokeDelta delta;
+        if (!(backwards ? history.undo(delta) : history.redo(delta))) return false;
+        apply(delta);
+        return true;
+    }
+
+    void log(const char* operation) {
+        if (recording) *recording << operation << "\n";
+    }
+
+    void writePositions(const std::vector<StrokePtr>& strokes) {
+        std::vector<StrokePtr> all = CollectStrokes(history.current());
+        std::unordered_set<uint32_t> ids;
+        for (const auto& stroke : strokes) ids.insert(stroke->id);
+        for (size_t i = 0; i < all.size(); ++i) {
+            if (ids.count(all[i]->id)) *recording << " " << i;
+        }
+        *recording << "\n";
+    }
+
+    StrokeStyle style;
+    StrokeSamples currentStroke;
+    StrokeTessellator liveTessellator;
+    std::ostream* recording = nullptr;
+};
+
+// Replays a recorded session into scene, calling onFrame(scene) at every
+// recorded frame. Returns the number of operations that could not be parsed.
+template <typename FrameCallback>
+size_t ReplaySession(std::istream& session, CanvasScene& scene, FrameCallback onFrame) {
+    auto pickStrokes = [&](std::istringstream& in) {
+        std::vector<StrokePtr> all = CollectStrokes(scene.history.current());
+        std::vector<StrokePtr> picked;
+        for (size_t i; in >> i;) {
+            if (i < all.size()) picked.push_back(all[i]);
+        }
+        return picked;
+    };
+
+    size_t errors = 0;
+    std::string line;
+    while (std::getline(session, line)) {
+        std::istringstream in(line);
+        std::string operation;
+        if (!(in >> operation)) continue;
+        if (operation == "begin") {
+            scene.beginStroke();
+        } else if (operation == "point") {
+            sf::Vector2f p;
+            float width, time;
+            if (in >> p.x >> p.y >> width >> time) scene.addPoint(p, width, time);
+            else ++errors;
+        } else if (operation == "end") {
+            scene.endStroke();
+        } else if (operation == "undo") {
+            scene.undo();
+        } else if (operation == "redo") {
+            scene.redo();
+        } else if (operation == "clear") {
+            scene.clear();
+        } else if (operation == "erase") {
+            sf::Vector2f p;
+            float radius;
+            bool merge;
+            if (in >> p.x >> p.y >> radius >> merge) scene.erase(p, radius, merge);
+            else ++errors;
+        } else if (operation == "transform") {
+            float m[9];
+            bool ok = true;
+            for (float& v : m) ok = ok && static_cast<bool>(in >> v);
+            if (ok) scene.retransform(pickStrokes(in), sf::Transform(m[0], m[1], m[2], m[3], m[4], m[5], m[6], m[7], m[8]));
+            else ++errors;
+        } else if (operation == "bake") {
+            scene.bake(pickStrokes(in));
+        } else if (operation == "regularize") {
+            bool merge;
+            if (in >> merge) scene.regularize(pickStrokes(in), merge);
+            else ++errors;
+        } else if (operation == "style") {
+            int join;
+            if (in >> join && join >= 0 && join < 3) {
+                StrokeStyle style = scene.strokeStyle();
+                style.join = static_cast<JoinStyle>(join);
+                scene.setStyle(style);
+            } else {
+                ++errors;
+            }
+        } else if (operation == "frame") {
+            onFrame(scene);
+        } else {
+            ++errors;
+        }
+    }
+    return errors;
+}
+
+#endif // CANVAS_SCENE_H
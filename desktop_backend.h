@@ -0,0 +1,192 @@
+#ifndef DESKTOP_BACKEND_H
+#define DESKTOP_BACKEND_H
+
+#include <SFML/Graphics/Image.hpp>
+#include <SFML/System/Clock.hpp>
+#include <SFML/System/Time.hpp>
+#include <SFML/System/Vector2.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include "desktop_functions.h"
+#endif
+
+// One icon on the desktop, in screen pixels
+struct IconRecord {
+    std::wstring name;
+    sf::Vector2i position;
+    int index;
+};
+
+// An icon and where to put it
+struct IconMove {
+    int index;
+    sf::Vector2i position;
+};
+
+// Where desktop icons come from and go to. The app talks to the real desktop;
+// benchmarks and test programs use SimulatedDesktop so they run anywhere.
+class DesktopBackend {
+public:
+    virtual ~DesktopBackend() = default;
+
+    virtual std::vector<IconRecord> icons() = 0;
+    virtual bool moveIcon(int index, sf::Vector2i position) = 0;
+    // Several moves as one update; returns how many succeeded
+    virtual size_t moveIcons(const std::vector<IconMove>& moves) {
+        size_t moved = 0;
+        for (const IconMove& move : moves) moved += moveIcon(move.index, move.position);
+        return moved;
+    }
+    // The icon's picture, about size pixels square; an empty image if there is none
+    virtual sf::Image iconImage(const IconRecord& icon, unsigned size) = 0;
+    virtual sf::Vector2u screenSize() = 0;
+    // Distance between the cells of the grid icons snap to
+    virtual sf::Vector2i gridSpacing() = 0;
+};
+
+// An in-memory desktop. Icon pictures are read from <imageDir>/<name>.png when
+// that file exists, otherwise a placeholder is drawn so every icon has one.
+class SimulatedDesktop : public DesktopBackend {
+public:
+    explicit SimulatedDesktop(sf::Vector2u screen = {1920, 1080}, std::string imageDir = "")
+        : screen(screen), imageDir(std::move(imageDir)) {}
+
+    // count icons in Explorer's default column-major grid
+    static SimulatedDesktop grid(size_t count, sf::Vector2u screen = {1920, 1080}, std::string imageDir = "") {
+        SimulatedDesktop desktop(screen, std::move(imageDir));
+        sf::Vector2i cell = desktop.gridSpacing();
+        int rows = std::max(1, static_cast<int>(screen.y) / cell.y);
+        for (size_t i = 0; i < count; ++i) {
+            int column = static_cast<int>(i) / rows, row = static_cast<int>(i) % rows;
+            desktop.addIcon(L"Icon " + std::to_wstring(i), sf::Vector2i(column * cell.x, row * cell.y));
+        }
+        return desktop;
+    }
+
+    void addIcon(const std::wstring& name, sf::Vector2i position) {
+        desktop.push_back(IconRecord{name, position, static_cast<int>(desktop.size())});
+    }
+
+    std::vector<IconRecord> icons() override { return desktop; }
+
+    bool moveIcon(int index, sf::Vector2i position) override {
+        if (index < 0 || index >= static_cast<int>(desktop.size())) return false;
+        busyWait(moveLatency);
+        desktop[index].position = position;
+        ++moves;
+        return true;
+    }
+
+    size_t moveIcons(const std::vector<IconMove>& batch) override {
+        ++batches;
+        busyWait(batchLatency);
+        return DesktopBackend::moveIcons(batch);
+    }
+
+    // Makes moves take about as long as a round trip to Explorer would, so
+    // timing tests see a realistic cost; the wait spins, since sleeps are
+    // far coarser than a single move
+    void setMoveLatency(sf::Time perMove, sf::Time perBatch = sf::Time::Zero) {
+        moveLatency = perMove;
+        batchLatency = perBatch;
+    }
+
+    sf::Image iconImage(const IconRecord& icon, unsigned size) override {
+        ++imageRequests;
+        sf::Image image;
+        if (!imageDir.empty()) {
+            std::string file = imageDir + "/" + std::string(icon.name.begin(), icon.name.end()) + ".png";
+            if (image.loadFromFile(file)) return image;
+        }
+        // Placeholder: a rounded square in a colour hashed from the name
+        uint32_t hash = 2166136261u;
+        for (wchar_t c : icon.name) hash = (hash ^ static_cast<uint32_t>(c)) * 16777619u;
+        sf::Color color(64 + hash % 160, 64 + (hash >> 8) % 160, 64 + (hash >> 16) % 160);
+        image = sf::Image(sf::Vector2u(size, size), sf::Color::Transparent);
+        float corner = size / 5.0f, half = size / 2.0f;
+        for (unsigned y = 0; y < size; ++y) {
+            for (unsigned x = 0; x < size; ++x) {
+                float dx = std::max(std::abs(x + 0.5f - half) - (half - corner), 0.0f);
+                float dy = std::max(std::abs(y + 0.5f - half) - (half - corner), 0.0f);
+                if (dx * dx + dy * dy <= corner * corner) image.setPixel(sf::Vector2u(x, y), color);
+            }
+        }
+        return image;
+    }
+
+    sf::Vector2u screenSize() override { return screen; }
+    // Explorer's default spacing for large icons at 100% scaling
+    sf::Vector2i gridSpacing() override { return sf::Vector2i(76, 96); }
+
+    // Calls made so far, to check how much work a caller asks of the desktop
+    size_t moveCount() const { return moves; }
+    size_t batchCount() const { return batches; }
+    size_t imageRequestCount() const { return imageRequests; }
+
+private:
+    static void busyWait(sf::Time duration) {
+        if (duration <= sf::Time::Zero) return;
+        sf::Clock clock;
+        while (clock.getElapsedTime() < duration) {}
+    }
+
+    sf::Vector2u screen;
+    std::string imageDir;
+    std::vector<IconRecord> desktop;
+    size_t moves = 0;
+    size_t batches = 0;
+    size_t imageRequests = 0;
+    sf::Time moveLatency, batchLatency;
+};
+
+#ifdef _WIN32
+// The real desktop, through the ListView functions in desktop_functions.h
+class WindowsDesktop : public DesktopBackend {
+public:
+    std::vector<IconRecord> icons() override {
+        std::vector<IconRecord> records;
+        for (const DesktopIcon& icon : GetDesktopIcons()) {
+            records.push_back(IconRecord{icon.name, sf::Vector2i(icon.position.x, icon.position.y), icon.index});
+        }
+        return records;
+    }
+
+    bool moveIcon(int index, sf::Vector2i position) override {
+        return MoveDesktopIcon(index, position.x, position.y);
+    }
+
+    size_t moveIcons(const std::vector<IconMove>& moves) override {
+        std::vector<int> indices;
+        std::vector<POINT> positions;
+        for (const IconMove& move : moves) {
+            indices.push_back(move.index);
+            positions.push_back(POINT{move.position.x, move.position.y});
+        }
+        return static_cast<size_t>(MoveDesktopIcons(indices, positions));
+    }
+
+    // The shell hands out its large icons at a fixed size, so size is only a hint
+    sf::Image iconImage(const IconRecord& icon, unsigned) override {
+        int width = 0, height = 0;
+        std::vector<unsigned char> rgba;
+        if (!GetDesktopIconImage(icon.name, width, height, rgba)) return sf::Image();
+        return sf::Image(sf::Vector2u(width, height), rgba.data());
+    }
+
+    sf::Vector2u screenSize() override {
+        return sf::Vector2u(GetSystemMetrics(SM_CXSCREEN), GetSystemMetrics(SM_CYSCREEN));
+    }
+
+    sf::Vector2i gridSpacing() override {
+        int cx = 0, cy = 0;
+        if (!GetDesktopIconSpacing(cx, cy)) return sf::Vector2i(76, 96);
+        return sf::Vector2i(cx, cy);
+    }
+};
+#endif
+
+#endif // DESKTOP_BACKEND_H
@@ -3,6 +3,8 @@
 
 #include <windows.h>
 #include <commctrl.h>
+#include <shellapi.h>
+#include <shlobj.h>
 #include <iostream>
 #include <vector>
 
@@ -209,7 +211,93 @@ int GetDesktopIconCount() {
     return ListView_GetItemCount(lv);
 }
 
-#endif // DESKTOP_FUNCTIONS_H
+// Get the desktop ListView's icon spacing: the size of the grid icons snap to
+bool GetDesktopIconSpacing(int& cx, int& cy) {
+    HWND lv = GetDesktopListView();
+    if (!lv) return false;
+    DWORD spacing = static_cast<DWORD>(SendMessageW(lv, LVM_GETITEMSPACING, FALSE, 0));
+    cx = LOWORD(spacing);
+    cy = HIWORD(spacing);
+    return cx > 0 && cy > 0;
+}
+
+// Get the shell's large icon for a desktop item as top-down RGBA pixels.
+// The item is looked up by its display name in the user's and the public desktop
+// folders; items that aren't files (Recycle Bin, ...) get the generic file icon.
+bool GetDesktopIconImage(const std::wstring& name, int& width, int& height, std::vector<unsigned char>& rgba) {
+    // Step 1: Find the file behind the icon (display names usually hide the extension)
+    std::wstring path;
+    const int folders[] = { CSIDL_DESKTOPDIRECTORY, CSIDL_COMMON_DESKTOPDIRECTORY };
+    for (int folder : folders) {
+        wchar_t dir[MAX_PATH] = L"";
+        if (FAILED(SHGetFolderPathW(NULL, folder, NULL, SHGFP_TYPE_CURRENT, dir))) continue;
+        std::wstring exact = std::wstring(dir) + L"\\" + name;
+        if (GetFileAttributesW(exact.c_str()) != INVALID_FILE_ATTRIBUTES) {
+            path = exact;
+            break;
+        }
+        WIN32_FIND_DATAW found;
+        HANDLE search = FindFirstFileW((exact + L".*").c_str(), &found);
+        if (search != INVALID_HANDLE_VALUE) {
+            path = std::wstring(dir) + L"\\" + found.cFileName;
+            FindClose(search);
+            break;
+        }
+    }
+
+    // Step 2: Ask the shell for the icon
+    SHFILEINFOW info = {0};
+    DWORD_PTR ok = path.empty()
+        ? SHGetFileInfoW(L"file", FILE_ATTRIBUTE_NORMAL, &info, sizeof(info), SHGFI_ICON | SHGFI_LARGEICON | SHGFI_USEFILEATTRIBUTES)
+        : SHGetFileInfoW(path.c_str(), 0, &info, sizeof(info), SHGFI_ICON | SHGFI_LARGEICON);
+    if (!ok || !info.hIcon) {
+        std::wcerr << L"SHGetFileInfoW failed for \"" << name << L"\"" << std::endl;
+        return false;
+    }
+
+    // Step 3: Read the icon's color bitmap as 32-bit top-down pixels
+    ICONINFO iconInfo = {0};
+    bool success = false;
+    if (GetIconInfo(info.hIcon, &iconInfo)) {
+        BITMAP bitmap = {0};
+        HBITMAP source = iconInfo.hbmColor ? iconInfo.hbmColor : iconInfo.hbmMask;
+        if (GetObjectW(source, sizeof(bitmap), &bitmap)) {
+            width = bitmap.bmWidth;
+            height = iconInfo.hbmColor ? bitmap.bmHeight : bitmap.bmHeight / 2;
+            BITMAPINFO bmi = {0};
+            bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+            bmi.bmiHeader.biWidth = width;
+            bmi.bmiHeader.biHeight = -height; // top-down
+            bmi.bmiHeader.biPlanes = 1;
+            bmi.bmiHeader.biBitCount = 32;
+            bmi.bmiHeader.biCompression = BI_RGB;
+
+            std::vector<unsigned char> bgra(static_cast<size_t>(width) * height * 4);
+            HDC dc = GetDC(NULL);
+            if (iconInfo.hbmColor && GetDIBits(dc, iconInfo.hbmColor, 0, height, bgra.data(), &bmi, DIB_RGB_COLORS)) {
+                // Step 4: Convert to RGBA; icons without alpha take it from the mask
+                bool hasAlpha = false;
+                for (size_t i = 3; i < bgra.size(); i += 4) hasAlpha = hasAlpha || bgra[i] != 0;
+                std::vector<unsigned char> mask(bgra.size());
+                if (!hasAlpha) GetDIBits(dc, iconInfo.hbmMask, 0, height, mask.data(), &bmi, DIB_RGB_COLORS);
+                rgba.resize(bgra.size());
+                for (size_t i = 0; i < bgra.size(); i += 4) {
+                    rgba[i] = bgra[i + 2];
+                    rgba[i + 1] = bgra[i + 1];
+                    rgba[i + 2] = bgra[i];
+                    rgba[i + 3] = hasAlpha ? bgra[i + 3] : (mask[i] ? 0 : 255);
+                }
+                success = true;
+            }
+            ReleaseDC(NULL, dc);
+        }
+        if (iconInfo.hbmColor) DeleteObject(iconInfo.hbmColor);
+        if (iconInfo.hbmMask) DeleteObject(iconInfo.hbmMask);
+    }
+    DestroyIcon(info.hIcon);
+    return success;
+}
+
 
 // Move a desktop icon by index to a new position (desktop coordinates)
 inline bool MoveDesktopIcon(int iconIndex, int newX, int newY) {
@@ -241,3 +329,23 @@ inline bool MoveDesktopIcon(int iconIndex, int newX, int newY) {
     // LVM_SETITEMPOSITION returns TRUE on success
     return res != 0;
 }
+
+// Moves many icons with one ListView lookup and no logging, for animations
+// that move icons every frame. Painting is held off until the whole batch is
+// in, so Explorer repaints once per batch instead of once per icon.
+// Returns how many icons moved.
+inline int MoveDesktopIcons(const std::vector<int>& indices, const std::vector<POINT>& positions) {
+    HWND lv = GetDesktopListView();
+    if (!lv) return 0;
+
+    int moved = 0;
+    SendMessageW(lv, WM_SETREDRAW, FALSE, 0);
+    for (size_t i = 0; i < indices.size() && i < positions.size(); ++i) {
+        if (SendMessageW(lv, LVM_SETITEMPOSITION, indices[i], MAKELPARAM(positions[i].x, positions[i].y))) ++moved;
+    }
+    SendMessageW(lv, WM_SETREDRAW, TRUE, 0);
+    InvalidateRect(lv, nullptr, TRUE);
+    return moved;
+}
+
+#endif // DESKTOP_FUNCTIONS_H
@@ -0,0 +1,160 @@
+#ifndef ERASER_H
+#define ERASER_H
+
+#include <SFML/System/Vector2.hpp>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "spatial_grid.h"
+#include "stroke_history.h"
+
+// Finds the part [t0, t1] of segment a-b that lies inside the circle.
+// Returns false if the segment misses the circle.
+inline bool SegmentCircleOverlap(sf::Vector2f a, sf::Vector2f b, sf::Vector2f center, float radius, float& t0, float& t1) {
+    sf::Vector2f d = b - a;
+    sf::Vector2f f = a - center;
+    float qa = d.x * d.x + d.y * d.y;
+    float qb = 2.0f * (f.x * d.x + f.y * d.y);
+    float qc = f.x * f.x + f.y * f.y - radius * radius;
+
+    if (qa <= 0.0f) {
+        t0 = 0.0f;
+        t1 = 1.0f;
+        return qc <= 0.0f;
+    }
+
+    float disc = qb * qb - 4.0f * qa * qc;
+    if (disc < 0.0f) return false;
+    float root = std::sqrt(disc);
+    t0 = std::max(0.0f, (-qb - root) / (2.0f * qa));
+    t1 = std::min(1.0f, (-qb + root) / (2.0f * qa));
+    return t0 <= t1;
+}
+
+// Cuts the circle out of a stroke. hitSegments are the (sorted) segments the
+// grid reported under the eraser; all others are kept whole and copied over
+// in runs. Segments that only partly overlap are shortened to the circle's
+// edge, with widths and times interpolated. The pieces are in canvas
+// coordinates, so erasing bakes the stroke's transform. origins, if given,
+// receives where each piece lies in the stroke.
+inline std::vector<StrokeSamples> SplitStroke(const Stroke& stroke, const std::vector<uint32_t>& hitSegments, sf::Vector2f center, float radius,
+                                              std::vector<PieceOrigin>* origins = nullptr) {
+    std::vector<StrokeSamples> pieces;
+    StrokeSamples piece;
+    PieceOrigin origin;
+    bool identity = stroke.transform == sf::Transform::Identity;
+    std::vector<sf::Vector2f> world;
+    if (!identity) world = stroke.worldPoints();
+    const std::vector<sf::Vector2f>& points = identity ? stroke.points() : world;
+    const auto& widths = stroke.widths();
+    const auto& times = stroke.times();
+    float scale = TransformScale(stroke.transform);
+
+    // Sample at parameter t along segment i
+    auto pushSample = [&](size_t i, float t) {
+        bool clipped = t > 0.0f && t < 1.0f;
+        if (piece.size() == 0) origin = PieceOrigin{t >= 1.0f ? i + 1 : i, clipped, false};
+        origin.clippedEnd = clipped;
+        if (!clipped) {
+            size_t j = t > 0.0f ? i + 1 : i;
+            piece.push(points[j], widths[j] * scale, times[j]);
+            return;
+        }
+        piece.push(points[i] + (points[i + 1] - points[i]) * t,
+                   (widths[i] + (widths[i + 1] - widths[i]) * t) * scale,
+                   times[i] + (times[i + 1] - times[i]) * t);
+    };
+
+    // Segments [first, end) kept whole
+    auto pushSegments = [&](size_t first, size_t end) {
+        if (first >= end) return;
+        if (piece.size() == 0) pushSample(first, 0.0f);
+        origin.clippedEnd = false;
+        piece.points.insert(piece.points.end(), points.begin() + first + 1, points.begin() + end + 1);
+        piece.times.insert(piece.times.end(), times.begin() + first + 1, times.begin() + end + 1);
+        if (scale == 1.0f) {
+            piece.widths.insert(piece.widths.end(), widths.begin() + first + 1, widths.begin() + end + 1);
+        } else {
+            for (size_t j = first + 1; j <= end; ++j) piece.widths.push_back(widths[j] * scale);
+        }
+    };
+
+    auto finishPiece = [&]() {
+        if (piece.size() >= 2) {
+            pieces.push_back(std::move(piece));
+            if (origins) origins->push_back(origin);
+        }
+        piece.clear();
+    };
+
+    size_t segmentCount = points.size() > 1 ? points.size() - 1 : 0;
+    size_t next = 0;
+    for (uint32_t i : hitSegments) {
+        if (i < next || i >= segmentCount) continue;
+        pushSegments(next, i);
+        next = i + 1;
+
+        float t0 = 0.0f, t1 = 0.0f;
+        if (!SegmentCircleOverlap(points[i], points[i + 1], center, radius, t0, t1)) {
+            pushSegments(i, i + 1);
+            continue;
+        }
+
+        if (t0 > 0.0f) {
+            if (piece.size() == 0) pushSample(i, 0.0f);
+            pushSample(i, t0);
+        }
+        finishPiece();
+        if (t1 < 1.0f) {
+            pushSample(i, t1);
+            pushSample(i, 1.0f);
+        }
+    }
+    pushSegments(next, segmentCount);
+    finishPiece();
+    return pieces;
+}
+
+// A stroke the eraser cut, and where the pieces that replaced it came from
+struct StrokeCut {
+    StrokePtr stroke;
+    std::vector<PieceOrigin> pieces;
+};
+
+// Erases everything within radius of center. Only strokes with segments in
+// the grid cells under the eraser are touched. On success delta holds the
+// strokes that were removed and the pieces that replaced them, and cuts (if
+// given) each removed stroke with the origins of its pieces, which come in
+// the same order in delta.added.
+inline bool EraseAt(StrokeHistory& history, const SegmentGrid& grid, sf::Vector2f center, float radius, bool merge, StrokeDelta& delta,
+                    std::vector<StrokeCut>* cuts = nullptr) {
+    std::vector<SegmentRef> hits = grid.query(center, radius);
+    if (hits.empty()) return false;
+
+    float reach = radius + grid.linePadding();
+    std::vector<StrokePtr> removed;
+    std::vector<StrokeSamples> added;
+
+    // Hits come sorted by stroke, then segment
+    for (size_t begin = 0; begin < hits.size();) {
+        size_t end = begin;
+        std::vector<uint32_t> segments;
+        while (end < hits.size() && hits[end].strokeId == hits[begin].strokeId) {
+            segments.push_back(hits[end++].index);
+        }
+
+        StrokePtr stroke = grid.stroke(hits[begin].strokeId);
+        StrokeCut cut{stroke, {}};
+        auto pieces = SplitStroke(*stroke, segments, center, reach, &cut.pieces);
+        removed.push_back(stroke);
+        for (auto& piece : pieces) added.push_back(std::move(piece));
+        if (cuts) cuts->push_back(std::move(cut));
+        begin = end;
+    }
+
+    delta.removed = removed;
+    delta.added = history.replace(removed, std::move(added), merge);
+    return true;
+}
+
+#endif // ERASER_H
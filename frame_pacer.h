@@ -0,0 +1,133 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <SFML/System/Clock.hpp>
+#include <SFML/System/Sleep.hpp>
+#include <SFML/System/Time.hpp>
+#include <SFML/Window/Event.hpp>
+#include <SFML/Window/WindowBase.hpp>
+#include <algorithm>
+#include <optional>
+#include <vector>
+
+// Time from an input event arriving to the end of the frame that showed it
+struct LatencyStats {
+    std::vector<float> samples; // milliseconds
+
+    void add(sf::Time latency) { samples.push_back(latency.asSeconds() * 1000.0f); }
+    void reset() { samples.clear(); }
+    size_t count() const { return samples.size(); }
+
+    float average() const {
+        float total = 0.0f;
+        for (float s : samples) total += s;
+        return samples.empty() ? 0.0f : total / samples.size();
+    }
+
+    // p in [0, 1], e.g. 0.95 for the 95th percentile
+    float percentile(float p) const {
+        if (samples.empty()) return 0.0f;
+        std::vector<float> sorted = samples;
+        size_t rank = std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()));
+        std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+        return sorted[rank];
+    }
+};
+
+// Decides when the main loop waits, polls and renders. When nothing is being
+// drawn or animated the loop blocks in waitEvent (waking after idleTimeout at
+// the latest) and only renders if an event came in, so an untouched canvas
+// costs next to no CPU. While active it renders at targetRate, sleeping
+// until each frame's deadline; a late frame moves the schedule forward
+// instead of trying to catch up with a burst of frames.
+class FramePacer {
+public:
+    explicit FramePacer(float targetRate = 120.0f, sf::Time idleTimeout = sf::milliseconds(500))
+        : idleTimeout(idleTimeout) {
+        setTargetRate(targetRate);
+    }
+
+    void setTargetRate(float rate) {
+        framePeriod = sf::seconds(1.0f / std::max(rate, 1.0f));
+    }
+
+    float targetRate() const { return 1.0f / framePeriod.asSeconds(); }
+
+    // With pacing off the loop spins as fast as it can, as it used to
+    void setEnabled(bool on) { enabled = on; }
+    bool isEnabled() const { return enabled; }
+
+    // First event of a frame: blocks while idle, otherwise just polls
+    std::optional<sf::Event> firstEvent(sf::WindowBase& window, bool active) {
+        if (!enabled || active || redrawRequested) return window.pollEvent();
+        ++idleWaits;
+        return window.waitEvent(idleTimeout);
+    }
+
+    // Every handled event may change what is on screen
+    void eventHandled() { redrawRequested = true; }
+
+    // Input that should show up on screen as soon as possible; latency is
+    // measured from the oldest input not shown yet
+    void inputArrived() {
+        if (!inputPending) {
+            inputPending = true;
+            inputTime = clock.getElapsedTime();
+        }
+        redrawRequested = true;
+    }
+
+    void requestRedraw() { redrawRequested = true; }
+
+    bool shouldRender(bool active) const {
+        return !enabled || active || redrawRequested;
+    }
+
+    // Call right after display()
+    void frameDisplayed() {
+        sf::Time now = clock.getElapsedTime();
+        if (inputPending) {
+            latencyStats.add(now - inputTime);
+            inputPending = false;
+        }
+        redrawRequested = false;
+        ++framesRendered;
+    }
+
+    // Sleeps until the next frame is due while active
+    void waitForNextFrame(bool active) {
+        sf::Time now = clock.getElapsedTime();
+        if (!enabled || !active) {
+            nextFrame = now;
+            return;
+        }
+        nextFrame += framePeriod;
+        if (nextFrame < now) {
+            nextFrame = now; // fell behind: start a fresh schedule
+            ++lateFrames;
+            return;
+        }
+        sf::sleep(nextFrame - now);
+    }
+
+    LatencyStats& latency() { return latencyStats; }
+    size_t frames() const { return framesRendered; }
+    size_t idleWaitCount() const { return idleWaits; }
+    size_t lateFrameCount() const { return lateFrames; }
+
+private:
+    sf::Clock clock;
+    sf::Time framePeriod;
+    sf::Time idleTimeout;
+    sf::Time nextFrame;
+    sf::Time inputTime;
+    bool enabled = true;
+    bool redrawRequested = true;
+    bool inputPending = false;
+    LatencyStats latencyStats;
+    size_t framesRendered = 0;
+    size_t idleWaits = 0;
+    size_t lateFrames = 0;
+};
+
+#endif // FRAME_PACER_H
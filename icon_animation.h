@@ -0,0 +1,183 @@
+#ifndef ICON_ANIMATION_H
+#define ICON_ANIMATION_H
+
+#include "desktop_backend.h"
+#include <SFML/System/Clock.hpp>
+#include <SFML/System/Time.hpp>
+#include <SFML/System/Vector2.hpp>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+enum class Easing { Linear, EaseOutCubic, EaseInOutCubic };
+
+// Share of the way along an icon's path at time t in [0, 1]
+inline float Ease(Easing easing, float t) {
+    t = std::clamp(t, 0.0f, 1.0f);
+    switch (easing) {
+    case Easing::EaseOutCubic: {
+        float u = 1.0f - t;
+        return 1.0f - u * u * u;
+    }
+    case Easing::EaseInOutCubic: {
+        if (t < 0.5f) return 4.0f * t * t * t;
+        float u = 2.0f - 2.0f * t;
+        return 1.0f - u * u * u / 2.0f;
+    }
+    default:
+        return t;
+    }
+}
+
+// An icon's trip from where it is to where it should end up, in screen pixels
+struct IconTransition {
+    int index;
+    sf::Vector2i from;
+    sf::Vector2i to;
+};
+
+struct AnimationSettings {
+    sf::Time duration = sf::milliseconds(600);
+    Easing easing = Easing::EaseInOutCubic;
+    // The longest one tick's moves may keep Explorer busy
+    sf::Time tickBudget = sf::milliseconds(10);
+    // Share of the time Explorer may spend moving icons; the rest is left
+    // for it to paint and answer input, so the desktop stays responsive
+    float dutyCycle = 0.25f;
+    float minTickRate = 10.0f;
+    float maxTickRate = 60.0f;
+};
+
+struct AnimationStats {
+    size_t ticks = 0;
+    size_t moves = 0;
+    size_t failedMoves = 0;
+    sf::Time ipcTime;   // spent in the desktop's move calls
+    sf::Time worstTick; // longest single tick's move calls
+    size_t ticksOverBudget = 0; // by half again or more; small overruns are just timer noise
+};
+
+// Moves desktop icons along eased paths instead of making them jump. Each
+// tick sends one batch of moves, as many as the tick budget allows at the
+// measured cost per move; when that is fewer than the icons that changed
+// position, the ones furthest behind go first. The tick rate follows the
+// cost too: cheap moves tick at the maximum rate, expensive ones tick less
+// often so the desktop still gets its idle share of the time. Every icon
+// ends exactly on its target, even if that takes a few ticks past the end.
+class IconAnimator {
+public:
+    explicit IconAnimator(DesktopBackend& desktop, AnimationSettings settings = {})
+        : desktop(desktop), config(settings) {}
+
+    void setSettings(const AnimationSettings& settings) { config = settings; }
+    const AnimationSettings& settings() const { return config; }
+
+    // Replaces any running animation; the first tick is due right away
+    void start(const std::vector<IconTransition>& transitions, sf::Time now) {
+        icons.clear();
+        for (const IconTransition& t : transitions) icons.push_back(Animated{t, t.from});
+        startTime = now;
+        dueTime = now;
+        running = !icons.empty();
+        statistics = AnimationStats();
+    }
+
+    // Drops the rest of the animation; icons stay wherever they were last sent
+    void stop() { running = false; }
+
+    // Sends the next tick's moves if one is due; returns whether the animation is still running
+    bool update(sf::Time now) {
+        if (!running || now < dueTime) return running;
+
+        bool lastFrame = now - startTime >= config.duration;
+        float progress = lastFrame ? 1.0f : Ease(config.easing, (now - startTime) / config.duration);
+        pending.clear();
+        for (size_t i = 0; i < icons.size(); ++i) {
+            const IconTransition& t = icons[i].transition;
+            sf::Vector2i wanted = lastFrame ? t.to
+                : sf::Vector2i(static_cast<int>(std::lround(t.from.x + (t.to.x - t.from.x) * progress)),
+                               static_cast<int>(std::lround(t.from.y + (t.to.y - t.from.y) * progress)));
+            sf::Vector2i behind = wanted - icons[i].sent;
+            if (behind != sf::Vector2i()) pending.push_back(Pending{i, wanted, behind.x * behind.x + behind.y * behind.y});
+        }
+
+        // Only as many moves as fit in the budget, furthest behind first. Until
+        // a batch has been timed a small one finds out what moves cost.
+        size_t affordable = measured ? std::max<size_t>(1, static_cast<size_t>(config.tickBudget.asSeconds() / moveCost)) : PROBE_MOVES;
+        size_t count = std::min(affordable, pending.size());
+        if (count < pending.size()) {
+            std::nth_element(pending.begin(), pending.begin() + count, pending.end(),
+                             [](const Pending& a, const Pending& b) { return a.distance > b.distance; });
+        }
+        if (count > 0) {
+            batch.clear();
+            for (size_t k = 0; k < count; ++k) batch.push_back(IconMove{icons[pending[k].icon].transition.index, pending[k].wanted});
+            sf::Clock ipc;
+            size_t moved = desktop.moveIcons(batch);
+            sf::Time spent = ipc.getElapsedTime();
+            // Failed moves are not retried; the icon would only fail again every tick
+            for (size_t k = 0; k < count; ++k) icons[pending[k].icon].sent = pending[k].wanted;
+
+            float perMove = spent.asSeconds() / count;
+            moveCost = std::max(measured ? moveCost * 0.7f + perMove * 0.3f : perMove, 1e-6f);
+            measured = true;
+            ++statistics.ticks;
+            statistics.moves += count;
+            statistics.failedMoves += count - moved;
+            statistics.ipcTime += spent;
+            statistics.worstTick = std::max(statistics.worstTick, spent);
+            if (spent > config.tickBudget * 1.5f) ++statistics.ticksOverBudget;
+        }
+        if (lastFrame && count == pending.size()) {
+            running = false;
+            return false;
+        }
+
+        // Idle long enough after this much work that the desktop keeps its share
+        sf::Time work = sf::seconds(moveCost * std::min(affordable, pending.size()));
+        interval = std::clamp(work / config.dutyCycle, sf::seconds(1.0f / config.maxTickRate), sf::seconds(1.0f / config.minTickRate));
+        dueTime = now + interval;
+        return true;
+    }
+
+    bool active() const { return running; }
+    // When the next tick is due; callers may sleep until then
+    sf::Time nextTick() const { return dueTime; }
+    // Where an icon was last sent, by its position in the transitions passed to start
+    sf::Vector2i position(size_t i) const { return icons[i].sent; }
+    size_t size() const { return icons.size(); }
+
+    float tickRate() const { return 1.0f / interval.asSeconds(); }
+    sf::Time moveCostEstimate() const { return sf::seconds(moveCost); }
+    const AnimationStats& stats() const { return statistics; }
+
+private:
+    static const size_t PROBE_MOVES = 16;
+
+    struct Animated {
+        IconTransition transition;
+        sf::Vector2i sent;
+    };
+
+    struct Pending {
+        size_t icon;
+        sf::Vector2i wanted;
+        int distance; // squared, to where it should be now
+    };
+
+    DesktopBackend& desktop;
+    AnimationSettings config;
+    std::vector<Animated> icons;
+    std::vector<Pending> pending;
+    std::vector<IconMove> batch;
+    bool running = false;
+    sf::Time startTime, dueTime;
+    sf::Time interval = sf::seconds(1.0f / 60.0f);
+    // Seconds per move, averaged over the batches so far and carried over
+    // between animations; sf::Time's whole microseconds would round it down
+    float moveCost = 50e-6f;
+    bool measured = false;
+    AnimationStats statistics;
+};
+
+#endif // ICON_ANIMATION_H
@@ -0,0 +1,426 @@
+#ifndef ICON_ASSIGNMENT_H
+#define ICON_ASSIGNMENT_H
+
+#include <SFML/System/Vector2.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Above this many icon-slot pairs the default is the fast, approximate solver;
+// exact mode's work grows with every slot bidding on every icon, and at this
+// size it takes about 10 ms
+const size_t EXACT_ASSIGNMENT_LIMIT = 100000;
+// Icons each slot considers in the fast solver
+const size_t ASSIGNMENT_CANDIDATES = 16;
+
+inline float Travel(sf::Vector2f a, sf::Vector2f b) {
+    sf::Vector2f d = a - b;
+    return std::sqrt(d.x * d.x + d.y * d.y);
+}
+
+// Total distance icons move when slot s gets icon assignment[s]
+inline double TotalTravel(const std::vector<sf::Vector2f>& icons, const std::vector<sf::Vector2f>& slots, const std::vector<int>& assignment) {
+    double total = 0.0;
+    for (size_t s = 0; s < slots.size() && s < assignment.size(); ++s) {
+        if (assignment[s] >= 0) total += Travel(icons[assignment[s]], slots[s]);
+    }
+    return total;
+}
+
+// The mapping used so far: slot s gets icon s
+inline std::vector<int> AssignByIndex(size_t slots) {
+    std::vector<int> assignment(slots);
+    for (size_t s = 0; s < slots; ++s) assignment[s] = static_cast<int>(s);
+    return assignment;
+}
+
+// Cheap stand-in for a new solve while the slots are still changing: keeps
+// the icons already assigned, drops slots that are gone and gives each new
+// slot the nearest icon still free
+inline void ExtendAssignment(const std::vector<sf::Vector2f>& icons, const std::vector<sf::Vector2f>& slots, std::vector<int>& assignment) {
+    assignment.resize(slots.size(), -1);
+    std::vector<bool> taken(icons.size(), false);
+    for (int& icon : assignment) {
+        if (icon >= static_cast<int>(icons.size()) || (icon >= 0 && taken[icon])) icon = -1;
+        if (icon >= 0) taken[icon] = true;
+    }
+    for (size_t s = 0; s < slots.size(); ++s) {
+        if (assignment[s] >= 0) continue;
+        float bestTravel = std::numeric_limits<float>::max();
+        for (size_t i = 0; i < icons.size(); ++i) {
+            float travel = Travel(icons[i], slots[s]);
+            if (!taken[i] && travel < bestTravel) {
+                bestTravel = travel;
+                assignment[s] = static_cast<int>(i);
+            }
+        }
+        if (assignment[s] >= 0) taken[assignment[s]] = true;
+    }
+}
+
+// Picks which icon goes to which slot so the icons travel as little as
+// possible in total. Besides being shorter, a minimum-length matching never
+// has two paths crossing, so an animated move reads as the shape forming
+// rather than icons swapping across the screen.
+//
+// Solved as an auction: slots bid for icons, an icon's price rises with
+// every bid and a slot outbid goes back to bidding, with epsilon scaling so
+// early rounds settle the rough layout cheaply. With more icons than slots,
+// the icons left over still carry prices from earlier rounds, so a reverse
+// auction lowers them again before the result counts. Exact mode lets every
+// slot bid on every icon and ends within a pixel of the optimal total. Fast
+// mode only lets a slot bid on a few icons (its nearest, found through a
+// bucket grid, and its partners in a few complete assignments), which keeps
+// each bid O(1); should the bidding still stall, the slots left over take
+// the nearest free icon. Needs at least as many icons as slots; returns the
+// icon for every slot, each icon used at most once.
+class IconAssignment {
+public:
+    enum class Mode { Automatic, Exact, Fast };
+
+    std::vector<int> solve(const std::vector<sf::Vector2f>& icons, const std::vector<sf::Vector2f>& slots, Mode mode = Mode::Automatic) {
+        slotCount = slots.size();
+        iconCount = icons.size();
+        std::vector<int> assignment(slotCount, -1);
+        bidsMade = 0;
+        if (slotCount == 0 || iconCount < slotCount) return assignment;
+
+        bool fast = mode == Mode::Fast || (mode == Mode::Automatic && slotCount * iconCount > EXACT_ASSIGNMENT_LIMIT);
+        buildCandidates(icons, slots, fast ? std::min(ASSIGNMENT_CANDIDATES, iconCount) : iconCount);
+
+        // Epsilon scaling from a fifth of the largest cost down to a total of one pixel
+        double maxCost = 0.0;
+        for (float c : costs) maxCost = std::max(maxCost, static_cast<double>(c));
+        double finalEpsilon = 1.0 / slotCount;
+        prices.assign(iconCount, 0.0);
+        owner.assign(iconCount, -1);
+        for (double epsilon = std::max(maxCost / 5.0, finalEpsilon);; epsilon = std::max(epsilon / 5.0, finalEpsilon)) {
+            std::fill(owner.begin(), owner.end(), -1);
+            std::fill(assignment.begin(), assignment.end(), -1);
+            if (!auction(assignment, epsilon, maxCost)) break;
+            if (iconCount > slotCount) reverseAuction(assignment, epsilon);
+            if (epsilon <= finalEpsilon) break;
+        }
+
+        // Slots whose candidates all went elsewhere take the nearest free icon
+        for (size_t s = 0; s < slotCount; ++s) {
+            if (assignment[s] >= 0) continue;
+            int best = -1;
+            float bestTravel = std::numeric_limits<float>::max();
+            for (size_t i = 0; i < iconCount; ++i) {
+                float travel = Travel(icons[i], slots[s]);
+                if (owner[i] < 0 && travel < bestTravel) {
+                    bestTravel = travel;
+                    best = static_cast<int>(i);
+                }
+            }
+            assignment[s] = best;
+            owner[best] = static_cast<int>(s);
+        }
+        return assignment;
+    }
+
+    // Bids placed by the last solve, as a measure of its work
+    size_t bids() const { return bidsMade; }
+
+private:
+    // Runs one auction round to completion; false if it gave up (fast mode
+    // can leave slots without a free candidate, which shows as endless bidding)
+    bool auction(std::vector<int>& assignment, double epsilon, double maxCost) {
+        std::vector<int> unassigned;
+        for (size_t s = slotCount; s-- > 0;) unassigned.push_back(static_cast<int>(s));
+        size_t bidLimit = bidsMade + 200 * slotCount + 10000;
+        while (!unassigned.empty()) {
+            if (bidsMade++ > bidLimit) return false;
+            int s = unassigned.back();
+            unassigned.pop_back();
+
+            // Best and second best value (negative cost minus price) among the candidates
+            double best = -std::numeric_limits<double>::infinity(), second = best;
+            int bestIcon = -1;
+            for (size_t k = offsets[s]; k < offsets[s + 1]; ++k) {
+                double value = -costs[k] - prices[candidates[k]];
+                if (value > best) {
+                    second = best;
+                    best = value;
+                    bestIcon = candidates[k];
+                } else if (value > second) {
+                    second = value;
+                }
+            }
+            if (bestIcon < 0) continue;
+            // With a single candidate, bid as if an icon maxCost further away were the alternative
+            if (second == -std::numeric_limits<double>::infinity()) second = best - maxCost - epsilon;
+            prices[bestIcon] += best - second + epsilon;
+            if (owner[bestIcon] >= 0) {
+                assignment[owner[bestIcon]] = -1;
+                unassigned.push_back(owner[bestIcon]);
+            }
+            owner[bestIcon] = s;
+            assignment[s] = bestIcon;
+        }
+        return true;
+    }
+
+    // Reverse auction after each round when icons outnumber slots: the
+    // result is only optimal once no free icon is priced above the cheapest
+    // taken one. A free icon priced higher either drops to that floor or bids
+    // for the slot it suits best, freeing that slot's old icon in turn
+    // (Bertsekas' asymmetric assignment). Every swap raises a slot's profit by
+    // more than epsilon, so the bidding ends, but near-ties can make that take
+    // a price war of tiny steps; the bids are capped like the forward round's,
+    // which is safe since every slot keeps an icon throughout.
+    void reverseAuction(std::vector<int>& assignment, double epsilon) {
+        // Slots that may bid on each icon, and the profit each slot makes now
+        std::vector<size_t> iconOffsets(iconCount + 1, 0);
+        for (int icon : candidates) ++iconOffsets[icon + 1];
+        for (size_t i = 0; i < iconCount; ++i) iconOffsets[i + 1] += iconOffsets[i];
+        std::vector<size_t> fill(iconOffsets.begin(), iconOffsets.end() - 1);
+        std::vector<int> bidders(candidates.size());
+        std::vector<float> bidderCosts(candidates.size());
+        std::vector<double> profit(slotCount);
+        for (size_t s = 0; s < slotCount; ++s) {
+            for (size_t k = offsets[s]; k < offsets[s + 1]; ++k) {
+                size_t n = fill[candidates[k]]++;
+                bidders[n] = static_cast<int>(s);
+                bidderCosts[n] = costs[k];
+                if (candidates[k] == assignment[s]) profit[s] = -costs[k] - prices[candidates[k]];
+            }
+        }
+
+        double floor = std::numeric_limits<double>::infinity();
+        for (size_t s = 0; s < slotCount; ++s) floor = std::min(floor, prices[assignment[s]]);
+        std::vector<int> free;
+        for (size_t i = 0; i < iconCount; ++i) {
+            if (owner[i] < 0 && prices[i] > floor) free.push_back(static_cast<int>(i));
+        }
+        size_t bidLimit = bidsMade + 200 * slotCount + 10000;
+        while (!free.empty() && bidsMade++ <= bidLimit) {
+            int icon = free.back();
+            free.pop_back();
+
+            // Best and second best value to the icon (negative cost minus the slot's profit)
+            double best = -std::numeric_limits<double>::infinity(), second = best;
+            int bestSlot = -1;
+            for (size_t n = iconOffsets[icon]; n < iconOffsets[icon + 1]; ++n) {
+                double value = -bidderCosts[n] - profit[bidders[n]];
+                if (value > best) {
+                    second = best;
+                    best = value;
+                    bestSlot = bidders[n];
+                } else if (value > second) {
+                    second = value;
+                }
+            }
+            if (bestSlot < 0 || floor >= best - epsilon) {
+                prices[icon] = floor;
+                continue;
+            }
+            prices[icon] = std::max(floor, second - epsilon);
+            int freed = assignment[bestSlot];
+            owner[freed] = -1;
+            if (prices[freed] > floor) free.push_back(freed);
+            owner[icon] = bestSlot;
+            assignment[bestSlot] = icon;
+            profit[bestSlot] = best + profit[bestSlot] - prices[icon];
+        }
+    }
+
+    // Icons bucketed about two per cell, for k-nearest queries by rings of
+    // cells. Icons taken out stay at the end of their bucket until restore.
+    struct NearestIcons {
+        std::vector<sf::Vector2f> points;
+        float minX = 0.0f, minY = 0.0f, maxX = 0.0f, maxY = 0.0f, cell = 1.0f;
+        int columns = 1, rows = 1;
+        std::vector<uint32_t> bucketStart, bucketEnd, bucketIcons;
+
+        void build(std::vector<sf::Vector2f> iconPoints) {
+            points = std::move(iconPoints);
+            minX = points[0].x;
+            minY = points[0].y;
+            maxX = minX;
+            maxY = minY;
+            for (const auto& p : points) {
+                minX = std::min(minX, p.x);
+                minY = std::min(minY, p.y);
+                maxX = std::max(maxX, p.x);
+                maxY = std::max(maxY, p.y);
+            }
+            cell = std::max(std::sqrt(std::max(maxX - minX, 1e-3f) * std::max(maxY - minY, 1e-3f) * 2.0f / points.size()), 1e-3f);
+            columns = std::min(static_cast<int>((maxX - minX) / cell) + 1, 4096);
+            rows = std::min(static_cast<int>((maxY - minY) / cell) + 1, 4096);
+            bucketStart.assign(static_cast<size_t>(columns) * rows + 1, 0);
+            bucketIcons.resize(points.size());
+            for (const auto& p : points) ++bucketStart[bucket(p) + 1];
+            for (size_t b = 1; b < bucketStart.size(); ++b) bucketStart[b] += bucketStart[b - 1];
+            std::vector<uint32_t> fill(bucketStart.begin(), bucketStart.end() - 1);
+            for (size_t i = 0; i < points.size(); ++i) bucketIcons[fill[bucket(points[i])]++] = static_cast<uint32_t>(i);
+            restore();
+        }
+
+        void take(int icon) {
+            size_t b = bucket(points[icon]);
+            auto end = bucketIcons.begin() + bucketEnd[b];
+            std::iter_swap(std::find(bucketIcons.begin() + bucketStart[b], end, static_cast<uint32_t>(icon)), end - 1);
+            --bucketEnd[b];
+        }
+
+        void restore() { bucketEnd.assign(bucketStart.begin() + 1, bucketStart.end()); }
+
+        size_t bucket(sf::Vector2f p) const {
+            int x = std::clamp(static_cast<int>((p.x - minX) / cell), 0, columns - 1);
+            int y = std::clamp(static_cast<int>((p.y - minY) / cell), 0, rows - 1);
+            return static_cast<size_t>(y) * columns + x;
+        }
+
+        // Distance from p to the rectangle [x0, x1] x [y0, y1]
+        static float distance(sf::Vector2f p, float x0, float x1, float y0, float y1) {
+            float dx = std::max({x0 - p.x, p.x - x1, 0.0f}), dy = std::max({y0 - p.y, p.y - y1, 0.0f});
+            return std::sqrt(dx * dx + dy * dy);
+        }
+
+        // The k nearest icons to p, as (distance, icon), in no particular order
+        void query(sf::Vector2f p, size_t k, std::vector<std::pair<float, int>>& found) const {
+            found.clear();
+            size_t home = bucket(p);
+            int cx = static_cast<int>(home % columns), cy = static_cast<int>(home / columns);
+            for (int r = 0; r <= columns + rows; ++r) {
+                for (int y = cy - r; y <= cy + r; ++y) {
+                    if (y < 0 || y >= rows) continue;
+                    bool edge = y == cy - r || y == cy + r;
+                    for (int x = cx - r; x <= cx + r; x += edge || r == 0 ? 1 : 2 * r) {
+                        if (x < 0 || x >= columns) continue;
+                        size_t b = static_cast<size_t>(y) * columns + x;
+                        for (uint32_t n = bucketStart[b]; n < bucketEnd[b]; ++n) {
+                            found.push_back({Travel(points[bucketIcons[n]], p), static_cast<int>(bucketIcons[n])});
+                        }
+                    }
+                }
+                // How close the icons outside ring r can be to p; p may lie
+                // outside the grid, so this is measured, not taken as r cells
+                float outside = std::numeric_limits<float>::max();
+                if (cx - r > 0) outside = std::min(outside, distance(p, minX, minX + (cx - r) * cell, minY, maxY));
+                if (cx + r < columns - 1) outside = std::min(outside, distance(p, minX + (cx + r + 1) * cell, maxX, minY, maxY));
+                if (cy - r > 0) outside = std::min(outside, distance(p, minX, maxX, minY, minY + (cy - r) * cell));
+                if (cy + r < rows - 1) outside = std::min(outside, distance(p, minX, maxX, minY + (cy + r + 1) * cell, maxY));
+                if (found.size() >= k) {
+                    std::nth_element(found.begin(), found.begin() + (k - 1), found.end());
+                    if (found[k - 1].first <= outside) break;
+                } else if (outside == std::numeric_limits<float>::max()) {
+                    break;
+                }
+            }
+            found.resize(std::min(k, found.size()));
+        }
+    };
+
+    // Position along a Hilbert curve through the points' bounding box, so
+    // points close in rank are close on screen
+    static std::vector<uint32_t> hilbertOrder(const std::vector<sf::Vector2f>& points) {
+        sf::Vector2f lo = points[0], hi = points[0];
+        for (const auto& p : points) {
+            lo = sf::Vector2f(std::min(lo.x, p.x), std::min(lo.y, p.y));
+            hi = sf::Vector2f(std::max(hi.x, p.x), std::max(hi.y, p.y));
+        }
+        const uint32_t side = 1 << 16;
+        std::vector<std::pair<uint64_t, uint32_t>> keyed;
+        keyed.reserve(points.size());
+        for (size_t i = 0; i < points.size(); ++i) {
+            uint32_t x = static_cast<uint32_t>((points[i].x - lo.x) / std::max(hi.x - lo.x, 1e-3f) * (side - 1));
+            uint32_t y = static_cast<uint32_t>((points[i].y - lo.y) / std::max(hi.y - lo.y, 1e-3f) * (side - 1));
+            uint64_t d = 0;
+            for (uint32_t s = side / 2; s > 0; s /= 2) {
+                uint32_t rx = (x & s) > 0, ry = (y & s) > 0;
+                d += static_cast<uint64_t>(s) * s * ((3 * rx) ^ ry);
+                if (ry == 0) {
+                    if (rx == 1) {
+                        x = side - 1 - x;
+                        y = side - 1 - y;
+                    }
+                    std::swap(x, y);
+                }
+            }
+            keyed.push_back({d, static_cast<uint32_t>(i)});
+        }
+        std::sort(keyed.begin(), keyed.end());
+        std::vector<uint32_t> order;
+        order.reserve(points.size());
+        for (const auto& k : keyed) order.push_back(k.second);
+        return order;
+    }
+
+    // The icons each slot may bid on and what moving them costs, flattened.
+    // Fast mode offers a slot its nearest icons, plus its partners in three
+    // complete assignments so the bidding always has one to converge to:
+    // pairing by rank along a Hilbert curve through each set (with a few
+    // icons either side), a greedy matching, and index order, which keeps
+    // the result from coming out worse than the mapping it replaces. With
+    // icons to spare, a shape's slots mostly share the same nearest icons;
+    // the greedy matching is what offers them the spare icons close by.
+    void buildCandidates(const std::vector<sf::Vector2f>& icons, const std::vector<sf::Vector2f>& slots, size_t perSlot) {
+        offsets.assign(slotCount + 1, 0);
+        candidates.clear();
+        costs.clear();
+        candidates.reserve(slotCount * perSlot);
+        costs.reserve(slotCount * perSlot);
+        if (perSlot >= iconCount) {
+            for (size_t s = 0; s < slotCount; ++s) {
+                for (size_t i = 0; i < iconCount; ++i) {
+                    candidates.push_back(static_cast<int>(i));
+                    costs.push_back(Travel(icons[i], slots[s]));
+                }
+                offsets[s + 1] = candidates.size();
+            }
+            return;
+        }
+
+        NearestIcons nearest;
+        nearest.build(icons);
+        std::vector<uint32_t> iconOrder = hilbertOrder(icons), slotOrder = hilbertOrder(slots);
+        std::vector<size_t> slotRank(slotCount);
+        for (size_t r = 0; r < slotCount; ++r) slotRank[slotOrder[r]] = r;
+
+        // Greedy matching: slots in Hilbert order each take the nearest icon still free
+        std::vector<std::pair<float, int>> found;
+        std::vector<int> greedy(slotCount);
+        for (uint32_t s : slotOrder) {
+            nearest.query(slots[s], 1, found);
+            greedy[s] = found[0].second;
+            nearest.take(greedy[s]);
+        }
+        nearest.restore();
+
+        int window = static_cast<int>(perSlot / 4);
+        for (size_t s = 0; s < slotCount; ++s) {
+            nearest.query(slots[s], perSlot, found);
+            auto offer = [&](int icon) {
+                bool seen = false;
+                for (const auto& f : found) seen = seen || f.second == icon;
+                if (!seen) found.push_back({Travel(icons[icon], slots[s]), icon});
+            };
+            long long rank = static_cast<long long>(slotRank[s] * iconCount / slotCount);
+            for (long long r = rank - window; r <= rank + window; ++r) {
+                if (r >= 0 && r < static_cast<long long>(iconCount)) offer(static_cast<int>(iconOrder[r]));
+            }
+            offer(greedy[s]);
+            offer(static_cast<int>(s));
+            for (const auto& candidate : found) {
+                candidates.push_back(candidate.second);
+                costs.push_back(candidate.first);
+            }
+            offsets[s + 1] = candidates.size();
+        }
+    }
+
+    size_t slotCount = 0, iconCount = 0;
+    std::vector<size_t> offsets;  // slot s bids on candidates[offsets[s]..offsets[s + 1])
+    std::vector<int> candidates;
+    std::vector<float> costs;
+    std::vector<double> prices;
+    std::vector<int> owner;       // slot holding each icon, or -1
+    size_t bidsMade = 0;
+};
+
+#endif // ICON_ASSIGNMENT_H
@@ -0,0 +1,281 @@
+#ifndef ICON_ATLAS_H
+#define ICON_ATLAS_H
+
+#include <SFML/Graphics/Font.hpp>
+#include <SFML/Graphics/Image.hpp>
+#include <SFML/Graphics/Rect.hpp>
+#include <SFML/Graphics/Texture.hpp>
+#include <SFML/System/String.hpp>
+#include <algorithm>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Bottom-left skyline packing: the packed area's top edge is kept as a list of
+// horizontal segments and each rectangle goes where its top ends up lowest.
+// Good enough for icons and glyphs of similar heights, and O(segments) per insert.
+class SkylinePacker {
+public:
+    SkylinePacker(unsigned width, unsigned height) : width(width), height(height) {
+        reset();
+    }
+
+    void reset() {
+        skyline.assign(1, Segment{0, 0, width});
+        used = 0;
+    }
+
+    // Top-left corner for a w x h rectangle, or nothing if it doesn't fit
+    std::optional<sf::Vector2u> insert(unsigned w, unsigned h) {
+        size_t best = skyline.size();
+        unsigned bestTop = height + 1, bestX = 0;
+        for (size_t i = 0; i < skyline.size(); ++i) {
+            unsigned y;
+            if (!fits(i, w, h, y)) continue;
+            if (y + h < bestTop) {
+                best = i;
+                bestTop = y + h;
+                bestX = skyline[i].x;
+            }
+        }
+        if (best == skyline.size()) return std::nullopt;
+
+        // The new segment replaces whatever it covers
+        unsigned top = bestTop;
+        skyline.insert(skyline.begin() + best, Segment{bestX, top, w});
+        for (size_t i = best + 1; i < skyline.size();) {
+            unsigned end = bestX + w;
+            if (skyline[i].x >= end) break;
+            unsigned overlap = end - skyline[i].x;
+            if (overlap < skyline[i].width) {
+                skyline[i].x += overlap;
+                skyline[i].width -= overlap;
+                break;
+            }
+            skyline.erase(skyline.begin() + i);
+        }
+        // Neighbours at the same height become one segment
+        for (size_t i = 0; i + 1 < skyline.size();) {
+            if (skyline[i].y == skyline[i + 1].y) {
+                skyline[i].width += skyline[i + 1].width;
+                skyline.erase(skyline.begin() + i + 1);
+            } else {
+                ++i;
+            }
+        }
+        used += static_cast<size_t>(w) * h;
+        return sf::Vector2u(bestX, top - h);
+    }
+
+    // Fraction of the area covered by packed rectangles
+    float occupancy() const { return static_cast<float>(used) / (static_cast<float>(width) * height); }
+
+private:
+    struct Segment {
+        unsigned x, y, width;
+    };
+
+    // Whether a rectangle starting at segment i fits, and the height it rests at
+    bool fits(size_t i, unsigned w, unsigned h, unsigned& y) const {
+        unsigned x = skyline[i].x;
+        if (x + w > width) return false;
+        y = 0;
+        unsigned remaining = w;
+        for (size_t j = i; remaining > 0; ++j) {
+            if (j == skyline.size()) return false;
+            y = std::max(y, skyline[j].y);
+            if (y + h > height) return false;
+            remaining -= std::min(remaining, skyline[j].width);
+        }
+        return true;
+    }
+
+    unsigned width, height;
+    std::vector<Segment> skyline; // left to right, covering the full width
+    size_t used = 0;
+};
+
+// A glyph of a label, relative to the label's top-centre, and where it sits in the atlas
+struct GlyphQuad {
+    sf::FloatRect bounds;
+    sf::FloatRect texture;
+};
+
+// What the preview needs to draw one icon: its picture and its label
+struct IconVisual {
+    sf::FloatRect image; // atlas pixels; empty size if the icon has no picture
+    std::vector<GlyphQuad> label;
+};
+
+// Icon pictures and label glyphs packed into one texture, so everything the
+// icon preview shows can go out in a single draw call. Pictures are added
+// once per key and glyphs once per character; both stay for the atlas' life.
+class IconAtlas {
+public:
+    explicit IconAtlas(unsigned size = 2048) : size(size), packer(size, size) {}
+
+    bool create() {
+        if (!atlas.resize(sf::Vector2u(size, size))) {
+            std::cout << "Could not create the icon atlas" << std::endl;
+            return false;
+        }
+        packer.reset();
+        images.clear();
+        glyphs.clear();
+        // A white block that untextured geometry samples, so it can share the draw
+        std::optional<sf::Vector2u> white = packer.insert(4, 4);
+        atlas.update(sf::Image(sf::Vector2u(4, 4), sf::Color::White), *white);
+        whitePixel = sf::Vector2f(white->x + 2.0f, white->y + 2.0f);
+        return true;
+    }
+
+    // Labels are skipped without a font
+    void setFont(const sf::Font* labelFont, unsigned characterSize, float maxLabelWidth) {
+        font = labelFont;
+        charSize = characterSize;
+        labelWidth = maxLabelWidth;
+        glyphs.clear();
+    }
+
+    // Packs an icon's picture scaled to fit side x side pixels, once per key
+    std::optional<sf::FloatRect> addImage(const std::wstring& key, const sf::Image& image, unsigned side) {
+        auto it = images.find(key);
+        if (it != images.end()) return it->second;
+        sf::Vector2u source = image.getSize();
+        if (source.x == 0 || source.y == 0) return std::nullopt;
+
+        float scale = std::min(1.0f, static_cast<float>(side) / std::max(source.x, source.y));
+        sf::Vector2u scaled(std::max(1u, static_cast<unsigned>(source.x * scale)), std::max(1u, static_cast<unsigned>(source.y * scale)));
+        std::optional<sf::Vector2u> place = packer.insert(scaled.x + PADDING, scaled.y + PADDING);
+        if (!place) {
+            std::cout << "Icon atlas is full" << std::endl;
+            return std::nullopt;
+        }
+        atlas.update(scale < 1.0f ? downscale(image, scaled) : image, *place);
+        sf::FloatRect rect({static_cast<float>(place->x), static_cast<float>(place->y)},
+                           {static_cast<float>(scaled.x), static_cast<float>(scaled.y)});
+        images[key] = rect;
+        return rect;
+    }
+
+    // Picture and laid out label for an icon. The label is one line, centred,
+    // and cut short with an ellipsis if it is wider than the label width.
+    IconVisual visual(const std::wstring& key, const sf::Image& image, unsigned side) {
+        IconVisual result;
+        if (auto rect = addImage(key, image, side)) result.image = *rect;
+        if (!font) return result;
+
+        std::u32string text = sf::String(key).toUtf32();
+        addGlyphs(text + ELLIPSIS);
+        float width = 0.0f;
+        for (char32_t c : text) width += glyphs[c].advance;
+        std::u32string line = text;
+        if (width > labelWidth) {
+            float pen = glyphs[ELLIPSIS].advance;
+            size_t shown = 0;
+            while (shown < text.size() && pen + glyphs[text[shown]].advance <= labelWidth) pen += glyphs[text[shown++]].advance;
+            line = text.substr(0, shown) + ELLIPSIS;
+        }
+
+        width = 0.0f;
+        for (char32_t c : line) width += glyphs[c].advance;
+        float pen = -width / 2.0f;
+        float baseline = static_cast<float>(charSize);
+        for (char32_t c : line) {
+            const AtlasGlyph& glyph = glyphs[c];
+            if (glyph.texture.size.x > 0.0f) {
+                sf::FloatRect bounds(glyph.bounds.position + sf::Vector2f(pen, baseline), glyph.bounds.size);
+                result.label.push_back(GlyphQuad{bounds, glyph.texture});
+            }
+            pen += glyph.advance;
+        }
+        return result;
+    }
+
+    bool hasImage(const std::wstring& key) const { return images.count(key) > 0; }
+    const sf::Texture& texture() const { return atlas; }
+    // Atlas coordinates of an opaque white texel
+    sf::Vector2f whiteTexel() const { return whitePixel; }
+    size_t imageCount() const { return images.size(); }
+    size_t glyphCount() const { return glyphs.size(); }
+    float occupancy() const { return packer.occupancy(); }
+
+private:
+    // A pixel of space between entries so filtering never bleeds a neighbour in
+    static const unsigned PADDING = 1;
+    static constexpr char32_t ELLIPSIS = U'\u2026';
+
+    struct AtlasGlyph {
+        float advance = 0.0f;
+        sf::FloatRect bounds;  // relative to the pen on the baseline
+        sf::FloatRect texture; // atlas pixels
+    };
+
+    // Copies glyphs the atlas doesn't have yet out of the font's own texture.
+    // Reading a texture back is slow, so all missing glyphs share one read.
+    void addGlyphs(const std::u32string& text) {
+        std::vector<char32_t> missing;
+        for (char32_t c : text) {
+            if (!glyphs.count(c) && std::find(missing.begin(), missing.end(), c) == missing.end()) missing.push_back(c);
+        }
+        if (missing.empty()) return;
+
+        std::vector<sf::Glyph> rendered;
+        for (char32_t c : missing) rendered.push_back(font->getGlyph(c, charSize, false));
+        sf::Image page = font->getTexture(charSize).copyToImage();
+        for (size_t i = 0; i < missing.size(); ++i) {
+            const sf::Glyph& glyph = rendered[i];
+            AtlasGlyph& entry = glyphs[missing[i]];
+            entry.advance = glyph.advance;
+            entry.bounds = glyph.bounds;
+            sf::Vector2u size(glyph.textureRect.size.x, glyph.textureRect.size.y);
+            if (size.x == 0 || size.y == 0) continue;
+            std::optional<sf::Vector2u> place = packer.insert(size.x + PADDING, size.y + PADDING);
+            if (!place) {
+                std::cout << "Icon atlas is full" << std::endl;
+                continue;
+            }
+            sf::Image cell(size, sf::Color::Transparent);
+            if (!cell.copy(page, {0, 0}, glyph.textureRect)) continue;
+            atlas.update(cell, *place);
+            entry.texture = sf::FloatRect({static_cast<float>(place->x), static_cast<float>(place->y)},
+                                          {static_cast<float>(size.x), static_cast<float>(size.y)});
+        }
+    }
+
+    // Box filter; the shell's icons only ever shrink a little
+    static sf::Image downscale(const sf::Image& image, sf::Vector2u to) {
+        sf::Vector2u from = image.getSize();
+        sf::Image result(to, sf::Color::Transparent);
+        for (unsigned y = 0; y < to.y; ++y) {
+            for (unsigned x = 0; x < to.x; ++x) {
+                unsigned x0 = x * from.x / to.x, x1 = std::max(x0 + 1, (x + 1) * from.x / to.x);
+                unsigned y0 = y * from.y / to.y, y1 = std::max(y0 + 1, (y + 1) * from.y / to.y);
+                unsigned sum[4] = {0, 0, 0, 0}, n = 0;
+                for (unsigned sy = y0; sy < y1; ++sy) {
+                    for (unsigned sx = x0; sx < x1; ++sx) {
+                        sf::Color c = image.getPixel(sf::Vector2u(sx, sy));
+                        sum[0] += c.r; sum[1] += c.g; sum[2] += c.b; sum[3] += c.a;
+                        ++n;
+                    }
+                }
+                result.setPixel(sf::Vector2u(x, y), sf::Color(sum[0] / n, sum[1] / n, sum[2] / n, sum[3] / n));
+            }
+        }
+        return result;
+    }
+
+    unsigned size;
+    SkylinePacker packer;
+    sf::Texture atlas;
+    sf::Vector2f whitePixel;
+    const sf::Font* font = nullptr;
+    unsigned charSize = 12;
+    float labelWidth = 72.0f;
+    std::unordered_map<std::wstring, sf::FloatRect> images;
+    std::unordered_map<char32_t, AtlasGlyph> glyphs;
+};
+
+#endif // ICON_ATLAS_H
@@ -0,0 +1,173 @@
+#ifndef ICON_GRID_H
+#define ICON_GRID_H
+
+#include <SFML/System/Vector2.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <vector>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Lowest and highest set bit of a non-zero word
+inline int LowestBit(uint64_t word) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, word);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctzll(word);
+#endif
+}
+
+inline int HighestBit(uint64_t word) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, word);
+    return static_cast<int>(index);
+#else
+    return 63 - __builtin_clzll(word);
+#endif
+}
+
+// The grid Explorer snaps desktop icons to, in screen pixels: cell (x, y)
+// has its icon's top-left corner at origin + (x, y) * spacing
+struct DesktopGrid {
+    sf::Vector2i origin;
+    sf::Vector2i spacing{76, 96};
+    sf::Vector2i cells{1, 1};
+
+    // Spacing from the desktop; the origin is the offset most icons share,
+    // since icons on the desktop already sit on the grid
+    static DesktopGrid fromIcons(sf::Vector2u screen, sf::Vector2i spacing, const std::vector<sf::Vector2i>& positions) {
+        DesktopGrid grid;
+        grid.spacing = sf::Vector2i(std::max(spacing.x, 1), std::max(spacing.y, 1));
+        std::map<std::pair<int, int>, int> offsets;
+        int best = 0;
+        for (const auto& p : positions) {
+            auto offset = std::make_pair(((p.x % grid.spacing.x) + grid.spacing.x) % grid.spacing.x,
+                                         ((p.y % grid.spacing.y) + grid.spacing.y) % grid.spacing.y);
+            if (++offsets[offset] > best) {
+                best = offsets[offset];
+                grid.origin = sf::Vector2i(offset.first, offset.second);
+            }
+        }
+        grid.cells = sf::Vector2i(std::max(1, (static_cast<int>(screen.x) - grid.origin.x) / grid.spacing.x),
+                                  std::max(1, (static_cast<int>(screen.y) - grid.origin.y) / grid.spacing.y));
+        return grid;
+    }
+
+    // Nearest cell to a screen position, clamped to the screen
+    sf::Vector2i cellAt(sf::Vector2f p) const {
+        int x = static_cast<int>(std::lround((p.x - origin.x) / spacing.x));
+        int y = static_cast<int>(std::lround((p.y - origin.y) / spacing.y));
+        return sf::Vector2i(std::clamp(x, 0, cells.x - 1), std::clamp(y, 0, cells.y - 1));
+    }
+
+    sf::Vector2i position(sf::Vector2i cell) const {
+        return sf::Vector2i(origin.x + cell.x * spacing.x, origin.y + cell.y * spacing.y);
+    }
+};
+
+// One bit per grid cell, each row padded to whole 64-bit words so a run of
+// taken cells is skipped a word at a time
+class OccupancyBitmap {
+public:
+    OccupancyBitmap(int columns, int rows)
+        : columns(columns), rows(rows), words((columns + 63) / 64), bits(static_cast<size_t>(words) * rows, 0) {}
+
+    bool test(int x, int y) const { return (bits[index(x, y)] >> (x & 63)) & 1; }
+    void set(int x, int y) { bits[index(x, y)] |= uint64_t(1) << (x & 63); }
+    void reset() { std::fill(bits.begin(), bits.end(), 0); }
+
+    // First free column in [from, to] of row y, or -1
+    int firstFree(int y, int from, int to) const {
+        from = std::max(from, 0);
+        to = std::min(to, columns - 1);
+        if (y < 0 || y >= rows || from > to) return -1;
+        const uint64_t* row = &bits[static_cast<size_t>(y) * words];
+        for (int w = from >> 6; w <= to >> 6; ++w) {
+            uint64_t free = ~row[w];
+            if (w == from >> 6) free &= ~uint64_t(0) << (from & 63);
+            if (w == to >> 6 && (to & 63) != 63) free &= (uint64_t(1) << ((to & 63) + 1)) - 1;
+            if (free) return (w << 6) + LowestBit(free);
+        }
+        return -1;
+    }
+
+    // Last free column in [from, to] of row y, or -1
+    int lastFree(int y, int from, int to) const {
+        from = std::max(from, 0);
+        to = std::min(to, columns - 1);
+        if (y < 0 || y >= rows || from > to) return -1;
+        const uint64_t* row = &bits[static_cast<size_t>(y) * words];
+        for (int w = to >> 6; w >= from >> 6; --w) {
+            uint64_t free = ~row[w];
+            if (w == to >> 6 && (to & 63) != 63) free &= (uint64_t(1) << ((to & 63) + 1)) - 1;
+            if (w == from >> 6) free &= ~uint64_t(0) << (from & 63);
+            if (free) return (w << 6) + HighestBit(free);
+        }
+        return -1;
+    }
+
+private:
+    size_t index(int x, int y) const { return static_cast<size_t>(y) * words + (x >> 6); }
+
+    int columns, rows, words;
+    std::vector<uint64_t> bits;
+};
+
+// Gives every target (screen pixels, in path order) a grid cell of its own so
+// Explorer has nothing to bump: the nearest cell, or when that is taken the
+// nearest free one. Rows are searched outwards from the target's own row, and
+// in each row the free cells either side of its column are found with bit
+// scans a word at a time; the search stops at the first row too far away to
+// hold anything nearer. Of equally near cells the one ahead along the path
+// wins, which keeps the drawn shape's direction. Targets that find no cell
+// (more icons than cells) get (-1, -1).
+inline std::vector<sf::Vector2i> AssignGridCells(const std::vector<sf::Vector2f>& targets, const DesktopGrid& grid) {
+    std::vector<sf::Vector2i> assigned(targets.size(), sf::Vector2i(-1, -1));
+    OccupancyBitmap taken(grid.cells.x, grid.cells.y);
+    size_t freeCells = static_cast<size_t>(grid.cells.x) * grid.cells.y;
+
+    for (size_t i = 0; i < targets.size() && freeCells > 0; ++i) {
+        sf::Vector2f p = targets[i];
+        sf::Vector2i home = grid.cellAt(p);
+        sf::Vector2i best = home;
+        if (taken.test(home.x, home.y)) {
+            sf::Vector2f ahead = i + 1 < targets.size() ? targets[i + 1] - p : (i > 0 ? p - targets[i - 1] : sf::Vector2f(0.0f, 0.0f));
+            float bestDistance = INFINITY, bestAhead = 0.0f;
+            auto consider = [&](int x, int y) {
+                if (x < 0) return;
+                sf::Vector2i cell = grid.position(sf::Vector2i(x, y));
+                sf::Vector2f d(cell.x - p.x, cell.y - p.y);
+                float distance = d.x * d.x + d.y * d.y;
+                float along = d.x * ahead.x + d.y * ahead.y;
+                if (distance < bestDistance - 0.5f || (distance <= bestDistance + 0.5f && along > bestAhead)) {
+                    bestDistance = distance;
+                    bestAhead = along;
+                    best = sf::Vector2i(x, y);
+                }
+            };
+            for (int dy = 0; home.y - dy >= 0 || home.y + dy < grid.cells.y; ++dy) {
+                // p is within half a cell of its home row, so rows further out only get further
+                float reach = (dy - 0.5f) * grid.spacing.y;
+                if (dy > 0 && reach * reach > bestDistance) break;
+                for (int y : {home.y - dy, home.y + dy}) {
+                    if (y < 0 || y >= grid.cells.y) continue;
+                    consider(taken.firstFree(y, home.x, grid.cells.x - 1), y);
+                    consider(taken.lastFree(y, 0, home.x), y);
+                    if (dy == 0) break;
+                }
+            }
+        }
+        taken.set(best.x, best.y);
+        assigned[i] = best;
+        --freeCells;
+    }
+    return assigned;
+}
+
+#endif // ICON_GRID_H
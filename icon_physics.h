@@ -0,0 +1,336 @@
+#ifndef ICON_PHYSICS_H
+#define ICON_PHYSICS_H
+
+#include <SFML/System/Time.hpp>
+#include <SFML/System/Vector2.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include "layout.h"
+
+struct PhysicsSettings {
+    sf::Time timestep = sf::seconds(1.0f / 60.0f);
+    // Icons closer than this push each other apart: about an icon's size
+    float spacing = 60.0f;
+    // Accelerations per unit of distance (1/s^2): towards the nearest point
+    // of the path, and apart for every unit two icons overlap
+    float pathStiffness = 60.0f;
+    float repulsion = 250.0f;
+    float damping = 12.0f; // 1/s
+    float maxSpeed = 3000.0f;
+    // Settled once no icon moves faster than this, in units per second
+    float settleSpeed = 2.0f;
+    // A slow frame runs at most this many steps and lets the simulation fall
+    // behind, instead of taking longer still to catch up
+    int maxStepsPerAdvance = 4;
+    unsigned threads = 0; // 0: one per core once there are enough icons
+};
+
+// Simulations with at least this many icons step on worker threads
+const size_t PARALLEL_PHYSICS_ICONS = 2000;
+
+// Icons as particles that settle along the drawing: each is pulled towards
+// the nearest point of the path and pushed away from icons closer than the
+// spacing, so crowded stretches spread out and gaps close up while the icons
+// stay on the path. Integration is semi-implicit Euler on a fixed timestep.
+//
+// Positions and velocities are kept as separate arrays and every step writes
+// new arrays from the old ones, so each icon's update only reads the last
+// step and the icons can be split between threads in any way with the same
+// result. Neighbours come from a spatial hash rebuilt every step (cells one
+// spacing wide, hashed into a table twice the icon count, counting-sorted);
+// the path is resampled into short segments hashed the same way once per path.
+class IconPhysics {
+public:
+    explicit IconPhysics(PhysicsSettings settings = {}) : config(settings) {}
+
+    void setSettings(const PhysicsSettings& settings) { config = settings; }
+    const PhysicsSettings& settings() const { return config; }
+
+    // The strokes the icons settle on. Every stroke is cut into segments of
+    // a quarter spacing, so a hash cell holds a few of them however densely
+    // the stroke was sampled. Call after changing the spacing, and reset after this.
+    void setPath(const std::vector<const StrokeProgress*>& strokes) {
+        segments.clear();
+        float step = config.spacing / 4.0f;
+        for (const StrokeProgress* stroke : strokes) {
+            if (stroke->size() == 0) continue;
+            double length = stroke->totalLength();
+            int pieces = std::max(1, static_cast<int>(std::ceil(length / step)));
+            sf::Vector2f from = stroke->points.front();
+            for (int k = 1; k <= pieces; ++k) {
+                sf::Vector2f to = PointAtLength(*stroke, length * k / pieces);
+                segments.push_back(Segment{from, to});
+                from = to;
+            }
+        }
+
+        // Each segment goes in every cell its box touches
+        struct Entry {
+            int cx, cy;
+            uint32_t segment;
+        };
+        std::vector<Entry> entries;
+        for (uint32_t k = 0; k < segments.size(); ++k) {
+            const Segment& segment = segments[k];
+            int x0 = cellOf(std::min(segment.a.x, segment.b.x)), x1 = cellOf(std::max(segment.a.x, segment.b.x));
+            int y0 = cellOf(std::min(segment.a.y, segment.b.y)), y1 = cellOf(std::max(segment.a.y, segment.b.y));
+            for (int cy = y0; cy <= y1; ++cy) {
+                for (int cx = x0; cx <= x1; ++cx) entries.push_back(Entry{cx, cy, k});
+            }
+        }
+        pathTable = TableSize(entries.size());
+        pathStart.assign(pathTable + 1, 0);
+        for (const Entry& entry : entries) ++pathStart[Hash(entry.cx, entry.cy, pathTable) + 1];
+        for (size_t b = 1; b < pathStart.size(); ++b) pathStart[b] += pathStart[b - 1];
+        pathSegments.resize(entries.size());
+        fill.assign(pathStart.begin(), pathStart.end() - 1);
+        for (const Entry& entry : entries) pathSegments[fill[Hash(entry.cx, entry.cy, pathTable)]++] = entry.segment;
+    }
+
+    // Puts the icons at positions, at rest. Each finds its nearest point of
+    // the path even if that is far away, which steps only look for close by.
+    void reset(const std::vector<sf::Vector2f>& positions) {
+        size_t n = positions.size();
+        x.resize(n);
+        y.resize(n);
+        vx.assign(n, 0.0f);
+        vy.assign(n, 0.0f);
+        nextX.resize(n);
+        nextY.resize(n);
+        nextVx.resize(n);
+        nextVy.resize(n);
+        anchorX.resize(n);
+        anchorY.resize(n);
+        for (size_t i = 0; i < n; ++i) {
+            x[i] = positions[i].x;
+            y[i] = positions[i].y;
+            sf::Vector2f anchor = positions[i];
+            nearestOnPath(positions[i], 64, anchor);
+            anchorX[i] = anchor.x;
+            anchorY[i] = anchor.y;
+        }
+        accumulated = sf::Time::Zero;
+        fastest = n ? INFINITY : 0.0f;
+        stepCount = 0;
+    }
+
+    // Runs the steps that fit in the elapsed time; the rest carries over to
+    // the next call. Returns the number of steps run.
+    int advance(sf::Time elapsed) {
+        accumulated += elapsed;
+        int steps = 0;
+        while (accumulated >= config.timestep && steps < config.maxStepsPerAdvance) {
+            step();
+            accumulated -= config.timestep;
+            ++steps;
+        }
+        if (steps == config.maxStepsPerAdvance) accumulated = sf::Time::Zero;
+        return steps;
+    }
+
+    // Steps until settled or maxSteps; returns the steps taken
+    int settle(int maxSteps) {
+        int steps = 0;
+        while (!settled() && steps < maxSteps) {
+            step();
+            ++steps;
+        }
+        return steps;
+    }
+
+    void step() {
+        size_t n = x.size();
+        if (n == 0) return;
+        buildNeighbourHash();
+
+        float dt = config.timestep.asSeconds();
+        unsigned threads = config.threads ? config.threads
+                                          : (n >= PARALLEL_PHYSICS_ICONS ? std::max(1u, std::thread::hardware_concurrency()) : 1);
+        const size_t CHUNK = 256;
+        size_t chunks = (n + CHUNK - 1) / CHUNK;
+        threads = std::min<unsigned>(threads, static_cast<unsigned>(chunks));
+        std::vector<float> fastestPerThread(threads, 0.0f);
+        std::atomic<size_t> next{0};
+        auto worker = [&](unsigned thread) {
+            float fastestHere = 0.0f;
+            for (size_t chunk = next++; chunk < chunks; chunk = next++) {
+                for (size_t i = chunk * CHUNK; i < std::min(n, (chunk + 1) * CHUNK); ++i) {
+                    fastestHere = std::max(fastestHere, update(i, dt));
+                }
+            }
+            fastestPerThread[thread] = fastestHere;
+        };
+        std::vector<std::thread> pool;
+        for (unsigned t = 1; t < threads; ++t) pool.emplace_back(worker, t);
+        worker(0);
+        for (auto& thread : pool) thread.join();
+
+        x.swap(nextX);
+        y.swap(nextY);
+        vx.swap(nextVx);
+        vy.swap(nextVy);
+        fastest = *std::max_element(fastestPerThread.begin(), fastestPerThread.end());
+        ++stepCount;
+    }
+
+    bool settled() const { return fastest <= config.settleSpeed; }
+    // Speed of the fastest icon after the last step, in units per second
+    float fastestSpeed() const { return fastest; }
+    size_t steps() const { return stepCount; }
+    size_t size() const { return x.size(); }
+    size_t pathSegmentCount() const { return segments.size(); }
+
+    sf::Vector2f position(size_t i) const { return sf::Vector2f(x[i], y[i]); }
+
+    std::vector<sf::Vector2f> positions() const {
+        std::vector<sf::Vector2f> result(x.size());
+        for (size_t i = 0; i < x.size(); ++i) result[i] = sf::Vector2f(x[i], y[i]);
+        return result;
+    }
+
+private:
+    struct Segment {
+        sf::Vector2f a, b;
+    };
+
+    // Cells hash into a table whose size is a power of two (Teschner et al.)
+    static uint32_t Hash(int cx, int cy, uint32_t table) {
+        return (static_cast<uint32_t>(cx) * 73856093u ^ static_cast<uint32_t>(cy) * 19349663u) & (table - 1);
+    }
+
+    static uint32_t TableSize(size_t entries) {
+        uint32_t size = 64;
+        while (size < entries * 2) size *= 2;
+        return size;
+    }
+
+    int cellOf(float v) const { return static_cast<int>(std::floor(v / config.spacing)); }
+
+    // Counting sort of the icons by the bucket of their cell
+    void buildNeighbourHash() {
+        size_t n = x.size();
+        table = TableSize(n);
+        bucketStart.assign(table + 1, 0);
+        bucketOf.resize(n);
+        for (size_t i = 0; i < n; ++i) {
+            bucketOf[i] = Hash(cellOf(x[i]), cellOf(y[i]), table);
+            ++bucketStart[bucketOf[i] + 1];
+        }
+        for (size_t b = 1; b < bucketStart.size(); ++b) bucketStart[b] += bucketStart[b - 1];
+        bucketIcons.resize(n);
+        fill.assign(bucketStart.begin(), bucketStart.end() - 1);
+        for (size_t i = 0; i < n; ++i) bucketIcons[fill[bucketOf[i]]++] = static_cast<uint32_t>(i);
+    }
+
+    // The closest point of the path within rings cells of p; false if none is that close
+    bool nearestOnPath(sf::Vector2f p, int rings, sf::Vector2f& nearest) const {
+        if (segments.empty()) return false;
+        int cx = cellOf(p.x), cy = cellOf(p.y);
+        float best = INFINITY;
+        for (int ring = 0; ring <= rings; ++ring) {
+            // The points in this ring are at least ring - 1 cells away; nothing
+            // further out can beat what the inner rings found
+            if (ring > 1 && best < (ring - 1) * config.spacing * (ring - 1) * config.spacing) break;
+            for (int dy = -ring; dy <= ring; ++dy) {
+                for (int dx = -ring; dx <= ring; ++dx) {
+                    if (std::max(std::abs(dx), std::abs(dy)) != ring) continue;
+                    uint32_t bucket = Hash(cx + dx, cy + dy, pathTable);
+                    for (uint32_t k = pathStart[bucket]; k < pathStart[bucket + 1]; ++k) {
+                        const Segment& s = segments[pathSegments[k]];
+                        sf::Vector2f ab = s.b - s.a, ap = p - s.a;
+                        float lengthSq = ab.x * ab.x + ab.y * ab.y;
+                        float t = lengthSq > 0.0f ? std::clamp((ap.x * ab.x + ap.y * ab.y) / lengthSq, 0.0f, 1.0f) : 0.0f;
+                        sf::Vector2f d = ap - ab * t;
+                        float distanceSq = d.x * d.x + d.y * d.y;
+                        if (distanceSq < best) {
+                            best = distanceSq;
+                            nearest = s.a + ab * t;
+                        }
+                    }
+                }
+            }
+        }
+        return best < INFINITY;
+    }
+
+    // Writes icon i's next position and velocity; returns its new speed
+    float update(size_t i, float dt) {
+        float px = x[i], py = y[i];
+        float ax = 0.0f, ay = 0.0f;
+
+        // Push apart from icons closer than the spacing. Cells of the 3x3
+        // block that hash to the same bucket are only visited once.
+        float spacing = config.spacing, spacingSq = spacing * spacing;
+        int cx = cellOf(px), cy = cellOf(py);
+        uint32_t visited[9];
+        int visitedCount = 0;
+        for (int dy = -1; dy <= 1; ++dy) {
+            for (int dx = -1; dx <= 1; ++dx) {
+                uint32_t bucket = Hash(cx + dx, cy + dy, table);
+                if (std::find(visited, visited + visitedCount, bucket) != visited + visitedCount) continue;
+                visited[visitedCount++] = bucket;
+                for (uint32_t k = bucketStart[bucket]; k < bucketStart[bucket + 1]; ++k) {
+                    uint32_t j = bucketIcons[k];
+                    if (j == i) continue;
+                    float ex = px - x[j], ey = py - y[j];
+                    float distanceSq = ex * ex + ey * ey;
+                    if (distanceSq >= spacingSq) continue;
+                    if (distanceSq < 1e-6f) {
+                        // Icons on the very same spot part along the line between their indices
+                        ex = i < j ? 1.0f : -1.0f;
+                        ey = 0.0f;
+                        distanceSq = 1.0f;
+                    }
+                    float distance = std::sqrt(distanceSq);
+                    float push = config.repulsion * (spacing - distance) / distance;
+                    ax += ex * push;
+                    ay += ey * push;
+                }
+            }
+        }
+
+        // Pull towards the path; an icon that strayed out of reach heads for where it last saw it
+        sf::Vector2f anchor(anchorX[i], anchorY[i]);
+        if (nearestOnPath(sf::Vector2f(px, py), 1, anchor)) {
+            anchorX[i] = anchor.x;
+            anchorY[i] = anchor.y;
+        }
+        ax += config.pathStiffness * (anchor.x - px) - config.damping * vx[i];
+        ay += config.pathStiffness * (anchor.y - py) - config.damping * vy[i];
+
+        float nvx = vx[i] + ax * dt, nvy = vy[i] + ay * dt;
+        float speed = std::sqrt(nvx * nvx + nvy * nvy);
+        if (speed > config.maxSpeed) {
+            nvx *= config.maxSpeed / speed;
+            nvy *= config.maxSpeed / speed;
+            speed = config.maxSpeed;
+        }
+        nextVx[i] = nvx;
+        nextVy[i] = nvy;
+        nextX[i] = px + nvx * dt;
+        nextY[i] = py + nvy * dt;
+        return speed;
+    }
+
+    PhysicsSettings config;
+    // Icon state, one array per component; next* receive the step being computed
+    std::vector<float> x, y, vx, vy;
+    std::vector<float> nextX, nextY, nextVx, nextVy;
+    std::vector<float> anchorX, anchorY; // nearest path point last found
+    // Neighbour hash: the icons of bucket b are bucketIcons[bucketStart[b] .. bucketStart[b + 1])
+    uint32_t table = 0;
+    std::vector<uint32_t> bucketStart, bucketOf, bucketIcons, fill;
+    // Path hash, laid out the same way
+    std::vector<Segment> segments;
+    uint32_t pathTable = 64;
+    std::vector<uint32_t> pathStart, pathSegments;
+    sf::Time accumulated;
+    float fastest = 0.0f;
+    size_t stepCount = 0;
+};
+
+#endif // ICON_PHYSICS_H
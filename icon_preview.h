@@ -0,0 +1,156 @@
+#ifndef ICON_PREVIEW_H
+#define ICON_PREVIEW_H
+
+#include <SFML/Graphics/Color.hpp>
+#include <SFML/Graphics/PrimitiveType.hpp>
+#include <SFML/Graphics/RenderTarget.hpp>
+#include <SFML/Graphics/Texture.hpp>
+#include <SFML/Graphics/Vertex.hpp>
+#include <SFML/System/Vector2.hpp>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "icon_atlas.h"
+
+// Corners of a marker polygon
+const int ICON_MARKER_SIDES = 8;
+
+// Markers for where the desktop icons would land, optionally with their
+// current positions and a line to their target. Every marker goes into one
+// triangle list that is rewritten in place each update, so a frame costs a
+// single draw call however many icons there are. Given the icons' pictures and
+// labels from an IconAtlas, targets show those instead of plain markers; the
+// markers then sample the atlas' white texel so they still share the draw.
+class IconPreview {
+public:
+    IconPreview(float radius = 4.0f, sf::Color targetColor = sf::Color(255, 80, 80),
+                sf::Color currentColor = sf::Color(80, 160, 255, 160))
+        : radius(radius), targetColor(targetColor), currentColor(currentColor),
+          lineColor(currentColor.r, currentColor.g, currentColor.b, currentColor.a / 2) {
+        for (int i = 0; i < ICON_MARKER_SIDES; ++i) {
+            float angle = 6.2831853f * i / ICON_MARKER_SIDES;
+            corners[i] = sf::Vector2f(std::cos(angle), std::sin(angle));
+        }
+    }
+
+    // visuals[i] is drawn for icon i; atlas is the texture they point into
+    void setVisuals(std::vector<IconVisual> iconVisuals, const sf::Texture* atlasTexture, sf::Vector2f whiteTexel) {
+        visuals = std::move(iconVisuals);
+        atlas = atlasTexture;
+        white = whiteTexel;
+    }
+
+    // current may be empty; otherwise current[i] is where icon i is now.
+    // Markers, pictures and labels keep their size in screen pixels whatever
+    // the zoom: unitsPerPixel is how many target units one pixel covers.
+    // Target i belongs to icon iconOf[i], or to icon i if iconOf is empty.
+    void update(const std::vector<sf::Vector2f>& targets, const std::vector<sf::Vector2f>& current = {},
+                float unitsPerPixel = 1.0f, const std::vector<int>& iconOf = {}) {
+        auto icon = [&](size_t i) { return i < iconOf.size() ? static_cast<size_t>(iconOf[i]) : i; };
+        size_t moving = 0;
+        for (size_t i = 0; i < targets.size(); ++i) moving += icon(i) < current.size();
+        size_t count = current.size() * MARKER_VERTICES + moving * 6;
+        for (size_t i = 0; i < targets.size(); ++i) {
+            const IconVisual* visual = icon(i) < visuals.size() ? &visuals[icon(i)] : nullptr;
+            bool picture = visual && visual->image.size.x > 0.0f;
+            count += (picture ? 6 : MARKER_VERTICES) + (visual ? visual->label.size() * 6 : 0);
+        }
+        vertices.resize(count);
+
+        size_t v = 0;
+        scale = unitsPerPixel;
+        // Lines first so the markers cover their ends
+        for (size_t i = 0; i < targets.size(); ++i) {
+            if (icon(i) < current.size()) v = writeLine(v, current[icon(i)], targets[i]);
+        }
+        for (const auto& p : current) v = writeMarker(v, p, radius * 0.75f, currentColor);
+        for (size_t i = 0; i < targets.size(); ++i) {
+            const IconVisual* visual = icon(i) < visuals.size() ? &visuals[icon(i)] : nullptr;
+            if (visual && visual->image.size.x > 0.0f) {
+                // Picture centred on the target, label under it
+                sf::Vector2f size = visual->image.size;
+                v = writeQuad(v, sf::FloatRect(targets[i] - size * (0.5f * scale), size * scale), visual->image, sf::Color::White);
+            } else {
+                v = writeMarker(v, targets[i], radius, targetColor);
+            }
+            if (!visual) continue;
+            float below = visual->image.size.x > 0.0f ? visual->image.size.y * 0.5f + LABEL_GAP : radius + LABEL_GAP;
+            for (const GlyphQuad& glyph : visual->label) {
+                sf::Vector2f origin = targets[i] + (glyph.bounds.position + sf::Vector2f(0.0f, below)) * scale;
+                v = writeQuad(v, sf::FloatRect(origin, glyph.bounds.size * scale), glyph.texture, labelColor);
+            }
+        }
+        markers = targets.size() + current.size();
+    }
+
+    void clear() {
+        vertices.clear();
+        markers = 0;
+    }
+
+    void draw(sf::RenderTarget& target) const {
+        if (vertices.empty()) return;
+        sf::RenderStates states;
+        states.texture = atlas;
+        target.draw(vertices.data(), vertices.size(), sf::PrimitiveType::Triangles, states);
+    }
+
+    size_t markerCount() const { return markers; }
+    size_t vertexCount() const { return vertices.size(); }
+
+private:
+    static const size_t MARKER_VERTICES = 3 * (ICON_MARKER_SIDES - 2);
+    // Pixels between a picture and its label
+    static constexpr float LABEL_GAP = 2.0f;
+
+    // A filled polygon as a fan of triangles
+    size_t writeMarker(size_t v, sf::Vector2f center, float r, sf::Color color) {
+        r *= scale;
+        for (int i = 1; i + 1 < ICON_MARKER_SIDES; ++i) {
+            vertices[v++] = sf::Vertex{center + corners[0] * r, color, white};
+            vertices[v++] = sf::Vertex{center + corners[i] * r, color, white};
+            vertices[v++] = sf::Vertex{center + corners[i + 1] * r, color, white};
+        }
+        return v;
+    }
+
+    // A one pixel wide quad from a to b
+    size_t writeLine(size_t v, sf::Vector2f a, sf::Vector2f b) {
+        sf::Vector2f d = b - a;
+        float length = std::sqrt(d.x * d.x + d.y * d.y);
+        sf::Vector2f n = length > 0.0f ? sf::Vector2f(-d.y, d.x) * (0.5f * scale / length) : sf::Vector2f(0.0f, 0.0f);
+        vertices[v++] = sf::Vertex{a + n, lineColor, white};
+        vertices[v++] = sf::Vertex{a - n, lineColor, white};
+        vertices[v++] = sf::Vertex{b + n, lineColor, white};
+        vertices[v++] = sf::Vertex{b + n, lineColor, white};
+        vertices[v++] = sf::Vertex{a - n, lineColor, white};
+        vertices[v++] = sf::Vertex{b - n, lineColor, white};
+        return v;
+    }
+
+    // A rectangle showing part of the atlas
+    size_t writeQuad(size_t v, const sf::FloatRect& rect, const sf::FloatRect& texture, sf::Color color) {
+        sf::Vector2f p0 = rect.position, p1 = rect.position + rect.size;
+        sf::Vector2f t0 = texture.position, t1 = texture.position + texture.size;
+        vertices[v++] = sf::Vertex{p0, color, t0};
+        vertices[v++] = sf::Vertex{{p1.x, p0.y}, color, {t1.x, t0.y}};
+        vertices[v++] = sf::Vertex{{p0.x, p1.y}, color, {t0.x, t1.y}};
+        vertices[v++] = sf::Vertex{{p0.x, p1.y}, color, {t0.x, t1.y}};
+        vertices[v++] = sf::Vertex{{p1.x, p0.y}, color, {t1.x, t0.y}};
+        vertices[v++] = sf::Vertex{p1, color, t1};
+        return v;
+    }
+
+    float radius;
+    sf::Color targetColor, currentColor, lineColor;
+    sf::Color labelColor = sf::Color(240, 240, 240);
+    sf::Vector2f corners[ICON_MARKER_SIDES];
+    std::vector<IconVisual> visuals;
+    const sf::Texture* atlas = nullptr;
+    sf::Vector2f white;
+    float scale = 1.0f;
+    std::vector<sf::Vertex> vertices;
+    size_t markers = 0;
+};
+
+#endif // ICON_PREVIEW_H
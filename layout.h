@@ -0,0 +1,341 @@
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+#include <SFML/System/Vector2.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "shape_fill.h"
+#include "stroke_history.h"
+
+// Running length and drawing time at every point of a stroke in canvas
+// coordinates. Finished strokes never change, so this is computed once per
+// stroke; the live stroke just appends. The sums are doubles: over a million
+// points a float total drifts by whole units.
+struct StrokeProgress {
+    std::vector<sf::Vector2f> points;
+    std::vector<double> length; // length[i]: path length from point 0 to point i
+    std::vector<double> time;   // time[i]: drawing time (never decreasing) up to point i
+    float lastTime = 0.0f;
+
+    size_t size() const { return points.size(); }
+    double totalLength() const { return length.empty() ? 0.0 : length.back(); }
+    double totalTime() const { return time.empty() ? 0.0 : time.back(); }
+
+    void append(sf::Vector2f point, float pointTime) {
+        if (points.empty()) {
+            length.push_back(0.0);
+            time.push_back(0.0);
+        } else {
+            sf::Vector2f d = point - points.back();
+            length.push_back(length.back() + std::sqrt(static_cast<double>(d.x) * d.x + static_cast<double>(d.y) * d.y));
+            time.push_back(time.back() + std::max(0.0f, pointTime - lastTime));
+        }
+        points.push_back(point);
+        lastTime = pointTime;
+    }
+
+    void clear() {
+        points.clear();
+        length.clear();
+        time.clear();
+        lastTime = 0.0f;
+    }
+};
+
+inline StrokeProgress MakeProgress(const std::vector<sf::Vector2f>& points, const std::vector<float>& times) {
+    StrokeProgress progress;
+    progress.points.reserve(points.size());
+    progress.length.reserve(points.size());
+    progress.time.reserve(points.size());
+    for (size_t i = 0; i < points.size(); ++i) progress.append(points[i], times[i]);
+    return progress;
+}
+
+// The point distance units along a stroke (clamped to its ends): a binary
+// search for the segment, then interpolation inside it
+inline sf::Vector2f PointAtLength(const StrokeProgress& stroke, double distance) {
+    if (stroke.size() == 0) return sf::Vector2f(0.0f, 0.0f);
+    if (distance <= 0.0) return stroke.points.front();
+    if (distance >= stroke.totalLength()) return stroke.points.back();
+    size_t i = std::upper_bound(stroke.length.begin(), stroke.length.end(), distance) - stroke.length.begin();
+    double l0 = stroke.length[i - 1], l1 = stroke.length[i];
+    float t = l1 > l0 ? static_cast<float>((distance - l0) / (l1 - l0)) : 0.0f;
+    return stroke.points[i - 1] + (stroke.points[i] - stroke.points[i - 1]) * t;
+}
+
+// Picks count positions along the strokes so each gets an equal share of the
+// total weight. A segment's weight blends its share of the total length with
+// its share of the total drawing time; densityBlend 0 spaces icons evenly by
+// length and 1 by time, so slowly drawn sections receive more icons. The gaps
+// between strokes carry no weight, so nothing lands between them.
+//
+// With the running totals precomputed, each stroke costs O(1) and each icon
+// a binary search inside the stroke it lands on.
+inline std::vector<sf::Vector2f> PlaceAlongProgress(const std::vector<const StrokeProgress*>& strokes, int count, float densityBlend) {
+    std::vector<sf::Vector2f> placed;
+    if (count <= 0) return placed;
+
+    double totalLength = 0.0, totalTime = 0.0;
+    for (const StrokeProgress* stroke : strokes) {
+        totalLength += stroke->totalLength();
+        totalTime += stroke->totalTime();
+    }
+    if (totalTime <= 0.0) densityBlend = 0.0f;
+    if (totalLength <= 0.0) {
+        for (const StrokeProgress* stroke : strokes) {
+            if (stroke->size() > 0 && (int)placed.size() < count) placed.push_back(stroke->points.front());
+        }
+        return placed;
+    }
+
+    double lengthScale = (1.0 - densityBlend) / totalLength;
+    double timeScale = densityBlend > 0.0f ? densityBlend / totalTime : 0.0;
+    placed.reserve(count);
+
+    double walked = 0.0;
+    for (const StrokeProgress* stroke : strokes) {
+        if (stroke->size() < 2) continue;
+        auto weightAt = [&](size_t i) { return stroke->length[i] * lengthScale + stroke->time[i] * timeScale; };
+        double weight = weightAt(stroke->size() - 1);
+
+        while ((int)placed.size() < count) {
+            double target = count > 1 ? static_cast<double>(placed.size()) / (count - 1) : 0.0;
+            if (target > walked + weight) break;
+
+            // First point whose running weight reaches the target
+            double local = target - walked;
+            size_t lo = 1, hi = stroke->size() - 1;
+            while (lo < hi) {
+                size_t mid = (lo + hi) / 2;
+                if (weightAt(mid) < local) lo = mid + 1;
+                else hi = mid;
+            }
+            double w0 = weightAt(lo - 1), w1 = weightAt(lo);
+            float t = w1 > w0 ? static_cast<float>(std::clamp((local - w0) / (w1 - w0), 0.0, 1.0)) : 0.0f;
+            placed.push_back(stroke->points[lo - 1] + (stroke->points[lo] - stroke->points[lo - 1]) * t);
+        }
+        walked += weight;
+    }
+
+    // Rounding can leave the last targets just past the end of the path
+    for (auto it = strokes.rbegin(); it != strokes.rend() && (int)placed.size() < count; ++it) {
+        if ((*it)->size() == 0) continue;
+        while ((int)placed.size() < count) placed.push_back((*it)->points.back());
+    }
+    return placed;
+}
+
+// Icons a fixed arc length apart: each stroke gets one at its start and then
+// one every spacing units, so strokes drawn slowly or quickly get the same
+// spacing and nothing is placed across the gap between two strokes. Stops at
+// maxCount icons. Costs O(log n) per icon on top of the cached running lengths.
+inline std::vector<sf::Vector2f> PlaceEvenlySpaced(const std::vector<const StrokeProgress*>& strokes, float spacing, int maxCount) {
+    std::vector<sf::Vector2f> placed;
+    if (spacing <= 0.0f || maxCount <= 0) return placed;
+    for (const StrokeProgress* stroke : strokes) {
+        if (stroke->size() == 0) continue;
+        double total = stroke->totalLength();
+        for (size_t j = 0; j * static_cast<double>(spacing) <= total && (int)placed.size() < maxCount; ++j) {
+            placed.push_back(PointAtLength(*stroke, j * static_cast<double>(spacing)));
+        }
+        if ((int)placed.size() >= maxCount) break;
+    }
+    return placed;
+}
+
+// Shares count icons between strokes in proportion to their weights, rounding
+// by largest remainder so the shares add up to count exactly
+inline std::vector<int> AllocateIcons(const std::vector<double>& weights, int count) {
+    std::vector<int> shares(weights.size(), 0);
+    double total = 0.0;
+    for (double w : weights) total += std::max(w, 0.0);
+    if (count <= 0 || total <= 0.0) return shares;
+
+    std::vector<std::pair<double, size_t>> remainders;
+    int given = 0;
+    for (size_t i = 0; i < weights.size(); ++i) {
+        double quota = std::max(weights[i], 0.0) / total * count;
+        shares[i] = static_cast<int>(quota);
+        given += shares[i];
+        remainders.push_back({quota - shares[i], i});
+    }
+    std::sort(remainders.begin(), remainders.end(), [](const auto& a, const auto& b) {
+        return a.first != b.first ? a.first > b.first : a.second < b.second;
+    });
+    for (size_t i = 0; given < count && i < remainders.size(); ++i, ++given) ++shares[remainders[i].second];
+    return shares;
+}
+
+// Strokes with at least this many in total are laid out on worker threads
+const size_t PARALLEL_LAYOUT_POINTS = 200000;
+
+// Every stroke laid out as a path of its own: each gets a share of the icons
+// by its weight and spreads them from its first point to its last, so no icon
+// lands on the jump from one stroke to the next. Without weights a stroke
+// weighs its share of the drawing's length and time, blended as in
+// PlaceAlongProgress. A stroke with a single icon gets it at its middle.
+// Strokes are independent, so large drawings are split across threads.
+inline std::vector<sf::Vector2f> PlacePerStroke(const std::vector<const StrokeProgress*>& strokes, int count, float densityBlend,
+                                                const std::vector<double>& weights = {}, unsigned threads = 0) {
+    std::vector<sf::Vector2f> placed;
+    if (count <= 0 || strokes.empty()) return placed;
+
+    std::vector<double> strokeWeights = weights;
+    if (strokeWeights.size() != strokes.size()) {
+        double totalLength = 0.0, totalTime = 0.0;
+        for (const StrokeProgress* stroke : strokes) {
+            totalLength += stroke->totalLength();
+            totalTime += stroke->totalTime();
+        }
+        if (totalTime <= 0.0) densityBlend = 0.0f;
+        strokeWeights.assign(strokes.size(), 0.0);
+        for (size_t i = 0; i < strokes.size(); ++i) {
+            double lengthShare = totalLength > 0.0 ? strokes[i]->totalLength() / totalLength : 1.0 / strokes.size();
+            double timeShare = densityBlend > 0.0f ? strokes[i]->totalTime() / totalTime : 0.0;
+            strokeWeights[i] = lengthShare * (1.0 - densityBlend) + timeShare * densityBlend;
+        }
+    }
+    std::vector<int> shares = AllocateIcons(strokeWeights, count);
+
+    // Each stroke writes its own slice of the result
+    std::vector<size_t> offsets(strokes.size() + 1, 0);
+    size_t points = 0;
+    for (size_t i = 0; i < strokes.size(); ++i) {
+        offsets[i + 1] = offsets[i] + shares[i];
+        points += strokes[i]->size();
+    }
+    placed.resize(offsets.back());
+
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        for (size_t i = next++; i < strokes.size(); i = next++) {
+            if (shares[i] == 0 || strokes[i]->size() == 0) continue;
+            if (shares[i] == 1) {
+                placed[offsets[i]] = PointAtLength(*strokes[i], strokes[i]->totalLength() / 2.0);
+                continue;
+            }
+            std::vector<sf::Vector2f> own = PlaceAlongProgress({strokes[i]}, shares[i], densityBlend);
+            std::copy(own.begin(), own.end(), placed.begin() + offsets[i]);
+        }
+    };
+    if (threads == 0) threads = points >= PARALLEL_LAYOUT_POINTS ? std::max(1u, std::thread::hardware_concurrency()) : 1;
+    threads = std::min<unsigned>(threads, static_cast<unsigned>(strokes.size()));
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; ++t) pool.emplace_back(worker);
+    worker();
+    for (auto& thread : pool) thread.join();
+    return placed;
+}
+
+// Icons around closed loops (glyph outlines, traced shapes), each loop
+// getting a share by its length. A loop has no ends, so its icons sit at
+// the middles of equal parts of it instead of on both its first and last
+// point, which are the same spot. Loops are expected to end on their first point.
+inline std::vector<sf::Vector2f> PlaceAroundLoops(const std::vector<const StrokeProgress*>& loops, int count) {
+    std::vector<sf::Vector2f> placed;
+    if (count <= 0 || loops.empty()) return placed;
+    std::vector<double> lengths;
+    for (const StrokeProgress* loop : loops) lengths.push_back(loop->totalLength());
+    std::vector<int> shares = AllocateIcons(lengths, count);
+    placed.reserve(count);
+    for (size_t i = 0; i < loops.size(); ++i) {
+        double step = lengths[i] / std::max(shares[i], 1);
+        for (int k = 0; k < shares[i]; ++k) placed.push_back(PointAtLength(*loops[i], (k + 0.5) * step));
+    }
+    return placed;
+}
+
+inline std::vector<sf::Vector2f> PlaceAlongStrokes(const std::vector<StrokeSamples>& strokes, int count, float densityBlend) {
+    std::vector<StrokeProgress> progress;
+    progress.reserve(strokes.size());
+    for (const auto& stroke : strokes) progress.push_back(MakeProgress(stroke.points, stroke.times));
+    std::vector<const StrokeProgress*> pointers;
+    for (const auto& p : progress) pointers.push_back(&p);
+    return PlaceAlongProgress(pointers, count, densityBlend);
+}
+
+// Icon layout that is cheap to recompute every frame: the running totals of
+// finished strokes are cached by stroke id and the live stroke is extended
+// point by point, so a frame only pays for the icons it places.
+class IncrementalLayout {
+public:
+    // Call when the set of finished strokes changed; unchanged strokes keep their totals
+    void setStrokes(const std::vector<StrokePtr>& strokes) {
+        std::unordered_map<uint32_t, std::shared_ptr<const StrokeProgress>> kept;
+        order.clear();
+        for (const auto& stroke : strokes) {
+            auto it = cache.find(stroke->id);
+            std::shared_ptr<const StrokeProgress> progress = it != cache.end() ? it->second
+                : std::make_shared<const StrokeProgress>(MakeProgress(stroke->worldPoints(), stroke->times()));
+            kept[stroke->id] = progress;
+            order.push_back(progress.get());
+        }
+        cache = std::move(kept);
+    }
+
+    // Catches up with the live stroke's new points
+    void updateLive(const StrokeSamples& samples) {
+        if (samples.size() < live.size()) live.clear();
+        for (size_t i = live.size(); i < samples.size(); ++i) live.append(samples.points[i], samples.times[i]);
+    }
+
+    void clearLive() { live.clear(); }
+
+    std::vector<sf::Vector2f> place(int count, float densityBlend) const {
+        std::vector<const StrokeProgress*> strokes = order;
+        if (live.size() > 0) strokes.push_back(&live);
+        return PlaceAlongProgress(strokes, count, densityBlend);
+    }
+
+    std::vector<sf::Vector2f> placePerStroke(int count, float densityBlend) const {
+        std::vector<const StrokeProgress*> strokes = order;
+        if (live.size() > 0) strokes.push_back(&live);
+        return PlacePerStroke(strokes, count, densityBlend);
+    }
+
+    std::vector<sf::Vector2f> placeSpaced(float spacing, int maxCount) const {
+        std::vector<const StrokeProgress*> strokes = order;
+        if (live.size() > 0) strokes.push_back(&live);
+        return PlaceEvenlySpaced(strokes, spacing, maxCount);
+    }
+
+    // Blue-noise positions inside the closed strokes, the live one included
+    // once its ends meet; nothing if no stroke is closed
+    std::vector<sf::Vector2f> placeFilled(int count) const {
+        std::vector<const std::vector<sf::Vector2f>*> outlines;
+        for (const StrokeProgress* stroke : order) {
+            if (IsClosedStroke(stroke->points, stroke->totalLength())) outlines.push_back(&stroke->points);
+        }
+        if (IsClosedStroke(live.points, live.totalLength())) outlines.push_back(&live.points);
+        if (outlines.empty()) return {};
+        return FillShape(ShapeMask(outlines), count);
+    }
+
+    // The strokes the icons are placed along, the live one last
+    std::vector<const StrokeProgress*> paths() const {
+        std::vector<const StrokeProgress*> strokes = order;
+        if (live.size() > 0) strokes.push_back(&live);
+        return strokes;
+    }
+
+    size_t strokeCount() const { return order.size(); }
+
+    size_t pointCount() const {
+        size_t count = live.size();
+        for (const StrokeProgress* stroke : order) count += stroke->size();
+        return count;
+    }
+
+private:
+    std::unordered_map<uint32_t, std::shared_ptr<const StrokeProgress>> cache;
+    std::vector<const StrokeProgress*> order;
+    StrokeProgress live;
+};
+
+#endif // LAYOUT_H
@@ -1,38 +1,135 @@
 #include <SFML/Graphics.hpp>
 #include <iostream>
 #include <cmath>
+#include <fstream>
+#include <map>
+#include <unordered_set>
 #include <windows.h>
-#include "desktop_functions.h"
+#include "desktop_backend.h"
+#include "canvas_scene.h"
+#include "stroke_width.h"
+#include "text_outline.h"
+#include "layout.h"
+#include "frame_pacer.h"
+#include "software_raster.h"
+#include "stipple.h"
+#include "icon_physics.h"
+#include "icon_atlas.h"
+#include "icon_animation.h"
+#include "icon_assignment.h"
+#include "icon_grid.h"
+#include "icon_preview.h"
 
 using namespace sf;
 using namespace std;
 
-// Function to create a thick line between two points
-RectangleShape createThickLine(Vector2f point1, Vector2f point2, float thickness, Color color = Color::White) {
-    RectangleShape line;
-    
-    // Calculate the distance between points
-    Vector2f direction = point2 - point1;
-    float length = sqrt(direction.x * direction.x + direction.y * direction.y);
-    
-    // Set line properties
-    line.setSize(Vector2f(length, thickness));
-    line.setFillColor(color);
-    
-    float angle = atan2(direction.y, direction.x) * 180.0f / M_PI;
-    line.setRotation(sf::degrees(angle));
-    
-    // Set position to start point
-    line.setPosition(point1);
-    
-    return line;
+// Where the icons would go along the drawn strokes, in window coordinates.
+// With a spacing, icons sit that far apart along each stroke (extra icons stay
+// where they are); without one they are spread over the whole drawing, either
+// as one path or with each stroke getting its share as a path of its own.
+// With fill on, icons fill the inside of the closed strokes instead, as long
+// as there is one.
+vector<Vector2f> planIconLayout(const IncrementalLayout& layout, int iconCount, float densityBlend, float spacing, bool perStroke, bool fill) {
+    if (fill) {
+        vector<Vector2f> filled = layout.placeFilled(iconCount);
+        if (!filled.empty()) return filled;
+    }
+    if (spacing > 0.0f) return layout.placeSpaced(spacing, iconCount);
+    // Distribute icons along the drawn path, denser where it was drawn slowly
+    int iconsToPlace = min(iconCount, (int)layout.pointCount());
+    if (perStroke) return layout.placePerStroke(iconsToPlace, densityBlend);
+    return layout.place(iconsToPlace, densityBlend);
+}
+
+// Hands the layout the finished strokes whenever the history moved on
+void syncIconLayout(IncrementalLayout& layout, StrokeList& seenVersion, const StrokeHistory& history) {
+    if (seenVersion == history.current()) return;
+    seenVersion = history.current();
+    layout.setStrokes(CollectStrokes(seenVersion));
+}
+
+// Desktop icon positions mapped into the window
+vector<Vector2f> iconWindowPositions(const vector<IconRecord>& icons, float scaleX, float scaleY) {
+    vector<Vector2f> positions;
+    positions.reserve(icons.size());
+    for (const auto& icon : icons) {
+        positions.push_back(Vector2f(icon.position.x * scaleX, icon.position.y * scaleY));
+    }
+    return positions;
+}
+
+// Desktop positions for targets in window coordinates. With a grid every icon
+// gets a cell of its own, so Explorer's snapping has nothing to bump.
+vector<Vector2i> desktopTargets(const vector<Vector2f>& targets, float scaleX, float scaleY, const DesktopGrid* grid) {
+    vector<Vector2f> screen;
+    vector<Vector2i> positions;
+    screen.reserve(targets.size());
+    positions.reserve(targets.size());
+    for (const auto& target : targets) {
+        screen.push_back(Vector2f(target.x * scaleX, target.y * scaleY));
+        positions.push_back(Vector2i(static_cast<int>(screen.back().x), static_cast<int>(screen.back().y)));
+    }
+    if (grid) {
+        vector<Vector2i> cells = AssignGridCells(screen, *grid);
+        for (size_t i = 0; i < cells.size(); ++i) {
+            if (cells[i].x >= 0) positions[i] = grid->position(cells[i]);
+        }
+    }
+    return positions;
+}
+
+// Render the drawing and the planned icon positions to a PNG at desktop resolution,
+// entirely on the CPU
+bool exportPreview(const string& filename, const vector<StrokePtr>& strokes, const vector<Vector2f>& iconTargets,
+                   unsigned width, unsigned height, float canvasWidth, float canvasHeight) {
+    Clock exportClock;
+    Transform view;
+    view.scale(Vector2f(width / canvasWidth, height / canvasHeight));
+
+    SoftwareRasterizer rasterizer(width, height);
+    rasterizer.clear(Color::Black);
+    rasterizer.drawStrokes(strokes, Color::White, view);
+    rasterizer.drawCircles(iconTargets, 6.0f, Color(255, 80, 80), view);
+    float renderMs = exportClock.getElapsedTime().asSeconds() * 1000.0f;
+
+    bool saved = rasterizer.image().toImage().saveToFile(filename);
+    cout << "Exported " << filename << " (" << width << "x" << height << "): rendered in " << renderMs << " ms - "
+         << (saved ? "Success" : "Failed") << endl;
+    return saved;
+}
+
+void printHistoryMemory(const StrokeHistory& history) {
+    HistoryMemory usage = history.memoryUsage();
+    cout << "History: " << usage.entries << " versions, " << usage.strokes << " strokes, "
+         << usage.geometryBytes / 1024 << " KB geometry, " << usage.overheadBytes / 1024 << " KB overhead" << endl;
+}
+
+// Pictures and labels for the icon preview; each icon's picture is fetched only the first time it is seen
+vector<IconVisual> loadIconVisuals(DesktopBackend& desktop, IconAtlas& atlas, const vector<IconRecord>& icons, unsigned side) {
+    vector<IconVisual> visuals;
+    visuals.reserve(icons.size());
+    for (const auto& icon : icons) {
+        visuals.push_back(atlas.visual(icon.name, atlas.hasImage(icon.name) ? Image() : desktop.iconImage(icon, side), side));
+    }
+    cout << "Icon atlas: " << atlas.imageCount() << " pictures, " << atlas.glyphCount() << " glyphs, "
+         << atlas.occupancy() * 100.0f << "% used" << endl;
+    return visuals;
+}
+
+// Moves for every icon from where it is now to its new position, in the icons' order
+vector<IconTransition> iconTransitions(const vector<IconRecord>& icons, const vector<Vector2i>& destinations) {
+    vector<IconTransition> transitions;
+    for (size_t i = 0; i < icons.size(); ++i) {
+        transitions.push_back(IconTransition{icons[i].index, icons[i].position, destinations[i]});
+    }
+    return transitions;
 }
 
 // Function to restore desktop icons to their original positions
-void RestoreOriginalPositions(const vector<DesktopIcon>& originalPositions) {
+void RestoreOriginalPositions(DesktopBackend& desktop, const vector<IconRecord>& originalPositions) {
     cout << "Restoring " << originalPositions.size() << " icons to their original positions..." << endl;
     for (const auto& icon : originalPositions) {
-        bool success = MoveDesktopIcon(icon.index, icon.position.x, icon.position.y);
+        bool success = desktop.moveIcon(icon.index, icon.position);
         cout << "Restoring icon " << icon.index << " to (" << icon.position.x << ", " << icon.position.y << ") - " 
              << (success ? "Success" : "Failed") << endl;
     }
@@ -46,7 +143,13 @@ int main()
     int DESKTOP_Y = 800;
     int CELL_SIZE = 30;
     float LINETHICKNESS = 5.0f;
+    float DENSITY_BLEND = 0.5f; // how much drawing speed (vs. length) decides icon spacing
+    float ERASER_RADIUS = 10.0f;
+    float TARGET_FPS = 120.0f;  // frame rate while drawing; idle frames only render on events
     bool mousePressed = false;
+    bool eraserMode = false;
+    bool selectMode = false;
+    bool eraseMerging = false; // later steps of an eraser drag join the same undo entry
 
     int screenWidth = GetSystemMetrics(SM_CXSCREEN);
     int screenHeight = GetSystemMetrics(SM_CYSCREEN);
@@ -55,32 +158,261 @@ int main()
     // create the window
     RenderWindow window(VideoMode({DESKTOP_X, DESKTOP_Y}), "My window");
 
-    vector<Vector2f> currentStroke;  // Points for the current drawing stroke
-    vector<RectangleShape> lines;
+    // Width curves selectable with W; per-point widths come from drawing speed
+    vector<WidthCurve> widthCurves = {
+        {"constant", LINETHICKNESS, LINETHICKNESS, 0.0f, 0.0f, 1.0f, 0.0f},
+        {"pen", 2.5f, 7.0f, 100.0f, 1500.0f, 1.0f, 0.6f},
+        {"brush", 2.0f, 14.0f, 50.0f, 1200.0f, 0.6f, 0.75f},
+    };
+    size_t widthCurveIndex = 1;
+    float maxLineWidth = 0.0f;
+    for (const auto& curve : widthCurves) maxLineWidth = max(maxLineWidth, curve.maxWidth);
+    bool densityByVelocity = true;
+    // Arc length between icons cycled with G; 0 spreads them over the whole drawing
+    vector<float> iconSpacings = {0.0f, 15.0f, 30.0f, 60.0f};
+    size_t iconSpacingIndex = 0;
+    // M: every stroke gets icons in proportion to its length instead of one path through all of them
+    bool layoutPerStroke = false;
+    // F: icons fill closed shapes (circles, hearts) rather than lining their outline
+    bool fillShapes = false;
+    // O: finished strokes that look like lines, circles, ellipses, rectangles or
+    // polygons are replaced by the exact shape
+    bool regularizeShapes = false;
+
+    // Join style cycled with J; round joins and caps by default
+    StrokeStyle strokeStyle;
+
+    WidthTracker widthTracker;
+    Clock strokeClock;
+
+    // Finished strokes live in the scene's history; all strokes are drawn from one vertex batch
+    CanvasScene scene(strokeStyle, maxLineWidth, static_cast<float>(CELL_SIZE));
+    // F5 records the session for the headless render tests
+    ofstream sessionFile;
+    Selection selection;
+
+    // The canvas is unbounded: pan with the middle mouse button, zoom with the wheel,
+    // Home goes back to the original view. Canvas units still map to the desktop as before.
+    View canvasView = window.getDefaultView();
+    bool panning = false;
+    Vector2i panFrom;
+    auto toCanvas = [&](Vector2i pixel) { return window.mapPixelToCoords(pixel, canvasView); };
     
     // Desktop integration
-    vector<DesktopIcon> desktopIcons;
-    vector<DesktopIcon> originalIconPositions; // Store original positions for restoration
-    vector<CircleShape> iconDots;
+    WindowsDesktop desktop;
+    vector<IconRecord> desktopIcons;
+    vector<IconRecord> originalIconPositions; // Store original positions for restoration
     bool showDesktopIcons = false;
+    bool showCurrentPositions = false;
+    // N: snap targets to the desktop's icon grid, one icon per cell
+    bool snapToGrid = true;
+    DesktopGrid desktopGrid;
+    vector<Vector2f> iconPositions; // where the icons are now, in window coordinates
+    // Which icon goes to which target: the one that makes the icons travel least.
+    // That is solved when Space moves the icons; the preview only extends its last answer.
+    IconAssignment iconAssigner;
+    vector<int> previewAssignment;
+    vector<Vector2f> previewAssignedTargets;
+    // Target positions follow the drawing live; the layout is kept up to date incrementally
+    IncrementalLayout iconLayout;
+    StrokeList iconLayoutVersion;
+    IconPreview iconPreview;
+    // The icons' own pictures and names, packed into one texture for the preview
+    const unsigned ICON_THUMBNAIL = 24;
+    IconAtlas iconAtlas;
+    Font labelFont;
+    bool fontLoaded = labelFont.openFromFile("C:/Windows/Fonts/segoeui.ttf") || labelFont.openFromFile("C:/Windows/Fonts/arial.ttf");
+    if (iconAtlas.create()) {
+        if (fontLoaded) {
+            iconAtlas.setFont(&labelFont, 11, 72.0f);
+        } else {
+            cout << "No label font found, preview icons have no names" << endl;
+        }
+    }
+    LatencyStats previewCost;
     bool originalPositionsSaved = false;
+    // Icons glide to their new places instead of jumping; T cycles the duration, 0 moves them at once
+    IconAnimator iconAnimator(desktop);
+    vector<Time> animationDurations = {milliseconds(600), milliseconds(1200), milliseconds(300), Time::Zero};
+    size_t animationDurationIndex = 0;
+    Clock animationClock;
+    bool animating = false;
+    // L: icons spell out typed text along its glyph outlines instead of following the drawing
+    bool textMode = false;
+    bool editingText = false;
+    // The L that starts an edit also arrives as text; it isn't part of it
+    bool ignoreTypedL = false;
+    u32string iconText;
+    TextLayout textLayout;
+    auto spellingText = [&]() { return textMode && fontLoaded && !iconText.empty(); };
+
+    // I: icons reproduce coords.png, denser where it has more ink. Relaxing
+    // the layout takes a moment, so it is only redone when the icon count changes.
+    bool stippleMode = false;
+    Image stippleImage;
+    vector<Vector2f> stippleTargets;
+    int stippleCount = -1;
+    auto stippling = [&]() { return stippleMode && stippleImage.getSize().x > 0; };
+
+    // Where the icons would go, in window coordinates. Text and images are fitted
+    // to the screen rather than the window so they aren't stretched on the desktop.
+    auto layoutIcons = [&](int iconCount) {
+        if (stippling()) {
+            if (stippleCount != iconCount) {
+                Clock stippleClock;
+                DensityMap density = DensityMap::fromImage(stippleImage, max<size_t>((size_t)iconCount * STIPPLE_PIXELS_PER_ICON, 65536));
+                StippleResult stipple = StippleDensity(density, iconCount);
+                Vector2f size(stippleImage.getSize());
+                float scale = min(screenWidth / size.x, screenHeight / size.y);
+                Vector2f offset((screenWidth - size.x * scale) / 2.0f, (screenHeight - size.y * scale) / 2.0f);
+                stippleTargets.clear();
+                for (Vector2f p : stipple.points) {
+                    Vector2f screen = offset + p * scale;
+                    stippleTargets.push_back(Vector2f(screen.x * DESKTOP_X / screenWidth, screen.y * DESKTOP_Y / screenHeight));
+                }
+                stippleCount = iconCount;
+                cout << "Stippled " << stipple.points.size() << " icons in " << stippleClock.getElapsedTime().asSeconds() * 1000.0f << " ms: "
+                     << stipple.iterations << " iterations" << (stipple.converged ? "" : " (not converged)") << endl;
+            }
+            return stippleTargets;
+        }
+        if (spellingText()) {
+            FloatRect box({screenWidth * 0.1f, screenHeight * 0.1f}, {screenWidth * 0.8f, screenHeight * 0.8f});
+            textLayout.set(labelFont, iconText, box);
+            vector<Vector2f> targets = textLayout.place(iconCount);
+            for (auto& p : targets) p = Vector2f(p.x * DESKTOP_X / screenWidth, p.y * DESKTOP_Y / screenHeight);
+            return targets;
+        }
+        return planIconLayout(iconLayout, iconCount, densityByVelocity ? DENSITY_BLEND : 0.0f, iconSpacings[iconSpacingIndex], layoutPerStroke, fillShapes);
+    };
+
+    // A: icons settle along the drawing as particles pulled onto the strokes
+    // and kept a grid cell apart, instead of staying where the layout put them.
+    // The preview shows the simulation running; Space and X use where it settles.
+    bool physicsMode = false;
+    const int PHYSICS_MAX_STEPS = 600;
+    IconPhysics iconPhysics;
+    vector<Vector2f> physicsSeed;
+    Clock physicsClock;
+    bool simulating = false;
+    auto relaxedTargets = [&](const vector<Vector2f>& targets, bool settle) {
+        if (!physicsMode || stippling() || spellingText() || fillShapes || targets.empty()) {
+            simulating = false;
+            return targets;
+        }
+        // A new layout starts the simulation over from it
+        if (targets != physicsSeed) {
+            PhysicsSettings settings = iconPhysics.settings();
+            settings.spacing = desktopGrid.spacing.x * (float)DESKTOP_X / screenWidth;
+            iconPhysics.setSettings(settings);
+            iconPhysics.setPath(iconLayout.paths());
+            iconPhysics.reset(targets);
+            physicsSeed = targets;
+            physicsClock.restart();
+        }
+        if (settle) iconPhysics.settle(PHYSICS_MAX_STEPS);
+        else iconPhysics.advance(physicsClock.restart());
+        simulating = !iconPhysics.settled();
+        return iconPhysics.positions();
+    };
+
+    // A new move starts from wherever a running animation has got the icons to
+    auto startIconAnimation = [&](const vector<Vector2i>& destinations) {
+        if (iconAnimator.active() && iconAnimator.size() == desktopIcons.size()) {
+            for (size_t i = 0; i < desktopIcons.size(); ++i) desktopIcons[i].position = iconAnimator.position(i);
+        }
+        iconAnimator.start(iconTransitions(desktopIcons, destinations), animationClock.getElapsedTime());
+        for (size_t i = 0; i < desktopIcons.size(); ++i) desktopIcons[i].position = destinations[i];
+    };
+
+    FramePacer pacer(TARGET_FPS, milliseconds(500));
 
     // run the program as long as the window is open
     while (window.isOpen())
     {
-        // check all the window's events that were triggered since the last iteration of the loop
-        while (const std::optional event = window.pollEvent())
+        // Icons on their way send their next batch of moves when it is due
+        if (iconAnimator.active()) {
+            animating = iconAnimator.update(animationClock.getElapsedTime());
+            for (size_t i = 0; i < iconAnimator.size() && i < iconPositions.size(); ++i) {
+                Vector2i p = iconAnimator.position(i);
+                iconPositions[i] = Vector2f(p.x * (float)DESKTOP_X / screenWidth, p.y * (float)DESKTOP_Y / screenHeight);
+            }
+            pacer.requestRedraw();
+            if (!animating) {
+                const AnimationStats& stats = iconAnimator.stats();
+                cout << "Icons arrived: " << stats.moves << " moves in " << stats.ticks << " ticks, "
+                     << stats.ipcTime.asSeconds() * 1000.0f << " ms in the desktop (worst tick " << stats.worstTick.asSeconds() * 1000.0f
+                     << " ms), " << iconAnimator.moveCostEstimate().asMicroseconds() << " us per move" << endl;
+            }
+        }
+
+        // check all the window's events that were triggered since the last iteration of the loop;
+        // when nothing is being drawn, block until one arrives instead of spinning
+        for (std::optional event = pacer.firstEvent(window, mousePressed || animating || simulating); event; event = window.pollEvent())
         {
+            pacer.eventHandled();
+            if (mousePressed && event->is<Event::MouseMoved>())
+                pacer.inputArrived();
+
             // "close requested" event: we close the window
             if (event->is<Event::Closed>())
                 window.close();
+
+            // Pan the canvas while the middle button is held
+            if (const auto* pressed = event->getIf<Event::MouseButtonPressed>(); pressed && pressed->button == Mouse::Button::Middle) {
+                panning = true;
+                panFrom = pressed->position;
+            }
+            if (const auto* released = event->getIf<Event::MouseButtonReleased>(); released && released->button == Mouse::Button::Middle) {
+                panning = false;
+            }
+            if (const auto* moved = event->getIf<Event::MouseMoved>(); moved && panning) {
+                canvasView.move(toCanvas(panFrom) - toCanvas(moved->position));
+                panFrom = moved->position;
+            }
+
+            // Zoom around the cursor with the wheel
+            if (const auto* wheel = event->getIf<Event::MouseWheelScrolled>()) {
+                float zoom = canvasView.getSize().x / window.getSize().x;
+                float factor = pow(1.15f, -wheel->delta);
+                factor = clamp(zoom * factor, 1.0f / 16.0f, 64.0f) / zoom;
+                Vector2f before = toCanvas(wheel->position);
+                canvasView.zoom(factor);
+                canvasView.move(before - toCanvas(wheel->position));
+            }
                 
             // Handle mouse button press
             if (event->is<Event::MouseButtonPressed>()) {
                 if (event->getIf<Event::MouseButtonPressed>()->button == Mouse::Button::Left) {
                     mousePressed = true;
+                    eraseMerging = false;
+                    pacer.latency().reset();
+                    previewCost.reset();
+                    pacer.inputArrived();
+
+                    // In select mode: grab a handle or the selection, else pick a stroke, else box-select
+                    if (selectMode) {
+                        Vector2f pressPoint = toCanvas(event->getIf<Event::MouseButtonPressed>()->position);
+                        // Grab distances are in screen pixels, so they hold at any zoom
+                        float unitsPerPixel = canvasView.getSize().x / window.getSize().x;
+                        if (!selection.beginDrag(pressPoint, unitsPerPixel)) {
+                            StrokePtr picked = scene.index.pick(pressPoint, 4.0f * unitsPerPixel);
+                            if (picked) {
+                                vector<StrokePtr> selected;
+                                if (Keyboard::isKeyPressed(Keyboard::Key::LShift)) selected = selection.strokes;
+                                if (!selection.contains(picked->id)) selected.push_back(picked);
+                                selection.set(selected, scene.index);
+                                selection.beginDrag(pressPoint, unitsPerPixel);
+                            } else {
+                                selection.beginBoxSelect(pressPoint);
+                            }
+                        }
+                    }
+
                     // Start a new stroke - clear the current stroke points
-                    currentStroke.clear();
+                    if (!eraserMode && !selectMode) scene.beginStroke();
+                    widthTracker.reset();
+                    strokeClock.restart();
                 }
             }
             
@@ -88,28 +420,252 @@ int main()
             if (event->is<Event::MouseButtonReleased>()) {
                 if (event->getIf<Event::MouseButtonReleased>()->button == Mouse::Button::Left) {
                     mousePressed = false;
-                    // End the current stroke - clear the points so next stroke doesn't connect
-                    currentStroke.clear();
+
+                    // Report how quickly mouse movement reached the screen during the drag
+                    const LatencyStats& latency = pacer.latency();
+                    if (latency.count() > 0) {
+                        cout << "Input latency over " << latency.count() << " frames: avg " << latency.average()
+                             << " ms, p95 " << latency.percentile(0.95f) << " ms, max " << latency.percentile(1.0f) << " ms" << endl;
+                    }
+                    if (previewCost.count() > 0) {
+                        cout << "Icon preview of " << iconPreview.markerCount() << " markers: avg " << previewCost.average()
+                             << " ms, max " << previewCost.percentile(1.0f) << " ms per frame" << endl;
+                    }
+
+                    // Finish a selection drag: commit the transform as one edit, or select the box
+                    if (selection.transforming()) {
+                        if (selection.dragTransform != Transform::Identity) {
+                            selection.set(scene.retransform(selection.strokes, selection.dragTransform), scene.index);
+                        }
+                    } else if (selection.drag == SelectionDrag::Box) {
+                        vector<StrokePtr> selected;
+                        for (uint32_t id : scene.index.queryBox(selection.dragBox())) {
+                            selected.push_back(scene.index.stroke(id));
+                        }
+                        selection.set(selected, scene.index);
+                        cout << "Selected " << selected.size() << " strokes" << endl;
+                    }
+                    selection.drag = SelectionDrag::None;
+                    selection.dragTransform = Transform::Identity;
+
+                    // Commit the finished stroke to the history; its vertices stay in the batch.
+                    // This also ends the stroke so the next one doesn't connect.
+                    if (!eraserMode && !selectMode) {
+                        StrokePtr stroke = scene.endStroke();
+                        if (stroke && regularizeShapes) {
+                            RecognizedShape shape = scene.regularize({stroke}, true).front();
+                            if (shape.kind != ShapeKind::None) {
+                                cout << "Recognized a " << ShapeName(shape.kind) << " (confidence " << shape.confidence << "): "
+                                     << stroke->size() << " points down to " << ShapeOutline(shape).size() << endl;
+                            }
+                        }
+                    }
                 }
             }
             
             // Clear lines with right click
             if (event->is<Event::MouseButtonPressed>()) {
                 if (event->getIf<Event::MouseButtonPressed>()->button == Mouse::Button::Right) {
-                    currentStroke.clear();
-                    lines.clear();
+                    if (scene.clear()) selection.clear();
                 }
             }
             
+            // While typing the text to spell, keys go to the text instead of the shortcuts.
+            // Enter or Escape finishes, Ctrl+Enter starts a new line.
+            if (editingText) {
+                if (const auto* typed = event->getIf<Event::TextEntered>()) {
+                    bool typedL = typed->unicode == U'l' || typed->unicode == U'L';
+                    if (ignoreTypedL && typedL) {
+                        ignoreTypedL = false;
+                        continue;
+                    }
+                    ignoreTypedL = false;
+                    if (typed->unicode == U'\b') {
+                        if (!iconText.empty()) iconText.pop_back();
+                    } else if (typed->unicode == U'\r') {
+                        editingText = false;
+                    } else if (typed->unicode == U'\n' || typed->unicode >= 32) {
+                        iconText += typed->unicode;
+                    }
+                    cout << (editingText ? "Text: " : "Spelling: ") << String::fromUtf32(iconText.begin(), iconText.end()).toAnsiString() << endl;
+                    continue;
+                }
+                if (const auto* key = event->getIf<Event::KeyPressed>()) {
+                    ignoreTypedL = false;
+                    if (key->code == Keyboard::Key::Escape) editingText = false;
+                    continue;
+                }
+            }
+
             // Handle keyboard input
             if (event->is<Event::KeyPressed>()) {
+                const auto* key = event->getIf<Event::KeyPressed>();
+
+                // Undo with Ctrl+Z, redo with Ctrl+Y or Ctrl+Shift+Z
+                bool undoPressed = key->control && key->code == Keyboard::Key::Z && !key->shift;
+                bool redoPressed = key->control && (key->code == Keyboard::Key::Y || (key->code == Keyboard::Key::Z && key->shift));
+                if ((undoPressed || redoPressed) && !mousePressed) {
+                    if (undoPressed ? scene.undo() : scene.redo()) {
+                        selection.clear();
+                        cout << (undoPressed ? "Undo" : "Redo") << ": " << StrokeCount(scene.history.current()) << " strokes" << endl;
+                        printHistoryMemory(scene.history);
+                    } else {
+                        cout << (undoPressed ? "Nothing to undo" : "Nothing to redo") << endl;
+                    }
+                }
+
+                // Toggle the eraser tool on E
+                if (key->code == Keyboard::Key::E && !mousePressed) {
+                    eraserMode = !eraserMode;
+                    selectMode = false;
+                    selection.clear();
+                    cout << "Eraser " << (eraserMode ? "on" : "off") << endl;
+                }
+
+                // Toggle the select/transform tool on S
+                if (key->code == Keyboard::Key::S && !key->control && !mousePressed) {
+                    selectMode = !selectMode;
+                    eraserMode = false;
+                    if (!selectMode) selection.clear();
+                    cout << "Select " << (selectMode ? "on" : "off") << endl;
+                }
+
+                // Cycle the width curve on W, toggle speed-weighted icon density on V
+                if (key->code == Keyboard::Key::W && !mousePressed) {
+                    widthCurveIndex = (widthCurveIndex + 1) % widthCurves.size();
+                    cout << "Width curve: " << widthCurves[widthCurveIndex].name << endl;
+                }
+                if (key->code == Keyboard::Key::V) {
+                    densityByVelocity = !densityByVelocity;
+                    cout << "Icon density by drawing speed " << (densityByVelocity ? "on" : "off") << endl;
+                }
+                if (key->code == Keyboard::Key::N) {
+                    snapToGrid = !snapToGrid;
+                    cout << "Snap icons to the desktop grid " << (snapToGrid ? "on" : "off") << endl;
+                }
+                if (key->code == Keyboard::Key::M) {
+                    layoutPerStroke = !layoutPerStroke;
+                    cout << "Icon layout: " << (layoutPerStroke ? "each stroke on its own" : "one path through all strokes") << endl;
+                }
+                if (key->code == Keyboard::Key::G) {
+                    iconSpacingIndex = (iconSpacingIndex + 1) % iconSpacings.size();
+                    if (iconSpacings[iconSpacingIndex] > 0.0f) cout << "Icon spacing: " << iconSpacings[iconSpacingIndex] << " units along each stroke" << endl;
+                    else cout << "Icon spacing: spread over the whole drawing" << endl;
+                }
+                if (key->code == Keyboard::Key::I && !mousePressed) {
+                    stippleMode = !stippleMode;
+                    if (stippleMode && stippleImage.getSize().x == 0 && !stippleImage.loadFromFile("coords.png")) {
+                        cout << "Could not load coords.png" << endl;
+                        stippleMode = false;
+                    }
+                    if (stippleMode) textMode = editingText = false;
+                    cout << (stippleMode ? "Icons reproduce coords.png" : "Icons follow the drawing again") << endl;
+                }
+                if (key->code == Keyboard::Key::L && !mousePressed) {
+                    textMode = !textMode;
+                    if (textMode) stippleMode = false;
+                    editingText = textMode && fontLoaded;
+                    if (editingText) {
+                        // A new edit starts from empty text
+                        iconText.clear();
+                        ignoreTypedL = true;
+                    }
+                    if (textMode && !fontLoaded) cout << "No font found, can't spell text with icons" << endl;
+                    else if (textMode) cout << "Type the text for the icons to spell, Enter when done" << endl;
+                    else cout << "Icons follow the drawing again" << endl;
+                }
+                if (key->code == Keyboard::Key::O && !mousePressed) {
+                    regularizeShapes = !regularizeShapes;
+                    cout << "Shape recognition " << (regularizeShapes ? "on: strokes become exact lines, circles, ellipses and polygons" : "off") << endl;
+                }
+                if (key->code == Keyboard::Key::A) {
+                    physicsMode = !physicsMode;
+                    physicsSeed.clear();
+                    cout << "Icon physics " << (physicsMode ? "on: icons spread out along the strokes" : "off") << endl;
+                }
+                if (key->code == Keyboard::Key::F) {
+                    fillShapes = !fillShapes;
+                    cout << "Icon layout: " << (fillShapes ? "filling closed shapes" : "along the strokes") << endl;
+                }
+                if (key->code == Keyboard::Key::T) {
+                    animationDurationIndex = (animationDurationIndex + 1) % animationDurations.size();
+                    AnimationSettings settings = iconAnimator.settings();
+                    settings.duration = animationDurations[animationDurationIndex];
+                    iconAnimator.setSettings(settings);
+                    cout << "Icon moves take " << settings.duration.asMilliseconds() << " ms" << endl;
+                }
+
+                // Cycle the join style on J; every stroke is re-tessellated with it
+                if (key->code == Keyboard::Key::J && !mousePressed) {
+                    strokeStyle.join = static_cast<JoinStyle>((static_cast<int>(strokeStyle.join) + 1) % 3);
+                    scene.setStyle(strokeStyle);
+                    cout << "Join style: " << JoinStyleName(strokeStyle.join) << endl;
+                }
+
+                // Export the drawing and the planned icon layout to a PNG on X
+                if (key->code == Keyboard::Key::X && !mousePressed) {
+                    vector<StrokePtr> strokes = CollectStrokes(scene.history.current());
+                    vector<Vector2f> targets;
+                    if (showDesktopIcons && !desktopIcons.empty()) {
+                        syncIconLayout(iconLayout, iconLayoutVersion, scene.history);
+                        iconLayout.clearLive();
+                        targets = relaxedTargets(layoutIcons((int)desktopIcons.size()), true);
+                    }
+                    exportPreview("preview.png", strokes, targets, screenWidth, screenHeight, (float)DESKTOP_X, (float)DESKTOP_Y);
+                }
+
+                // Back to the original view on Home
+                if (key->code == Keyboard::Key::Home) {
+                    canvasView = window.getDefaultView();
+                }
+
+                // Record the session to session.txt on F5, for replaying in render_test
+                if (key->code == Keyboard::Key::F5 && !mousePressed) {
+                    if (scene.isRecording()) {
+                        scene.record(nullptr);
+                        sessionFile.close();
+                        cout << "Session recording stopped" << endl;
+                    } else {
+                        sessionFile.open("session.txt");
+                        scene.record(sessionFile ? &sessionFile : nullptr);
+                        cout << "Session recording " << (scene.isRecording() ? "started: session.txt" : "failed") << endl;
+                    }
+                }
+
+                // Toggle frame pacing on P (off spins as fast as possible, for comparison)
+                if (key->code == Keyboard::Key::P) {
+                    pacer.setEnabled(!pacer.isEnabled());
+                    cout << "Frame pacing " << (pacer.isEnabled() ? "on" : "off") << ", " << pacer.frames() << " frames rendered so far" << endl;
+                }
+
+                // Bake the selected strokes' transforms into their points on B
+                if (key->code == Keyboard::Key::B && !mousePressed && !selection.empty()) {
+                    selection.set(scene.bake(selection.strokes), scene.index);
+                    cout << "Baked transforms of " << selection.strokes.size() << " strokes" << endl;
+                }
+
+                // Show the icons' current positions next to the preview on C
+                if (key->code == Keyboard::Key::C) {
+                    showCurrentPositions = !showCurrentPositions;
+                    cout << "Current icon positions " << (showCurrentPositions ? "shown" : "hidden") << endl;
+                }
+
                 if (event->getIf<Event::KeyPressed>()->code == Keyboard::Key::D) {
                     // Toggle desktop icons display
                     showDesktopIcons = !showDesktopIcons;
                     if (showDesktopIcons) {
-                        // Get desktop icons
-                        desktopIcons = GetDesktopIcons();
-                        iconDots.clear();
+                        // Get desktop icons, as they are if a move is still under way
+                        iconAnimator.stop();
+                        animating = false;
+                        desktopIcons = desktop.icons();
+                        vector<Vector2i> positions;
+                        for (const auto& icon : desktopIcons) positions.push_back(icon.position);
+                        desktopGrid = DesktopGrid::fromIcons(desktop.screenSize(), desktop.gridSpacing(), positions);
+                        cout << "Desktop grid: " << desktopGrid.cells.x << "x" << desktopGrid.cells.y << " cells of "
+                             << desktopGrid.spacing.x << "x" << desktopGrid.spacing.y << " px" << endl;
+                        iconPositions = iconWindowPositions(desktopIcons, (float)DESKTOP_X / screenWidth, (float)DESKTOP_Y / screenHeight);
+                        iconPreview.setVisuals(loadIconVisuals(desktop, iconAtlas, desktopIcons, ICON_THUMBNAIL),
+                                               &iconAtlas.texture(), iconAtlas.whiteTexel());
                         
                         // Save original positions on first load
                         if (!originalPositionsSaved && !desktopIcons.empty()) {
@@ -119,7 +675,7 @@ int main()
                         }
                         cout << "Desktop icons displayed: " << desktopIcons.size() << " icons found" << endl;
                     } else {
-                        iconDots.clear();
+                        iconPreview.clear();
                         cout << "Desktop icons hidden" << endl;
                     }
                 }
@@ -131,45 +687,35 @@ int main()
                     if (showDesktopIcons && !desktopIcons.empty()) {
                             cout << "Desktop icons are shown and available" << endl;
                         
-                        // Arrange icons along drawn lines
-                        if (!lines.empty()) {
-                            cout << "Found " << lines.size() << " drawn line segments" << endl;
-                            
-                            // Collect all points from drawn lines
-                            vector<Vector2f> drawnPoints;
-                            for (const auto& line : lines) {
-                                Vector2f pos = line.getPosition();
-                                Vector2f size = line.getSize();
-                                float angle = line.getRotation().asDegrees() * M_PI / 180.0f;
-                                
-                                // Add start and end points of each line
-                                drawnPoints.push_back(pos);
-                                Vector2f endPoint;
-                                endPoint.x = pos.x + size.x * cos(angle);
-                                endPoint.y = pos.y + size.x * sin(angle);
-                                drawnPoints.push_back(endPoint);
-                            }
-                            
-                            cout << "Collected " << drawnPoints.size() << " points from drawn lines" << endl;
+                        // Arrange icons along drawn strokes
+                        vector<StrokePtr> strokes = CollectStrokes(scene.history.current());
+                        if (!strokes.empty() || spellingText() || stippling()) {
+                            cout << "Found " << strokes.size() << " drawn strokes" << endl;
                             
-                            // Distribute icons along the drawn path
-                            int iconsToPlace = min((int)desktopIcons.size(), (int)drawnPoints.size());
-                            for (int i = 0; i < iconsToPlace; ++i) {
-                                // Calculate which point along the path this icon should go to
-                                float t = (float)i / max(1, iconsToPlace - 1); // Normalize to 0-1
-                                int pointIndex = (int)(t * (drawnPoints.size() - 1));
-                                pointIndex = min(pointIndex, (int)drawnPoints.size() - 1);
-                                
-                                Vector2f windowPoint = drawnPoints[pointIndex];
-                                
-                                // Convert window coordinates to desktop coordinates
-                                int desktopX = static_cast<int>((windowPoint.x / DESKTOP_X) * screenWidth);
-                                int desktopY = static_cast<int>((windowPoint.y / DESKTOP_Y) * screenHeight);
-                                
-                                bool success = MoveDesktopIcon(i, desktopX, desktopY);
-                                cout << "Moving icon " << i << " to drawn point (" << desktopX << ", " << desktopY << ") - " 
-                                     << (success ? "Success" : "Failed") << endl;
-                            }
+                            syncIconLayout(iconLayout, iconLayoutVersion, scene.history);
+                            iconLayout.clearLive();
+                            vector<Vector2f> targets = relaxedTargets(layoutIcons((int)desktopIcons.size()), true);
+                            if (physicsMode && !simulating) cout << "Icons settled after " << iconPhysics.steps() << " steps" << endl;
+                            // Convert window coordinates to desktop coordinates
+                            vector<Vector2i> positions = desktopTargets(targets, (float)screenWidth / DESKTOP_X, (float)screenHeight / DESKTOP_Y,
+                                                                        snapToGrid ? &desktopGrid : nullptr);
+                            // Send each slot the icon that makes the whole move shortest
+                            vector<Vector2f> current, slots;
+                            for (const auto& icon : desktopIcons) current.push_back(Vector2f((float)icon.position.x, (float)icon.position.y));
+                            for (const auto& p : positions) slots.push_back(Vector2f((float)p.x, (float)p.y));
+                            Clock assignClock;
+                            vector<int> assignment = iconAssigner.solve(current, slots);
+                            cout << "Assigned " << slots.size() << " icons in " << assignClock.getElapsedTime().asSeconds() * 1000.0f
+                                 << " ms: " << TotalTravel(current, slots, assignment) << " px of travel (index order: "
+                                 << TotalTravel(current, slots, AssignByIndex(slots.size())) << " px)" << endl;
+
+                            // Icons without a slot stay where they are
+                            vector<Vector2i> destinations;
+                            for (const auto& icon : desktopIcons) destinations.push_back(icon.position);
+                            for (size_t i = 0; i < positions.size(); ++i) destinations[assignment[i]] = positions[i];
+                            startIconAnimation(destinations);
+                            cout << "Moving " << positions.size() << " icons to the drawn points over "
+                                 << iconAnimator.settings().duration.asMilliseconds() << " ms" << endl;
                         } else {
                             cout << "No lines drawn yet! Draw some lines first, then press Space." << endl;
                         }
@@ -180,7 +726,14 @@ int main()
                 if (event->getIf<Event::KeyPressed>()->code == Keyboard::Key::R) {
                     if (originalPositionsSaved && !originalIconPositions.empty()) {
                         cout << "R key pressed! Restoring original icon positions..." << endl;
-                        RestoreOriginalPositions(originalIconPositions);
+                        map<int, Vector2i> original;
+                        for (const auto& icon : originalIconPositions) original[icon.index] = icon.position;
+                        vector<Vector2i> destinations;
+                        for (const auto& icon : desktopIcons) {
+                            auto it = original.find(icon.index);
+                            destinations.push_back(it != original.end() ? it->second : icon.position);
+                        }
+                        startIconAnimation(destinations);
                     } else {
                         cout << "No original positions saved yet. Press D first to load icons." << endl;
                     }
@@ -188,59 +741,105 @@ int main()
             }
         }
 
-        if (window.hasFocus() && mousePressed) {
+        if (window.hasFocus() && mousePressed && eraserMode) {
+            Vector2f eraserPoint = toCanvas(Mouse::getPosition(window));
+
+            // Cut everything under the eraser; the whole drag is one undo step
+            if (scene.erase(eraserPoint, ERASER_RADIUS, eraseMerging)) {
+                eraseMerging = true;
+            }
+        } else if (window.hasFocus() && mousePressed && selectMode) {
+            // Dragging only updates the selection's transform; nothing is rewritten until release
+            selection.updateDrag(toCanvas(Mouse::getPosition(window)));
+        } else if (window.hasFocus() && mousePressed) {
             Vector2i mousePos = Mouse::getPosition(window);
-            Vector2f currentPoint(static_cast<float>(mousePos.x), static_cast<float>(mousePos.y));
+            Vector2f currentPoint = toCanvas(mousePos);
             
-            // Add point if it's far enough from the last point (to avoid too many points)
-            if (currentStroke.empty() || 
-                (sqrt(pow(currentPoint.x - currentStroke.back().x, 2) + pow(currentPoint.y - currentStroke.back().y, 2)) > 3.0f)) {
-                
-                // If we have a previous point in the current stroke, create a line to connect them
-                if (!currentStroke.empty()) {
-                    RectangleShape line = createThickLine(currentStroke.back(), currentPoint, LINETHICKNESS);
-                    lines.push_back(line);
-                }
+            // Add point if it's far enough on screen from the last point (to avoid too many points)
+            const StrokeSamples& currentStroke = scene.liveStroke();
+            float minSpacing = 3.0f * canvasView.getSize().x / window.getSize().x;
+            if (currentStroke.points.empty() || 
+                (sqrt(pow(currentPoint.x - currentStroke.points.back().x, 2) + pow(currentPoint.y - currentStroke.points.back().y, 2)) > minSpacing)) {
                 
-                currentStroke.push_back(currentPoint);
+                // Width comes from the drawing speed since the previous point
+                float time = strokeClock.getElapsedTime().asSeconds();
+                float width = widthTracker.next(widthCurves[widthCurveIndex], currentPoint, time);
+                scene.addPoint(currentPoint, width, time);
                 cout << "Mouse Position: (" << mousePos.x << ", " << mousePos.y << ")\n";
                 
 
-            int mouseposX = mousePos.x;
-            int mouseposY = mousePos.y;
-
-            int appX = static_cast<int>((static_cast<float>(mouseposX) / DESKTOP_X) * screenWidth);
-            int appY = static_cast<int>((static_cast<float>(mouseposY) / DESKTOP_Y) * screenHeight);
+            int appX = static_cast<int>((currentPoint.x / DESKTOP_X) * screenWidth);
+            int appY = static_cast<int>((currentPoint.y / DESKTOP_Y) * screenHeight);
 
 
-            int gridX = appX / CELL_SIZE;
-            int gridY = appY / CELL_SIZE;
+            Vector2i cell = desktopGrid.cellAt(Vector2f((float)appX, (float)appY));
+            int gridX = cell.x;
+            int gridY = cell.y;
 
             cout << "App Coordinates: (" << appX << ", " << appY << ") - Grid Cell: (" << gridX << ", " << gridY << ")\n";
 
             }
         }
         
+        // Nothing changed since the last frame: go back to waiting for events
+        if (!pacer.shouldRender(mousePressed || animating || simulating)) continue;
+
         // Clear the window
         window.clear();
         
-        // Draw all the lines
-        for (const auto& line : lines) {
-            window.draw(line);
+        // Strokes from the cached tiles in view, the live stroke and the selection
+        window.setView(canvasView);
+        scene.render(window, selection);
+        scene.frameRendered();
+
+        // Show the eraser outline under the cursor
+        if (eraserMode) {
+            CircleShape eraserOutline(ERASER_RADIUS);
+            eraserOutline.setOrigin(Vector2f(ERASER_RADIUS, ERASER_RADIUS));
+            eraserOutline.setPosition(toCanvas(Mouse::getPosition(window)));
+            eraserOutline.setFillColor(Color::Transparent);
+            eraserOutline.setOutlineColor(Color(255, 80, 80));
+            eraserOutline.setOutlineThickness(canvasView.getSize().x / window.getSize().x);
+            window.draw(eraserOutline);
         }
         
-        // Draw desktop icons if enabled
-        if (showDesktopIcons) {
-            for (const auto& dot : iconDots) {
-                window.draw(dot);
+        // Preview where the icons would land, including the stroke being drawn
+        if (showDesktopIcons && !desktopIcons.empty()) {
+            Clock previewClock;
+            syncIconLayout(iconLayout, iconLayoutVersion, scene.history);
+            if (mousePressed && !eraserMode && !selectMode) iconLayout.updateLive(scene.liveStroke());
+            else iconLayout.clearLive();
+            vector<Vector2f> targets = layoutIcons((int)desktopIcons.size());
+            // The simulation waits for the stroke to end rather than restarting every frame
+            if (!mousePressed) targets = relaxedTargets(targets, false);
+            if (snapToGrid) {
+                // Show the cells the icons would really end up in
+                vector<Vector2i> snapped = desktopTargets(targets, (float)screenWidth / DESKTOP_X, (float)screenHeight / DESKTOP_Y, &desktopGrid);
+                for (size_t i = 0; i < targets.size(); ++i) {
+                    targets[i] = Vector2f(snapped[i].x * (float)DESKTOP_X / screenWidth, snapped[i].y * (float)DESKTOP_Y / screenHeight);
+                }
+            }
+            // Nor is the assignment solved inside the frame: new targets take the
+            // nearest free icon, and the full solve waits for Space
+            if (targets != previewAssignedTargets) {
+                ExtendAssignment(iconPositions, targets, previewAssignment);
+                previewAssignedTargets = targets;
             }
+            iconPreview.update(targets, showCurrentPositions ? iconPositions : vector<Vector2f>(),
+                               canvasView.getSize().x / window.getSize().x,
+                               previewAssignment.size() == targets.size() ? previewAssignment : vector<int>());
+            previewCost.add(previewClock.getElapsedTime());
+            iconPreview.draw(window);
         }
 
         window.display();
+        pacer.frameDisplayed();
+        pacer.waitForNextFrame(mousePressed || animating || simulating);
     }
     
     // Restore original icon positions before closing
+    iconAnimator.stop();
     if (originalPositionsSaved && !originalIconPositions.empty()) {
-        RestoreOriginalPositions(originalIconPositions);
+        RestoreOriginalPositions(desktop, originalIconPositions);
     }
 }
\ No newline at end of file
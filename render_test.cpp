@@ -0,0 +1,206 @@
+// Headless render regression test: replays recorded sessions (F5 in the app)
+// through the same CanvasScene the window uses, but into a RenderTexture, and
+// compares the last frame with a golden image. Frame timings are reported
+// alongside, so a change that makes rendering slower shows up in the same run.
+//
+// Compile: g++ -O2 -std=c++17 -pthread render_test.cpp -o render_test.exe -I SFML/SFML-3.0.2/include -L SFML/SFML-3.0.2/lib -lsfml-graphics -lsfml-window -lsfml-system
+// On Linux machines without a GPU, run it on Mesa's software renderer:
+//   LIBGL_ALWAYS_SOFTWARE=1 xvfb-run ./render_test sessions/*.txt
+// Without a Linux SFML build, link it against sfml_mesa.cpp instead, which
+// renders headless through Mesa; see there for the commands.
+//
+// Usage: render_test [--update] [--threshold T] [--max-diff F] [--max-frame-ms M] session.txt...
+// Each session's golden image sits next to it with a .png extension. --update
+// writes the rendered frame as the new golden; without it a missing golden fails.
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "canvas_scene.h"
+#include "frame_pacer.h"
+
+using namespace std;
+
+using Clock = chrono::steady_clock;
+
+// Same canvas and line widths as the app
+const unsigned CANVAS_SIZE = 800;
+const float MAX_LINE_WIDTH = 14.0f;
+const float CELL_SIZE = 30.0f;
+
+// Perceived difference between two pixels, 0 (same) to 1: the YIQ distance
+// used by pixelmatch, which weights brightness over hue like the eye does
+float pixelDelta(const uint8_t* a, const uint8_t* b) {
+    auto blendWhite = [](uint8_t c, uint8_t alpha) { return 255.0f + (c - 255.0f) * alpha / 255.0f; };
+    float r1 = blendWhite(a[0], a[3]), g1 = blendWhite(a[1], a[3]), b1 = blendWhite(a[2], a[3]);
+    float r2 = blendWhite(b[0], b[3]), g2 = blendWhite(b[1], b[3]), b2 = blendWhite(b[2], b[3]);
+    float y = (r1 - r2) * 0.29889531f + (g1 - g2) * 0.58662247f + (b1 - b2) * 0.11448223f;
+    float i = (r1 - r2) * 0.59597799f - (g1 - g2) * 0.27417610f - (b1 - b2) * 0.32180189f;
+    float q = (r1 - r2) * 0.21147017f - (g1 - g2) * 0.52261711f + (b1 - b2) * 0.31114694f;
+    return std::sqrt((0.5053f * y * y + 0.299f * i * i + 0.1957f * q * q) / 35215.0f);
+}
+
+struct ImageDiff {
+    size_t differing = 0; // pixels above the threshold
+    size_t total = 0;
+    float worst = 0.0f;
+    sf::Image mask;       // differing pixels in red over a faded copy of the result
+
+    float fraction() const { return total ? static_cast<float>(differing) / total : 0.0f; }
+};
+
+// A pixel only counts as different if nothing within one pixel of it in the
+// other image matches either, so anti-aliasing that lands a pixel over (other
+// GL drivers, rounding) is tolerated while missing or extra geometry is not.
+ImageDiff compareImages(const sf::Image& actual, const sf::Image& expected, float threshold) {
+    ImageDiff diff;
+    sf::Vector2u size = actual.getSize();
+    diff.total = static_cast<size_t>(size.x) * size.y;
+    if (expected.getSize() != size) {
+        diff.differing = diff.total;
+        diff.worst = 1.0f;
+        return diff;
+    }
+    diff.mask = sf::Image(size, sf::Color::Black);
+    const uint8_t* a = actual.getPixelsPtr();
+    const uint8_t* b = expected.getPixelsPtr();
+    auto closest = [&](const uint8_t* from, const uint8_t* in, int x, int y) {
+        float best = 1.0f;
+        for (int dy = -1; dy <= 1; ++dy) {
+            for (int dx = -1; dx <= 1; ++dx) {
+                int nx = x + dx, ny = y + dy;
+                if (nx < 0 || ny < 0 || nx >= (int)size.x || ny >= (int)size.y) continue;
+                best = std::min(best, pixelDelta(from + 4 * (static_cast<size_t>(y) * size.x + x),
+                                                 in + 4 * (static_cast<size_t>(ny) * size.x + nx)));
+                if (best <= threshold) return best;
+            }
+        }
+        return best;
+    };
+
+    for (int y = 0; y < (int)size.y; ++y) {
+        for (int x = 0; x < (int)size.x; ++x) {
+            size_t offset = 4 * (static_cast<size_t>(y) * size.x + x);
+            uint8_t faded = static_cast<uint8_t>(a[offset + 1] / 4);
+            diff.mask.setPixel(sf::Vector2u(x, y), sf::Color(faded, faded, faded));
+            if (pixelDelta(a + offset, b + offset) <= threshold) continue;
+            float delta = std::max(closest(a, b, x, y), closest(b, a, x, y));
+            if (delta <= threshold) continue;
+            ++diff.differing;
+            diff.worst = std::max(diff.worst, delta);
+            diff.mask.setPixel(sf::Vector2u(x, y), sf::Color(255, 0, 0));
+        }
+    }
+    return diff;
+}
+
+string goldenPath(const string& session) {
+    size_t dot = session.find_last_of('.');
+    size_t slash = session.find_last_of("/\\");
+    if (dot == string::npos || (slash != string::npos && dot < slash)) return session + ".png";
+    return session.substr(0, dot) + ".png";
+}
+
+struct Options {
+    bool update = false;
+    float threshold = 0.1f;  // per-pixel perceptual difference that counts
+    float maxDiff = 0.001f;  // fraction of differing pixels that fails
+    float maxFrameMs = 0.0f; // p95 frame time that fails; 0 = report only
+};
+
+// Replays one session and checks it; returns true if it passed
+bool runSession(const string& path, const Options& options) {
+    ifstream session(path);
+    if (!session) {
+        printf("%s: cannot open\n", path.c_str());
+        return false;
+    }
+
+    sf::RenderTexture target;
+    if (!target.resize(sf::Vector2u(CANVAS_SIZE, CANVAS_SIZE))) {
+        printf("%s: cannot create a %ux%u render texture\n", path.c_str(), CANVAS_SIZE, CANVAS_SIZE);
+        return false;
+    }
+    CanvasScene scene(StrokeStyle{}, MAX_LINE_WIDTH, CELL_SIZE);
+    Selection noSelection;
+
+    // Render exactly the way the app's frame does
+    LatencyStats frameTimes;
+    auto renderFrame = [&](CanvasScene& s) {
+        auto start = Clock::now();
+        target.clear(sf::Color::Black);
+        s.render(target, noSelection);
+        target.display();
+        frameTimes.add(sf::microseconds(chrono::duration_cast<chrono::microseconds>(Clock::now() - start).count()));
+    };
+    auto replayStart = Clock::now();
+    size_t errors = ReplaySession(session, scene, renderFrame);
+    renderFrame(scene); // the final state, even if the session ended mid-frame
+    double replayMs = chrono::duration<double, milli>(Clock::now() - replayStart).count();
+    sf::Image result = target.getTexture().copyToImage();
+
+    printf("%s: %zu frames, %zu strokes, replay %.1f ms, frame avg %.3f ms, p95 %.3f ms, max %.3f ms\n",
+           path.c_str(), frameTimes.count(), StrokeCount(scene.history.current()), replayMs,
+           frameTimes.average(), frameTimes.percentile(0.95f), frameTimes.percentile(1.0f));
+    bool passed = true;
+    if (errors > 0) {
+        printf("  %zu unreadable operations\n", errors);
+        passed = false;
+    }
+    if (options.maxFrameMs > 0.0f && frameTimes.percentile(0.95f) > options.maxFrameMs) {
+        printf("  FAIL: p95 frame time above %.3f ms\n", options.maxFrameMs);
+        passed = false;
+    }
+
+    string golden = goldenPath(path);
+    if (options.update) {
+        bool saved = result.saveToFile(golden);
+        printf("  %s golden %s\n", saved ? "wrote" : "FAILED to write", golden.c_str());
+        return passed && saved;
+    }
+    sf::Image expected;
+    if (!expected.loadFromFile(golden)) {
+        printf("  FAIL: no golden %s (run with --update to create it)\n", golden.c_str());
+        return false;
+    }
+
+    ImageDiff diff = compareImages(result, expected, options.threshold);
+    printf("  %zu of %zu pixels differ (%.4f%%), worst %.3f\n", diff.differing, diff.total, diff.fraction() * 100.0f, diff.worst);
+    if (diff.fraction() > options.maxDiff) {
+        string actualPath = golden.substr(0, golden.size() - 4) + ".actual.png";
+        string diffPath = golden.substr(0, golden.size() - 4) + ".diff.png";
+        (void)result.saveToFile(actualPath);
+        if (diff.mask.getSize() == result.getSize()) (void)diff.mask.saveToFile(diffPath);
+        printf("  FAIL: image differs from %s (see %s)\n", golden.c_str(), diffPath.c_str());
+        passed = false;
+    }
+    return passed;
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    vector<string> sessions;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--update")) options.update = true;
+        else if (!strcmp(argv[i], "--threshold") && i + 1 < argc) options.threshold = stof(argv[++i]);
+        else if (!strcmp(argv[i], "--max-diff") && i + 1 < argc) options.maxDiff = stof(argv[++i]);
+        else if (!strcmp(argv[i], "--max-frame-ms") && i + 1 < argc) options.maxFrameMs = stof(argv[++i]);
+        else sessions.push_back(argv[i]);
+    }
+    if (sessions.empty()) {
+        printf("usage: render_test [--update] [--threshold T] [--max-diff F] [--max-frame-ms M] session.txt...\n");
+        return 2;
+    }
+
+    int failed = 0;
+    for (const auto& session : sessions) {
+        if (!runSession(session, options)) ++failed;
+    }
+    printf("%zu sessions, %d failed\n", sessions.size(), failed);
+    return failed ? 1 : 0;
+}
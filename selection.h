@@ -0,0 +1,149 @@
+#ifndef SELECTION_H
+#define SELECTION_H
+
+#include <SFML/Graphics/Transform.hpp>
+#include <SFML/System/Vector2.hpp>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "stroke_bvh.h"
+#include "stroke_history.h"
+
+// Size of the square scale handles at the selection corners, in screen pixels
+const float HANDLE_SIZE = 8.0f;
+// Distance of the rotate handle above the selection, in screen pixels
+const float ROTATE_HANDLE_OFFSET = 25.0f;
+
+enum class SelectionDrag {
+    None,
+    Move,
+    Scale,
+    Rotate,
+    Box     // rubber-band selection
+};
+
+// Rotation by angle (radians) around center
+inline sf::Transform RotationAbout(float angle, sf::Vector2f center) {
+    float c = std::cos(angle);
+    float s = std::sin(angle);
+    return sf::Transform(c, -s, center.x * (1.0f - c) + center.y * s,
+                         s, c, center.y * (1.0f - c) - center.x * s,
+                         0.0f, 0.0f, 1.0f);
+}
+
+// Selected strokes and the transform currently being dragged. While a drag is
+// in progress the strokes are drawn with dragTransform on top of their own
+// transforms; nothing is committed until the mouse is released, so each frame
+// of the drag is O(1) no matter how many points the strokes have.
+struct Selection {
+    std::vector<StrokePtr> strokes;
+    Box bounds;             // canvas-space bounds of the selected strokes
+    SelectionDrag drag = SelectionDrag::None;
+    sf::Vector2f anchor;    // where the drag started
+    sf::Vector2f cursor;    // latest drag position
+    sf::Transform dragTransform;
+
+    bool empty() const { return strokes.empty(); }
+
+    bool contains(uint32_t id) const {
+        for (const auto& stroke : strokes) {
+            if (stroke->id == id) return true;
+        }
+        return false;
+    }
+
+    void clear() {
+        strokes.clear();
+        bounds = Box{};
+        drag = SelectionDrag::None;
+        dragTransform = sf::Transform::Identity;
+    }
+
+    // Replaces the selection and recomputes its bounds from the index
+    void set(std::vector<StrokePtr> selected, const StrokeIndex& index) {
+        strokes = std::move(selected);
+        bounds = Box{};
+        for (const auto& stroke : strokes) bounds = Union(bounds, index.bounds(stroke->id));
+    }
+
+    sf::Vector2f center() const {
+        return sf::Vector2f((bounds.minX + bounds.maxX) / 2.0f, (bounds.minY + bounds.maxY) / 2.0f);
+    }
+
+    std::vector<sf::Vector2f> scaleHandles() const {
+        return {{bounds.minX, bounds.minY}, {bounds.maxX, bounds.minY}, {bounds.maxX, bounds.maxY}, {bounds.minX, bounds.maxY}};
+    }
+
+    // unitsPerPixel is how many canvas units one screen pixel covers at the current zoom
+    sf::Vector2f rotateHandle(float unitsPerPixel = 1.0f) const {
+        return sf::Vector2f(center().x, bounds.minY - ROTATE_HANDLE_OFFSET * unitsPerPixel);
+    }
+
+    // Starts a drag at p. Returns false if p is not on the selection, in
+    // which case the caller picks or box-selects instead. The handles are
+    // grabbed within their on-screen size, whatever the zoom.
+    bool beginDrag(sf::Vector2f p, float unitsPerPixel = 1.0f) {
+        anchor = cursor = p;
+        dragTransform = sf::Transform::Identity;
+        if (empty()) return false;
+
+        auto near = [&](sf::Vector2f handle) {
+            float reach = HANDLE_SIZE * unitsPerPixel;
+            return std::abs(p.x - handle.x) <= reach && std::abs(p.y - handle.y) <= reach;
+        };
+
+        std::vector<sf::Vector2f> handles = scaleHandles();
+        if (near(rotateHandle(unitsPerPixel))) {
+            drag = SelectionDrag::Rotate;
+        } else if (std::any_of(handles.begin(), handles.end(), near)) {
+            drag = SelectionDrag::Scale;
+        } else if (bounds.contains(p)) {
+            drag = SelectionDrag::Move;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    void beginBoxSelect(sf::Vector2f p) {
+        anchor = cursor = p;
+        drag = SelectionDrag::Box;
+        dragTransform = sf::Transform::Identity;
+    }
+
+    // Recomputes dragTransform for the mouse at p
+    void updateDrag(sf::Vector2f p) {
+        cursor = p;
+        sf::Vector2f c = center();
+        dragTransform = sf::Transform::Identity;
+
+        if (drag == SelectionDrag::Move) {
+            dragTransform.translate(p - anchor);
+        } else if (drag == SelectionDrag::Scale) {
+            sf::Vector2f from = anchor - c, to = p - c;
+            float fromLength = std::sqrt(from.x * from.x + from.y * from.y);
+            float toLength = std::sqrt(to.x * to.x + to.y * to.y);
+            if (fromLength > 1.0f) {
+                float factor = std::max(0.05f, toLength / fromLength);
+                dragTransform.scale({factor, factor}, c);
+            }
+        } else if (drag == SelectionDrag::Rotate) {
+            float angle = std::atan2(p.y - c.y, p.x - c.x) - std::atan2(anchor.y - c.y, anchor.x - c.x);
+            dragTransform = RotationAbout(angle, c);
+        }
+    }
+
+    // Rubber-band rectangle in canvas coordinates
+    Box dragBox() const {
+        Box box;
+        box.expand(anchor);
+        box.expand(cursor);
+        return box;
+    }
+
+    bool transforming() const {
+        return drag == SelectionDrag::Move || drag == SelectionDrag::Scale || drag == SelectionDrag::Rotate;
+    }
+};
+
+#endif // SELECTION_H
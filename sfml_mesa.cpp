@@ -0,0 +1,357 @@
+// Just enough of SFML's graphics module, on Mesa through a surfaceless EGL
+// context, to run render_test where no Linux SFML build is available. Follows
+// SFML 3's conventions: legacy fixed-function GL, view -> projection matrix,
+// render textures stored upside down and flipped on read-back, nearest
+// sampling, alpha blending. The goldens in sessions/ were rendered with it.
+//
+// Needs Mesa's EGL and GL and libpng (libegl-dev, libgl-dev, libpng-dev), no
+// display or X server:
+//   g++ -O2 -std=c++17 -c sfml_mesa.cpp -I SFML/SFML-3.0.2/include
+//   g++ -O2 -std=c++17 -pthread render_test.cpp sfml_mesa.o -o render_test -I SFML/SFML-3.0.2/include -lEGL -lGL -lpng
+//   ./render_test sessions/*.txt
+// The standard headers SFML pulls in come first, so opening up SFML's private
+// members (which the implementations below fill in) leaves them untouched
+#include <array>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+namespace sf::priv { class RenderTextureImpl { public: virtual ~RenderTextureImpl() {} }; }
+#define private public
+#define protected public
+#include <SFML/Graphics.hpp>
+#undef private
+#undef protected
+#define GL_GLEXT_PROTOTYPES
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <png.h>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+static void ensureContext() {
+    static bool ready = false;
+    if (ready) return;
+    auto getDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    EGLDisplay display = getDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    EGLint major, minor;
+    eglInitialize(display, &major, &minor);
+    eglBindAPI(EGL_OPENGL_API);
+    EGLint attributes[] = {EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE};
+    EGLConfig config;
+    EGLint count;
+    eglChooseConfig(display, attributes, &config, 1, &count);
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, nullptr);
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context);
+    fprintf(stderr, "GL: %s, %s\n", glGetString(GL_RENDERER), glGetString(GL_VERSION));
+    ready = true;
+}
+
+static std::map<const sf::RenderTexture*, GLuint> framebuffers;
+
+namespace sf {
+const BlendMode BlendAlpha{};
+const RenderStates RenderStates::Default{};
+StencilValue::StencilValue(int v) : value(static_cast<unsigned>(v)) {}
+StencilValue::StencilValue(unsigned int v) : value(v) {}
+GlResource::GlResource() {}
+
+// Images
+Image::Image(Vector2u size, Color color) : m_size(size), m_pixels(size.x * size.y * 4) {
+    for (size_t i = 0; i < m_pixels.size(); i += 4) {
+        m_pixels[i] = color.r; m_pixels[i + 1] = color.g; m_pixels[i + 2] = color.b; m_pixels[i + 3] = color.a;
+    }
+}
+const std::uint8_t* Image::getPixelsPtr() const { return m_pixels.empty() ? nullptr : m_pixels.data(); }
+Vector2u Image::getSize() const { return m_size; }
+void Image::setPixel(Vector2u p, Color c) {
+    std::uint8_t* px = &m_pixels[(p.x + p.y * m_size.x) * 4];
+    px[0] = c.r; px[1] = c.g; px[2] = c.b; px[3] = c.a;
+}
+bool Image::loadFromFile(const std::filesystem::path& path) {
+    png_image image;
+    std::memset(&image, 0, sizeof(image));
+    image.version = PNG_IMAGE_VERSION;
+    if (!png_image_begin_read_from_file(&image, path.string().c_str())) return false;
+    image.format = PNG_FORMAT_RGBA;
+    m_pixels.resize(PNG_IMAGE_SIZE(image));
+    if (!png_image_finish_read(&image, nullptr, m_pixels.data(), 0, nullptr)) return false;
+    m_size = Vector2u(image.width, image.height);
+    return true;
+}
+bool Image::saveToFile(const std::filesystem::path& path) const {
+    png_image image;
+    std::memset(&image, 0, sizeof(image));
+    image.version = PNG_IMAGE_VERSION;
+    image.width = m_size.x;
+    image.height = m_size.y;
+    image.format = PNG_FORMAT_RGBA;
+    return png_image_write_to_file(&image, path.string().c_str(), 0, m_pixels.data(), 0, nullptr);
+}
+
+// Views
+View::View(Vector2f c, Vector2f s) : m_center(c), m_size(s) {}
+View::View(const FloatRect& r) : m_center(r.position + r.size / 2.f), m_size(r.size) {}
+Vector2f View::getCenter() const { return m_center; }
+Vector2f View::getSize() const { return m_size; }
+void View::setCenter(Vector2f c) { m_center = c; }
+void View::setSize(Vector2f s) { m_size = s; }
+
+// Textures
+Texture::Texture() : m_cacheId(0) {}
+Texture::~Texture() {
+    if (m_texture && !m_fboAttachment) glDeleteTextures(1, &m_texture);
+}
+Image Texture::copyToImage() const {
+    Image image(m_size, Color::Black);
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.m_pixels.data());
+    if (m_pixelsFlipped) {
+        size_t row = m_size.x * 4;
+        std::vector<std::uint8_t> flipped(image.m_pixels.size());
+        for (unsigned y = 0; y < m_size.y; ++y) std::memcpy(&flipped[y * row], &image.m_pixels[(m_size.y - 1 - y) * row], row);
+        image.m_pixels.swap(flipped);
+    }
+    return image;
+}
+
+// Vertex buffers: the batch falls back to vertex arrays
+VertexBuffer::VertexBuffer(PrimitiveType type, Usage usage) : m_primitiveType(type), m_usage(usage) {}
+VertexBuffer::~VertexBuffer() {}
+bool VertexBuffer::create(std::size_t n) { m_size = n; return true; }
+bool VertexBuffer::update(const Vertex*, std::size_t c, unsigned int o) { return o + c <= m_size; }
+std::size_t VertexBuffer::getVertexCount() const { return m_size; }
+bool VertexBuffer::isAvailable() { return false; }
+void VertexBuffer::draw(RenderTarget&, RenderStates) const {}
+
+// Transformables and sprites
+void Transformable::setPosition(Vector2f p) { m_position = p; m_transformNeedUpdate = true; }
+void Transformable::setScale(Vector2f s) { m_scale = s; m_transformNeedUpdate = true; }
+void Transformable::setOrigin(Vector2f o) { m_origin = o; m_transformNeedUpdate = true; }
+const Transform& Transformable::getTransform() const {
+    Transform t;
+    t.translate(m_position);
+    t.scale(m_scale);
+    t.translate(-m_origin);
+    m_transform = t;
+    return m_transform;
+}
+Sprite::Sprite(const Texture& texture) : m_texture(&texture), m_textureRect({0, 0}, Vector2i(texture.m_size)) {
+    Vector2f size(texture.m_size);
+    m_vertices[0] = Vertex{{0, 0}, Color::White, {0, 0}};
+    m_vertices[1] = Vertex{{0, size.y}, Color::White, {0, size.y}};
+    m_vertices[2] = Vertex{{size.x, 0}, Color::White, {size.x, 0}};
+    m_vertices[3] = Vertex{{size.x, size.y}, Color::White, {size.x, size.y}};
+}
+void Sprite::draw(RenderTarget& target, RenderStates states) const {
+    states.transform *= getTransform();
+    states.texture = m_texture;
+    target.draw(m_vertices.data(), 4, PrimitiveType::TriangleStrip, states);
+}
+
+// Render targets
+bool RenderTarget::isSrgb() const { return false; }
+bool RenderTarget::setActive(bool) { return true; }
+void RenderTarget::setView(const View& v) { m_view = v; }
+const View& RenderTarget::getView() const { return m_view; }
+
+static void bindTarget(RenderTarget& target) {
+    auto* texture = dynamic_cast<RenderTexture*>(&target);
+    glBindFramebuffer(GL_FRAMEBUFFER, texture ? framebuffers[texture] : 0);
+    Vector2u size = target.getSize();
+    glViewport(0, 0, size.x, size.y);
+}
+
+void RenderTarget::clear(Color c) {
+    bindTarget(*this);
+    glClearColor(c.r / 255.f, c.g / 255.f, c.b / 255.f, c.a / 255.f);
+    glClear(GL_COLOR_BUFFER_BIT);
+}
+
+void RenderTarget::draw(const Drawable& drawable, const RenderStates& states) { drawable.draw(*this, states); }
+
+void RenderTarget::draw(const Vertex* vertices, std::size_t count, PrimitiveType type, const RenderStates& states) {
+    if (!count) return;
+    bindTarget(*this);
+    // View: centre and size mapped onto clip space, y up
+    const View& view = m_view;
+    Transform projection(2.f / view.m_size.x, 0, -2.f * view.m_center.x / view.m_size.x,
+                         0, -2.f / view.m_size.y, 2.f * view.m_center.y / view.m_size.y,
+                         0, 0, 1);
+    glMatrixMode(GL_PROJECTION);
+    glLoadMatrixf(projection.getMatrix());
+    glMatrixMode(GL_MODELVIEW);
+    glLoadMatrixf(states.transform.getMatrix());
+    glMatrixMode(GL_TEXTURE);
+    if (states.texture) {
+        const Texture& t = *states.texture;
+        Transform texture(1.f / t.m_actualSize.x, 0, 0, 0, 1.f / t.m_actualSize.y, 0, 0, 0, 1);
+        if (t.m_pixelsFlipped) {
+            texture = Transform(1.f / t.m_actualSize.x, 0, 0, 0, -1.f / t.m_actualSize.y, static_cast<float>(t.m_size.y) / t.m_actualSize.y, 0, 0, 1);
+        }
+        glLoadMatrixf(texture.getMatrix());
+        glEnable(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, t.m_texture);
+    } else {
+        glLoadIdentity();
+        glDisable(GL_TEXTURE_2D);
+    }
+    glEnable(GL_BLEND);
+    glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    const char* data = reinterpret_cast<const char*>(vertices);
+    glVertexPointer(2, GL_FLOAT, sizeof(Vertex), data);
+    glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Vertex), data + 8);
+    glTexCoordPointer(2, GL_FLOAT, sizeof(Vertex), data + 12);
+    static const GLenum modes[] = {GL_POINTS, GL_LINES, GL_LINE_STRIP, GL_TRIANGLES, GL_TRIANGLE_STRIP, GL_TRIANGLE_FAN};
+    glDrawArrays(modes[static_cast<int>(type)], 0, static_cast<GLsizei>(count));
+}
+
+void RenderTarget::draw(const VertexBuffer&, std::size_t, std::size_t, const RenderStates&) {}
+
+// Render textures: a texture attached to a framebuffer object
+RenderTexture::RenderTexture() {}
+RenderTexture::~RenderTexture() {
+    auto it = framebuffers.find(this);
+    if (it != framebuffers.end()) {
+        glDeleteFramebuffers(1, &it->second);
+        glDeleteTextures(1, &m_texture.m_texture);
+        framebuffers.erase(it);
+    }
+}
+bool RenderTexture::resize(Vector2u size, const ContextSettings&) {
+    ensureContext();
+    if (!m_texture.m_texture) glGenTextures(1, &m_texture.m_texture);
+    glBindTexture(GL_TEXTURE_2D, m_texture.m_texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size.x, size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    m_texture.m_size = m_texture.m_actualSize = size;
+    m_texture.m_fboAttachment = true;
+    GLuint& fbo = framebuffers[this];
+    if (!fbo) glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_texture.m_texture, 0);
+    m_defaultView = View(FloatRect({0, 0}, Vector2f(size)));
+    m_view = m_defaultView;
+    return glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+}
+void RenderTexture::display() {
+    glFinish();
+    m_texture.m_pixelsFlipped = true;
+}
+const Texture& RenderTexture::getTexture() const { return m_texture; }
+Vector2u RenderTexture::getSize() const { return m_texture.m_size; }
+bool RenderTexture::isSrgb() const { return false; }
+bool RenderTexture::setActive(bool) { return true; }
+
+// Vertex arrays and shapes, for the selection outline, handles and rubber band
+VertexArray::VertexArray(PrimitiveType type, std::size_t count) : m_vertices(count), m_primitiveType(type) {}
+std::size_t VertexArray::getVertexCount() const { return m_vertices.size(); }
+Vertex& VertexArray::operator[](std::size_t i) { return m_vertices[i]; }
+const Vertex& VertexArray::operator[](std::size_t i) const { return m_vertices[i]; }
+void VertexArray::clear() { m_vertices.clear(); }
+void VertexArray::resize(std::size_t count) { m_vertices.resize(count); }
+void VertexArray::append(const Vertex& vertex) { m_vertices.push_back(vertex); }
+void VertexArray::draw(RenderTarget& target, RenderStates states) const {
+    if (!m_vertices.empty()) target.draw(m_vertices.data(), m_vertices.size(), m_primitiveType, states);
+}
+
+Vector2f Shape::getGeometricCenter() const {
+    Vector2f sum;
+    for (std::size_t i = 0; i < getPointCount(); ++i) sum += getPoint(i);
+    return getPointCount() ? sum / static_cast<float>(getPointCount()) : sum;
+}
+void Shape::setFillColor(Color color) { m_fillColor = color; updateFillColors(); }
+void Shape::setOutlineColor(Color color) { m_outlineColor = color; updateOutlineColors(); }
+void Shape::setOutlineThickness(float thickness) { m_outlineThickness = thickness; update(); }
+// As SFML does it: a fan from the centre for the fill, and a strip offset along
+// the mitred vertex normals for the outline
+void Shape::update() {
+    std::size_t count = getPointCount();
+    if (count < 3) {
+        m_vertices.resize(0);
+        m_outlineVertices.resize(0);
+        return;
+    }
+    m_vertices.resize(count + 2);
+    for (std::size_t i = 0; i < count; ++i) m_vertices[i + 1].position = getPoint(i);
+    m_vertices[count + 1].position = m_vertices[1].position;
+    m_vertices[0].position = getGeometricCenter();
+    updateFillColors();
+    updateOutline();
+}
+void Shape::updateFillColors() {
+    for (std::size_t i = 0; i < m_vertices.getVertexCount(); ++i) m_vertices[i].color = m_fillColor;
+}
+void Shape::updateOutline() {
+    if (m_outlineThickness == 0.f) {
+        m_outlineVertices.clear();
+        return;
+    }
+    std::size_t count = m_vertices.getVertexCount() - 2;
+    m_outlineVertices.resize((count + 1) * 2);
+    auto normal = [](Vector2f a, Vector2f b) {
+        Vector2f n(a.y - b.y, b.x - a.x);
+        float length = std::sqrt(n.x * n.x + n.y * n.y);
+        return length != 0.f ? n / length : n;
+    };
+    for (std::size_t i = 0; i < count; ++i) {
+        std::size_t index = i + 1;
+        Vector2f p0 = (i == 0) ? m_vertices[count].position : m_vertices[index - 1].position;
+        Vector2f p1 = m_vertices[index].position;
+        Vector2f p2 = m_vertices[index + 1].position;
+        Vector2f n1 = normal(p0, p1), n2 = normal(p1, p2);
+        // Point the normals outwards
+        if (n1.dot(m_vertices[0].position - p1) > 0) n1 = -n1;
+        if (n2.dot(m_vertices[0].position - p1) > 0) n2 = -n2;
+        float factor = 1.f + (n1.x * n2.x + n1.y * n2.y);
+        Vector2f n = (n1 + n2) / factor;
+        m_outlineVertices[i * 2 + 0].position = p1;
+        m_outlineVertices[i * 2 + 1].position = p1 + n * m_outlineThickness;
+    }
+    m_outlineVertices[count * 2 + 0].position = m_outlineVertices[0].position;
+    m_outlineVertices[count * 2 + 1].position = m_outlineVertices[1].position;
+    updateOutlineColors();
+}
+void Shape::updateOutlineColors() {
+    for (std::size_t i = 0; i < m_outlineVertices.getVertexCount(); ++i) m_outlineVertices[i].color = m_outlineColor;
+}
+void Shape::draw(RenderTarget& target, RenderStates states) const {
+    states.transform *= getTransform();
+    states.texture = nullptr;
+    target.draw(m_vertices, states);
+    target.draw(m_outlineVertices, states);
+}
+
+RectangleShape::RectangleShape(Vector2f size) : m_size(size) { update(); }
+std::size_t RectangleShape::getPointCount() const { return 4; }
+Vector2f RectangleShape::getPoint(std::size_t i) const {
+    switch (i) {
+        default:
+        case 0: return {0, 0};
+        case 1: return {m_size.x, 0};
+        case 2: return {m_size.x, m_size.y};
+        case 3: return {0, m_size.y};
+    }
+}
+Vector2f RectangleShape::getGeometricCenter() const { return m_size / 2.f; }
+
+CircleShape::CircleShape(float radius, std::size_t pointCount) : m_radius(radius), m_pointCount(pointCount) { update(); }
+std::size_t CircleShape::getPointCount() const { return m_pointCount; }
+Vector2f CircleShape::getPoint(std::size_t i) const {
+    float angle = static_cast<float>(i) / static_cast<float>(m_pointCount) * 6.28318531f - 1.57079633f;
+    return {m_radius + m_radius * std::cos(angle), m_radius + m_radius * std::sin(angle)};
+}
+Vector2f CircleShape::getGeometricCenter() const { return {m_radius, m_radius}; }
+}
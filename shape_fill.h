@@ -0,0 +1,192 @@
+#ifndef SHAPE_FILL_H
+#define SHAPE_FILL_H
+
+#include <SFML/Graphics/Rect.hpp>
+#include <SFML/System/Vector2.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+// Whether a stroke closes on itself: its ends meet within closeDistance, or
+// within a tenth of its length for big shapes drawn loosely
+inline bool IsClosedStroke(const std::vector<sf::Vector2f>& points, double length, float closeDistance = 20.0f) {
+    if (points.size() < 3 || length <= 0.0) return false;
+    sf::Vector2f gap = points.back() - points.front();
+    float reach = std::max(closeDistance, static_cast<float>(length) * 0.1f);
+    // A short scribble whose ends are close is not a shape
+    return gap.x * gap.x + gap.y * gap.y <= reach * reach && length > 4.0 * std::sqrt(gap.x * gap.x + gap.y * gap.y);
+}
+
+// The inside of one or more closed outlines by the even-odd rule, as sorted
+// edge crossings on horizontal scanlines rowHeight apart. A point is inside
+// when an odd number of crossings lie left of it on its scanline, so a ring
+// drawn as two strokes leaves its hole empty. Building costs O(edges + crossings),
+// a lookup a binary search in one row.
+class ShapeMask {
+public:
+    ShapeMask() = default;
+
+    ShapeMask(const std::vector<const std::vector<sf::Vector2f>*>& outlines, int maxRows = 2048) {
+        float left = INFINITY, top = INFINITY, right = -INFINITY, bottom = -INFINITY;
+        for (const auto* outline : outlines) {
+            for (sf::Vector2f p : *outline) {
+                left = std::min(left, p.x);
+                right = std::max(right, p.x);
+                top = std::min(top, p.y);
+                bottom = std::max(bottom, p.y);
+            }
+        }
+        if (!(right > left && bottom > top)) return;
+        bounds = sf::FloatRect({left, top}, {right - left, bottom - top});
+        rowHeight = std::max(bounds.size.y / maxRows, 0.25f);
+        rows.resize(static_cast<size_t>(std::ceil(bounds.size.y / rowHeight)) + 1);
+
+        // Each edge, including the one closing the outline, crosses the scanlines
+        // through the centres of the rows between its ends
+        for (const auto* outline : outlines) {
+            const std::vector<sf::Vector2f>& p = *outline;
+            for (size_t i = 0; i < p.size(); ++i) {
+                sf::Vector2f a = p[i], b = p[(i + 1) % p.size()];
+                if (a.y == b.y) continue;
+                if (a.y > b.y) std::swap(a, b);
+                int first = static_cast<int>(std::ceil((a.y - top) / rowHeight - 0.5f));
+                int last = static_cast<int>(std::ceil((b.y - top) / rowHeight - 0.5f)) - 1;
+                for (int row = std::max(first, 0); row <= last && row < static_cast<int>(rows.size()); ++row) {
+                    float y = top + (row + 0.5f) * rowHeight;
+                    rows[row].push_back(a.x + (y - a.y) * (b.x - a.x) / (b.y - a.y));
+                }
+            }
+        }
+        for (auto& row : rows) {
+            std::sort(row.begin(), row.end());
+            for (size_t i = 0; i + 1 < row.size(); i += 2) filled += (row[i + 1] - row[i]) * rowHeight;
+        }
+    }
+
+    bool contains(sf::Vector2f p) const {
+        if (rows.empty() || p.y < bounds.position.y) return false;
+        size_t row = static_cast<size_t>((p.y - bounds.position.y) / rowHeight);
+        if (row >= rows.size()) return false;
+        const std::vector<float>& crossings = rows[row];
+        return (std::upper_bound(crossings.begin(), crossings.end(), p.x) - crossings.begin()) % 2 == 1;
+    }
+
+    bool empty() const { return filled <= 0.0f; }
+    float area() const { return filled; }
+    sf::FloatRect getBounds() const { return bounds; }
+
+private:
+    sf::FloatRect bounds;
+    float rowHeight = 1.0f;
+    std::vector<std::vector<float>> rows;
+    float filled = 0.0f;
+};
+
+// Blue-noise points inside a mask, no two closer than radius (Bridson's
+// algorithm). A background grid of cells radius/sqrt(2) wide holds at most
+// one point each, so checking a candidate looks at the 5x5 cells around it
+// and the whole run is O(points). Every grid cell whose centre is inside and
+// still free of neighbours seeds a new run, so separate shapes and corners
+// the growth couldn't reach get filled too. The same seed gives the same
+// points, so a preview redrawn every frame doesn't flicker.
+inline std::vector<sf::Vector2f> PoissonDiskSample(const ShapeMask& mask, float radius, uint32_t seed = 1, int attempts = 12) {
+    std::vector<sf::Vector2f> points;
+    sf::FloatRect area = mask.getBounds();
+    if (mask.empty() || radius <= 0.0f) return points;
+
+    float cell = radius / std::sqrt(2.0f);
+    int columns = static_cast<int>(area.size.x / cell) + 1, rows = static_cast<int>(area.size.y / cell) + 1;
+    std::vector<int> grid(static_cast<size_t>(columns) * rows, -1);
+    auto cellOf = [&](sf::Vector2f p) {
+        return sf::Vector2i(static_cast<int>((p.x - area.position.x) / cell), static_cast<int>((p.y - area.position.y) / cell));
+    };
+    auto isFree = [&](sf::Vector2f p) {
+        sf::Vector2i c = cellOf(p);
+        for (int y = std::max(c.y - 2, 0); y <= std::min(c.y + 2, rows - 1); ++y) {
+            for (int x = std::max(c.x - 2, 0); x <= std::min(c.x + 2, columns - 1); ++x) {
+                int other = grid[static_cast<size_t>(y) * columns + x];
+                if (other < 0) continue;
+                sf::Vector2f d = points[other] - p;
+                if (d.x * d.x + d.y * d.y < radius * radius) return false;
+            }
+        }
+        return true;
+    };
+    auto add = [&](sf::Vector2f p) {
+        sf::Vector2i c = cellOf(p);
+        grid[static_cast<size_t>(c.y) * columns + c.x] = static_cast<int>(points.size());
+        points.push_back(p);
+    };
+
+    // Candidates go round the growing point in even steps from a random
+    // start, just beyond radius (Roberts' variant): far fewer tries than
+    // random ones in the ring, and a denser, more even packing
+    float stepCos = std::cos(6.2831853f / attempts), stepSin = std::sin(6.2831853f / attempts);
+    float reach = radius * 1.001f;
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<int> growing;
+    for (int y = 0; y < rows; ++y) {
+        for (int x = 0; x < columns; ++x) {
+            sf::Vector2f centre(area.position.x + (x + 0.5f) * cell, area.position.y + (y + 0.5f) * cell);
+            if (grid[static_cast<size_t>(y) * columns + x] >= 0 || !mask.contains(centre) || !isFree(centre)) continue;
+            add(centre);
+            growing.push_back(static_cast<int>(points.size()) - 1);
+            while (!growing.empty()) {
+                size_t pick = static_cast<size_t>(unit(rng) * growing.size()) % growing.size();
+                sf::Vector2f from = points[growing[pick]];
+                bool grew = false;
+                float angle = unit(rng) * 6.2831853f;
+                sf::Vector2f direction(std::cos(angle), std::sin(angle));
+                for (int k = 0; k < attempts; ++k) {
+                    sf::Vector2f candidate = from + direction * reach;
+                    direction = sf::Vector2f(direction.x * stepCos - direction.y * stepSin, direction.x * stepSin + direction.y * stepCos);
+                    if (!area.contains(candidate) || !mask.contains(candidate) || !isFree(candidate)) continue;
+                    add(candidate);
+                    growing.push_back(static_cast<int>(points.size()) - 1);
+                    grew = true;
+                    break;
+                }
+                if (!grew) {
+                    growing[pick] = growing.back();
+                    growing.pop_back();
+                }
+            }
+        }
+    }
+    return points;
+}
+
+// Exactly count blue-noise points filling the mask. The sampler packs about
+// 0.84 / radius^2 points per unit of area; the radius starts from that and is
+// corrected from the number each run produced, so one run, sometimes two,
+// lands just above count. The few extra points are dropped at
+// random, which leaves the spacing as it was.
+inline std::vector<sf::Vector2f> FillShape(const ShapeMask& mask, int count, uint32_t seed = 1) {
+    if (count <= 0 || mask.empty()) return {};
+    const float DENSITY = 0.84f;
+    float radius = std::sqrt(DENSITY * mask.area() / (count * 1.02f));
+    std::vector<sf::Vector2f> points;
+    for (int run = 0; run < 8; ++run) {
+        points = PoissonDiskSample(mask, radius, seed);
+        size_t target = static_cast<size_t>(count);
+        if (points.size() >= target && points.size() <= target + target / 20 + 1) break;
+        // Aim a little high: too many can be dropped, too few can't be made up
+        float correction = std::sqrt(points.size() / (count * 1.02f));
+        radius *= std::clamp(correction, 0.5f, 2.0f);
+        if (points.size() < target) radius *= 0.99f;
+    }
+    if (points.size() > static_cast<size_t>(count)) {
+        std::mt19937 rng(seed);
+        for (size_t i = 0; i < static_cast<size_t>(count); ++i) {
+            std::uniform_int_distribution<size_t> pick(i, points.size() - 1);
+            std::swap(points[i], points[pick(rng)]);
+        }
+        points.resize(count);
+    }
+    return points;
+}
+
+#endif // SHAPE_FILL_H
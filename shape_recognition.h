@@ -0,0 +1,598 @@
+#ifndef SHAPE_RECOGNITION_H
+#define SHAPE_RECOGNITION_H
+
+#include <SFML/System/Vector2.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <utility>
+#include <vector>
+#include "shape_fill.h"
+#include "stroke_history.h"
+
+enum class ShapeKind { None, Line, Circle, Ellipse, Rectangle, Polygon };
+
+inline const char* ShapeName(ShapeKind kind) {
+    switch (kind) {
+    case ShapeKind::Line: return "line";
+    case ShapeKind::Circle: return "circle";
+    case ShapeKind::Ellipse: return "ellipse";
+    case ShapeKind::Rectangle: return "rectangle";
+    case ShapeKind::Polygon: return "polygon";
+    default: return "freehand";
+    }
+}
+
+// The ideal shape a stroke was recognized as. A handful of numbers describe
+// it: circles and ellipses by their centre, radii and rotation; lines by
+// their two ends; rectangles and polygons by their corners.
+struct RecognizedShape {
+    ShapeKind kind = ShapeKind::None;
+    float error = 0.0f;      // RMS distance of the stroke from the shape, in its units
+    float confidence = 0.0f; // 1 for a perfect fit, down to 0 at the tolerance
+    sf::Vector2f center;
+    sf::Vector2f radii;      // along angle and across it
+    float angle = 0.0f;      // radians
+    float startAngle = 0.0f; // where on a circle or ellipse the stroke started, in its own frame
+    bool clockwise = false;  // drawing direction on screen (y down), for curves
+    std::vector<sf::Vector2f> corners;
+};
+
+struct RecognitionSettings {
+    // RMS distance allowed between a stroke and its ideal shape, as a share
+    // of the shape's size: a line's length, or for closed shapes the RMS
+    // distance of the stroke from its centre, so they compare with each other
+    float lineTolerance = 0.025f;
+    float curveTolerance = 0.05f;
+    float polygonTolerance = 0.035f;
+    // Ellipses rounder than this are drawn as circles
+    float circleAxisRatio = 0.85f;
+    float closeDistance = 20.0f;
+    int maxCorners = 8;
+    // Turns sharper than this make a corner
+    float cornerAngle = 0.6f;
+    // Sides shorter than this share of the outline are a corner drawn twice
+    float minSide = 0.06f;
+    // Corners within this of square make a rectangle; lines, ellipses and
+    // rectangles within snapAngle of the axes are straightened if they still fit
+    float rightAngleSlack = 0.26f;
+    float snapAngle = 0.07f;
+    // Strokes shorter than this are dots, not shapes
+    float minLength = 12.0f;
+};
+
+namespace shape_fit {
+
+const float PI = 3.14159265f;
+
+inline float Length(sf::Vector2f v) { return std::sqrt(v.x * v.x + v.y * v.y); }
+
+// count points evenly spaced along a polyline. Points the mouse reported
+// close together where it moved slowly would otherwise outweigh the rest.
+inline std::vector<sf::Vector2f> Resample(const std::vector<sf::Vector2f>& points, int count, double& length) {
+    std::vector<double> along(points.size(), 0.0);
+    for (size_t i = 1; i < points.size(); ++i) along[i] = along[i - 1] + Length(points[i] - points[i - 1]);
+    length = along.back();
+    std::vector<sf::Vector2f> even;
+    if (length <= 0.0) return even;
+    size_t segment = 1;
+    for (int k = 0; k < count; ++k) {
+        double at = length * k / (count - 1);
+        while (segment + 1 < points.size() && along[segment] < at) ++segment;
+        double span = along[segment] - along[segment - 1];
+        float t = span > 0.0 ? static_cast<float>((at - along[segment - 1]) / span) : 0.0f;
+        even.push_back(points[segment - 1] + (points[segment] - points[segment - 1]) * t);
+    }
+    return even;
+}
+
+// Solves the N x N system a x = b in place by Gaussian elimination with
+// partial pivoting; false if it is singular
+template <size_t N>
+bool Solve(std::array<double, N * N>& a, std::array<double, N>& b) {
+    for (size_t col = 0; col < N; ++col) {
+        size_t pivot = col;
+        for (size_t row = col + 1; row < N; ++row) {
+            if (std::abs(a[row * N + col]) > std::abs(a[pivot * N + col])) pivot = row;
+        }
+        if (std::abs(a[pivot * N + col]) < 1e-12) return false;
+        for (size_t k = 0; k < N; ++k) std::swap(a[col * N + k], a[pivot * N + k]);
+        std::swap(b[col], b[pivot]);
+        for (size_t row = col + 1; row < N; ++row) {
+            double f = a[row * N + col] / a[col * N + col];
+            for (size_t k = col; k < N; ++k) a[row * N + k] -= f * a[col * N + k];
+            b[row] -= f * b[col];
+        }
+    }
+    for (size_t col = N; col-- > 0;) {
+        for (size_t k = col + 1; k < N; ++k) b[col] -= a[col * N + k] * b[k];
+        b[col] /= a[col * N + col];
+    }
+    return true;
+}
+
+// Least squares over rows of N terms: accumulates the normal equations
+template <size_t N>
+struct NormalEquations {
+    std::array<double, N * N> a{};
+    std::array<double, N> b{};
+
+    void add(const std::array<double, N>& row, double value) {
+        for (size_t i = 0; i < N; ++i) {
+            for (size_t j = 0; j < N; ++j) a[i * N + j] += row[i] * row[j];
+            b[i] += row[i] * value;
+        }
+    }
+};
+
+struct Line {
+    sf::Vector2f point;     // on the line: the centroid of the points fitted
+    sf::Vector2f direction; // unit length
+    float rms = 0.0f;       // of the perpendicular distances
+    double sxx = 0.0, syy = 0.0, sxy = 0.0; // scatter of the points about point
+};
+
+// Total least squares: the line through the centroid along the points'
+// main axis, which minimises the perpendicular distances
+inline Line FitLine(const sf::Vector2f* points, size_t count) {
+    Line line;
+    if (count == 0) return line;
+    double mx = 0.0, my = 0.0;
+    for (size_t i = 0; i < count; ++i) {
+        mx += points[i].x;
+        my += points[i].y;
+    }
+    mx /= count;
+    my /= count;
+    double sxx = 0.0, syy = 0.0, sxy = 0.0;
+    for (size_t i = 0; i < count; ++i) {
+        double dx = points[i].x - mx, dy = points[i].y - my;
+        sxx += dx * dx;
+        syy += dy * dy;
+        sxy += dx * dy;
+    }
+    line.sxx = sxx;
+    line.syy = syy;
+    line.sxy = sxy;
+    double angle = 0.5 * std::atan2(2.0 * sxy, sxx - syy);
+    line.point = sf::Vector2f(static_cast<float>(mx), static_cast<float>(my));
+    line.direction = sf::Vector2f(static_cast<float>(std::cos(angle)), static_cast<float>(std::sin(angle)));
+    // The smaller eigenvalue of the scatter is the sum of squared perpendicular distances
+    double across = 0.5 * (sxx + syy) - std::sqrt(0.25 * (sxx - syy) * (sxx - syy) + sxy * sxy);
+    line.rms = static_cast<float>(std::sqrt(std::max(across, 0.0) / count));
+    return line;
+}
+
+inline bool Intersect(const Line& a, const Line& b, sf::Vector2f& at) {
+    float cross = a.direction.x * b.direction.y - a.direction.y * b.direction.x;
+    if (std::abs(cross) < 1e-4f) return false;
+    sf::Vector2f d = b.point - a.point;
+    float t = (d.x * b.direction.y - d.y * b.direction.x) / cross;
+    at = a.point + a.direction * t;
+    return true;
+}
+
+inline float SegmentDistance(sf::Vector2f p, sf::Vector2f a, sf::Vector2f b) {
+    sf::Vector2f ab = b - a, ap = p - a;
+    float lengthSq = ab.x * ab.x + ab.y * ab.y;
+    float t = lengthSq > 0.0f ? std::clamp((ap.x * ab.x + ap.y * ab.y) / lengthSq, 0.0f, 1.0f) : 0.0f;
+    return Length(ap - ab * t);
+}
+
+// RMS distance of the points from a closed polygon
+inline float PolygonError(const std::vector<sf::Vector2f>& points, const std::vector<sf::Vector2f>& corners) {
+    double sum = 0.0;
+    for (sf::Vector2f p : points) {
+        float best = INFINITY;
+        for (size_t i = 0; i < corners.size(); ++i) best = std::min(best, SegmentDistance(p, corners[i], corners[(i + 1) % corners.size()]));
+        sum += best * best;
+    }
+    return static_cast<float>(std::sqrt(sum / points.size()));
+}
+
+// Distance of a point from an ellipse, measured along the ray from its
+// centre: exact for circles and close for ellipses that aren't too flat
+inline float EllipseDistance(sf::Vector2f p, const RecognizedShape& e) {
+    sf::Vector2f d = p - e.center;
+    float c = std::cos(e.angle), s = std::sin(e.angle);
+    float u = d.x * c + d.y * s, v = -d.x * s + d.y * c;
+    float k = std::sqrt((u * u) / (e.radii.x * e.radii.x) + (v * v) / (e.radii.y * e.radii.y));
+    return k > 0.0f ? Length(d) * std::abs(1.0f - 1.0f / k) : std::min(e.radii.x, e.radii.y);
+}
+
+inline float EllipseError(const std::vector<sf::Vector2f>& points, const RecognizedShape& e) {
+    double sum = 0.0;
+    for (sf::Vector2f p : points) {
+        float d = EllipseDistance(p, e);
+        sum += d * d;
+    }
+    return static_cast<float>(std::sqrt(sum / points.size()));
+}
+
+// Circle through the points by Kasa's algebraic fit, x^2 + y^2 + Dx + Ey + F = 0
+// in the least-squares sense: one 3x3 solve, and unbiased for whole circles
+inline bool FitCircle(const std::vector<sf::Vector2f>& points, sf::Vector2f origin, float scale, RecognizedShape& circle) {
+    NormalEquations<3> fit;
+    for (sf::Vector2f p : points) {
+        double x = (p.x - origin.x) / scale, y = (p.y - origin.y) / scale;
+        fit.add({x, y, 1.0}, -(x * x + y * y));
+    }
+    if (!Solve<3>(fit.a, fit.b)) return false;
+    double cx = -fit.b[0] / 2.0, cy = -fit.b[1] / 2.0, r2 = cx * cx + cy * cy - fit.b[2];
+    if (r2 <= 0.0) return false;
+    circle.kind = ShapeKind::Circle;
+    circle.center = origin + sf::Vector2f(static_cast<float>(cx), static_cast<float>(cy)) * scale;
+    float r = static_cast<float>(std::sqrt(r2)) * scale;
+    circle.radii = sf::Vector2f(r, r);
+    circle.angle = 0.0f;
+    return true;
+}
+
+// Ellipse through the points as the conic Ax^2 + Bxy + Cy^2 + Dx + Ey + F = 0
+// with A + C = 1, fitted by linear least squares. The constraint doesn't
+// change under rotation, so neither does the fit. Coordinates are centred
+// and scaled first to keep the equations well conditioned.
+inline bool FitEllipse(const std::vector<sf::Vector2f>& points, sf::Vector2f origin, float scale, RecognizedShape& ellipse) {
+    NormalEquations<5> fit;
+    for (sf::Vector2f p : points) {
+        double x = (p.x - origin.x) / scale, y = (p.y - origin.y) / scale;
+        fit.add({x * x - y * y, x * y, x, y, 1.0}, -y * y);
+    }
+    if (!Solve<5>(fit.a, fit.b)) return false;
+    double a = fit.b[0], b = fit.b[1], c = 1.0 - a, d = fit.b[2], e = fit.b[3], f = fit.b[4];
+    double det = 4.0 * a * c - b * b;
+    if (det <= 1e-9) return false; // a parabola or hyperbola
+    double cx = (b * e - 2.0 * c * d) / det, cy = (b * d - 2.0 * a * e) / det;
+    double atCenter = a * cx * cx + b * cx * cy + c * cy * cy + d * cx + e * cy + f;
+    double mean = 0.5 * (a + c), spread = std::sqrt(0.25 * (a - c) * (a - c) + 0.25 * b * b);
+    double large = mean + spread, small = mean - spread;
+    if (small <= 0.0 || atCenter >= 0.0) return false;
+    ellipse.kind = ShapeKind::Ellipse;
+    ellipse.center = origin + sf::Vector2f(static_cast<float>(cx), static_cast<float>(cy)) * scale;
+    // The axis along angle belongs to the larger eigenvalue, so it is the shorter one
+    ellipse.angle = static_cast<float>(0.5 * std::atan2(b, a - c));
+    ellipse.radii = sf::Vector2f(static_cast<float>(std::sqrt(-atCenter / large)), static_cast<float>(std::sqrt(-atCenter / small))) * scale;
+    return true;
+}
+
+// Corners of an evenly resampled closed loop: Douglas-Peucker from its two
+// points furthest apart, then corners dropped again where the turn is too
+// gentle or two of them sit on one rounded-off or overshot corner
+inline std::vector<size_t> FindCorners(const std::vector<sf::Vector2f>& loop, float tolerance, float minTurn, float minSide) {
+    size_t n = loop.size();
+    size_t far = 0;
+    float farthest = 0.0f;
+    for (size_t i = 1; i < n; ++i) {
+        float d = Length(loop[i] - loop[0]);
+        if (d > farthest) {
+            farthest = d;
+            far = i;
+        }
+    }
+    std::vector<uint8_t> keep(n, 0);
+    keep[0] = keep[far] = 1;
+    std::vector<std::pair<size_t, size_t>> spans{{0, far}, {far, n}};
+    while (!spans.empty()) {
+        auto [first, last] = spans.back();
+        spans.pop_back();
+        sf::Vector2f a = loop[first], b = loop[last % n];
+        float worst = tolerance;
+        size_t worstIndex = 0;
+        for (size_t i = first + 1; i < last; ++i) {
+            float d = SegmentDistance(loop[i], a, b);
+            if (d > worst) {
+                worst = d;
+                worstIndex = i;
+            }
+        }
+        if (worstIndex) {
+            keep[worstIndex] = 1;
+            spans.push_back({first, worstIndex});
+            spans.push_back({worstIndex, last});
+        }
+    }
+    std::vector<size_t> corners;
+    for (size_t i = 0; i < n; ++i) {
+        if (keep[i]) corners.push_back(i);
+    }
+
+    // Dropping a corner changes the turns of its neighbours, so one goes at a
+    // time: the gentlest, or else the gentler end of the shortest side. The
+    // loop is evenly sampled, so a side's length is its count of samples.
+    size_t shortest = static_cast<size_t>(minSide * n);
+    std::vector<float> turns;
+    while (corners.size() > 2) {
+        size_t m = corners.size();
+        turns.resize(m);
+        for (size_t k = 0; k < m; ++k) {
+            sf::Vector2f prev = loop[corners[(k + m - 1) % m]];
+            sf::Vector2f here = loop[corners[k]], next = loop[corners[(k + 1) % m]];
+            sf::Vector2f in = here - prev, out = next - here;
+            turns[k] = std::abs(std::atan2(in.x * out.y - in.y * out.x, in.x * out.x + in.y * out.y));
+        }
+        size_t gentlest = std::min_element(turns.begin(), turns.end()) - turns.begin();
+        if (turns[gentlest] >= minTurn) {
+            size_t side = 0, sideLength = n;
+            for (size_t k = 0; k < m; ++k) {
+                size_t length = (corners[(k + 1) % m] + n - corners[k]) % n;
+                if (length < sideLength) {
+                    sideLength = length;
+                    side = k;
+                }
+            }
+            if (sideLength >= shortest) break;
+            gentlest = turns[side] < turns[(side + 1) % m] ? side : (side + 1) % m;
+        }
+        corners.erase(corners.begin() + gentlest);
+    }
+    return corners;
+}
+
+// Snaps an angle to the nearest multiple of a right angle within slack
+inline float SnapToAxis(float angle, float slack) {
+    float quarter = PI / 2.0f;
+    float nearest = std::round(angle / quarter) * quarter;
+    return std::abs(angle - nearest) <= slack ? nearest : angle;
+}
+
+} // namespace shape_fit
+
+// Classifies a stroke (canvas coordinates) as one of the shapes above by
+// least-squares fits against each, and returns the simplest one the stroke
+// stays close enough to. Open strokes can only be lines; closed ones are
+// tried as circle, ellipse and polygon and the best fit relative to its
+// tolerance wins, a circle taking precedence over a nearly round ellipse.
+// Polygons get their corners from where the straight sides fitted between
+// them meet, and four nearly square corners make a true rectangle.
+// A stroke that fits nothing well enough comes back as ShapeKind::None.
+inline RecognizedShape RecognizeShape(const std::vector<sf::Vector2f>& stroke, const RecognitionSettings& settings = {}) {
+    using namespace shape_fit;
+    // Snapping to the axes may cost this share of the tolerance in fit
+    const float SNAP_COST = 0.25f;
+    RecognizedShape none;
+    if (stroke.size() < 2) return none;
+    const int SAMPLES = 128;
+    double length = 0.0;
+    std::vector<sf::Vector2f> points = Resample(stroke, SAMPLES, length);
+    if (length < settings.minLength) return none;
+
+    if (!IsClosedStroke(stroke, length, settings.closeDistance)) {
+        Line line = FitLine(points.data(), points.size());
+        // The ends are the first and last points projected onto the line
+        auto project = [&](sf::Vector2f p) {
+            sf::Vector2f d = p - line.point;
+            return line.point + line.direction * (d.x * line.direction.x + d.y * line.direction.y);
+        };
+        sf::Vector2f from = project(points.front()), to = project(points.back());
+        float span = Length(to - from);
+        // A stroke that doubles back on itself is no line, however straight
+        float backtrack = 0.0f;
+        sf::Vector2f forward = span > 0.0f ? (to - from) / span : sf::Vector2f();
+        for (size_t i = 1; i < points.size(); ++i) {
+            sf::Vector2f step = points[i] - points[i - 1];
+            backtrack += std::max(0.0f, -(step.x * forward.x + step.y * forward.y));
+        }
+        if (span <= 0.0f || backtrack > span * 0.1f || line.rms > span * settings.lineTolerance) return none;
+
+        auto lineError = [&](sf::Vector2f a, sf::Vector2f b) {
+            double sum = 0.0;
+            for (sf::Vector2f p : points) sum += SegmentDistance(p, a, b) * SegmentDistance(p, a, b);
+            return static_cast<float>(std::sqrt(sum / points.size()));
+        };
+        RecognizedShape result;
+        result.kind = ShapeKind::Line;
+        result.corners = {from, to};
+        result.error = lineError(from, to);
+        float angle = std::atan2(to.y - from.y, to.x - from.x);
+        float snapped = SnapToAxis(angle, settings.snapAngle);
+        if (snapped != angle) {
+            sf::Vector2f middle = (from + to) * 0.5f, half = sf::Vector2f(std::cos(snapped), std::sin(snapped)) * (span / 2.0f);
+            float error = lineError(middle - half, middle + half);
+            if (error <= result.error + span * settings.lineTolerance * SNAP_COST) {
+                result.corners = {middle - half, middle + half};
+                result.error = error;
+            }
+        }
+        result.confidence = std::clamp(1.0f - result.error / (span * settings.lineTolerance), 0.0f, 1.0f);
+        return result;
+    }
+
+    // The closing gap is left out of the fits: the last point usually overshoots
+    // or falls short of the first, and the shape closes by definition
+    points.pop_back();
+    sf::Vector2f centroid;
+    for (sf::Vector2f p : points) centroid += p;
+    centroid /= static_cast<float>(points.size());
+    double spread = 0.0;
+    for (sf::Vector2f p : points) spread += (p - centroid).x * (p - centroid).x + (p - centroid).y * (p - centroid).y;
+    float size = static_cast<float>(std::sqrt(spread / points.size()));
+    if (size <= 0.0f) return none;
+
+    RecognizedShape best;
+    float bestScore = 1.0f; // error over tolerance; anything above 1 is rejected
+    auto consider = [&](RecognizedShape shape, float tolerance) {
+        float score = shape.error / (size * tolerance);
+        if (score < bestScore) {
+            bestScore = score;
+            shape.confidence = 1.0f - score;
+            best = std::move(shape);
+        }
+    };
+
+    RecognizedShape circle, ellipse;
+    bool haveCircle = FitCircle(points, centroid, size, circle);
+    if (haveCircle) circle.error = EllipseError(points, circle);
+    if (FitEllipse(points, centroid, size, ellipse)) {
+        ellipse.error = EllipseError(points, ellipse);
+        bool round = std::min(ellipse.radii.x, ellipse.radii.y) >= settings.circleAxisRatio * std::max(ellipse.radii.x, ellipse.radii.y);
+        if (!round) {
+            // Lean ellipses are kept upright or level when they nearly are
+            float snapped = SnapToAxis(ellipse.angle, settings.snapAngle);
+            if (snapped != ellipse.angle) {
+                RecognizedShape level = ellipse;
+                level.angle = snapped;
+                level.error = EllipseError(points, level);
+                if (level.error <= ellipse.error + size * settings.curveTolerance * SNAP_COST) ellipse = level;
+            }
+            consider(ellipse, settings.curveTolerance);
+        } else if (!haveCircle || ellipse.error < circle.error * 0.9f) {
+            // Kasa's fit leans towards the denser side of a lopsided stroke;
+            // the ellipse's centre and mean radius make a better circle then
+            RecognizedShape roundEllipse = ellipse;
+            float r = std::sqrt(ellipse.radii.x * ellipse.radii.y);
+            roundEllipse.kind = ShapeKind::Circle;
+            roundEllipse.radii = sf::Vector2f(r, r);
+            roundEllipse.angle = 0.0f;
+            roundEllipse.error = EllipseError(points, roundEllipse);
+            if (!haveCircle || roundEllipse.error < circle.error) circle = roundEllipse;
+            haveCircle = true;
+        }
+    }
+    if (haveCircle) consider(circle, settings.curveTolerance);
+
+    // Polygon: corners where the loop turns sharply, then a line fitted to the
+    // middle of every side between them and the corners moved to where
+    // neighbouring sides meet, which drawn corners usually round off
+    std::vector<size_t> corners = FindCorners(points, size * settings.polygonTolerance * 2.0f, settings.cornerAngle, settings.minSide);
+    if (corners.size() >= 3 && corners.size() <= static_cast<size_t>(settings.maxCorners)) {
+        size_t n = points.size();
+        std::vector<Line> sides;
+        std::vector<sf::Vector2f> side;
+        for (size_t k = 0; k < corners.size(); ++k) {
+            size_t first = corners[k], last = k + 1 < corners.size() ? corners[k + 1] : corners[0] + n;
+            size_t margin = (last - first) / 6;
+            side.clear();
+            for (size_t i = first + margin; i <= last - margin; ++i) side.push_back(points[i % n]);
+            sides.push_back(FitLine(side.data(), side.size()));
+        }
+        RecognizedShape polygon;
+        polygon.kind = ShapeKind::Polygon;
+        bool closed = true;
+        for (size_t k = 0; k < sides.size() && closed; ++k) {
+            sf::Vector2f corner;
+            closed = Intersect(sides[(k + sides.size() - 1) % sides.size()], sides[k], corner);
+            polygon.corners.push_back(corner);
+        }
+        if (closed) {
+            polygon.error = PolygonError(points, polygon.corners);
+
+            // Four nearly square corners: the rectangle whose orientation fits
+            // all four sides best, each edge where its side lies on average
+            bool square = corners.size() == 4;
+            for (size_t k = 0; k < 4 && square; ++k) {
+                sf::Vector2f a = sides[k].direction, b = sides[(k + 1) % 4].direction;
+                square = std::abs(a.x * b.x + a.y * b.y) <= std::sin(settings.rightAngleSlack);
+            }
+            if (square) {
+                // Sides 0 and 2 run one way, 1 and 3 the other: turned a right angle,
+                // the scatter of 1 and 3 adds to that of 0 and 2, and the main
+                // axis of the sum is the least-squares direction of sides 0 and 2
+                double sxx = 0.0, syy = 0.0, sxy = 0.0;
+                for (size_t k = 0; k < 4; ++k) {
+                    sxx += k % 2 ? sides[k].syy : sides[k].sxx;
+                    syy += k % 2 ? sides[k].sxx : sides[k].syy;
+                    sxy += k % 2 ? -sides[k].sxy : sides[k].sxy;
+                }
+                auto makeRectangle = [&](float angle) {
+                    sf::Vector2f along(std::cos(angle), std::sin(angle)), across(-along.y, along.x);
+                    auto offset = [&](const Line& s, sf::Vector2f axis) { return s.point.x * axis.x + s.point.y * axis.y; };
+                    float a0 = offset(sides[0], across), a2 = offset(sides[2], across);
+                    float b1 = offset(sides[1], along), b3 = offset(sides[3], along);
+                    RecognizedShape rectangle;
+                    rectangle.kind = ShapeKind::Rectangle;
+                    // Keep the drawing's first corner and direction
+                    auto corner = [&](float a, float b) { return across * a + along * b; };
+                    rectangle.corners = {corner(a0, b3), corner(a0, b1), corner(a2, b1), corner(a2, b3)};
+                    rectangle.center = (rectangle.corners[0] + rectangle.corners[2]) * 0.5f;
+                    rectangle.radii = sf::Vector2f(std::abs(b1 - b3), std::abs(a2 - a0)) * 0.5f;
+                    rectangle.angle = angle;
+                    rectangle.error = PolygonError(points, rectangle.corners);
+                    return rectangle;
+                };
+                float angle = static_cast<float>(0.5 * std::atan2(2.0 * sxy, sxx - syy));
+                RecognizedShape rectangle = makeRectangle(angle);
+                if (SnapToAxis(angle, settings.snapAngle) != angle) {
+                    RecognizedShape level = makeRectangle(SnapToAxis(angle, settings.snapAngle));
+                    if (level.error <= rectangle.error + size * settings.polygonTolerance * SNAP_COST) rectangle = level;
+                }
+                // The rectangle can't fit as closely as the free quadrilateral;
+                // it wins unless it fits markedly worse
+                if (rectangle.error <= polygon.error * 1.5f + size * settings.polygonTolerance * 0.5f) polygon = rectangle;
+            }
+            consider(polygon, settings.polygonTolerance);
+        }
+    }
+
+    if (best.kind == ShapeKind::Circle || best.kind == ShapeKind::Ellipse) {
+        // Start where the stroke did, going the way it went
+        sf::Vector2f d = points.front() - best.center;
+        float c = std::cos(best.angle), s = std::sin(best.angle);
+        best.startAngle = std::atan2((-d.x * s + d.y * c) / best.radii.y, (d.x * c + d.y * s) / best.radii.x);
+        double turning = 0.0;
+        for (size_t i = 0; i < points.size(); ++i) {
+            sf::Vector2f a = points[i] - best.center, b = points[(i + 1) % points.size()] - best.center;
+            turning += std::atan2(a.x * b.y - a.y * b.x, a.x * b.x + a.y * b.y);
+        }
+        best.clockwise = turning > 0.0; // y points down
+    }
+    return best;
+}
+
+// The shape as a polyline in canvas coordinates: the ends of a line, the
+// corners of a polygon back to the first, or a circle or ellipse with as few
+// points as keep every chord within tolerance of the true curve. Closed
+// shapes end on their first point.
+inline std::vector<sf::Vector2f> ShapeOutline(const RecognizedShape& shape, float tolerance = 0.25f) {
+    std::vector<sf::Vector2f> outline;
+    switch (shape.kind) {
+    case ShapeKind::Line:
+        outline = shape.corners;
+        break;
+    case ShapeKind::Rectangle:
+    case ShapeKind::Polygon:
+        outline = shape.corners;
+        if (!outline.empty()) outline.push_back(outline.front());
+        break;
+    case ShapeKind::Circle:
+    case ShapeKind::Ellipse: {
+        float r = std::max(shape.radii.x, shape.radii.y);
+        float step = tolerance < r ? 2.0f * std::acos(1.0f - tolerance / r) : shape_fit::PI / 6.0f;
+        int count = std::clamp(static_cast<int>(std::ceil(2.0f * shape_fit::PI / step)), 12, 1440);
+        float c = std::cos(shape.angle), s = std::sin(shape.angle);
+        float direction = shape.clockwise ? 1.0f : -1.0f;
+        for (int k = 0; k <= count; ++k) {
+            float t = shape.startAngle + direction * 2.0f * shape_fit::PI * (k % count) / count;
+            float u = shape.radii.x * std::cos(t), v = shape.radii.y * std::sin(t);
+            outline.push_back(shape.center + sf::Vector2f(u * c - v * s, u * s + v * c));
+        }
+        break;
+    }
+    default:
+        break;
+    }
+    return outline;
+}
+
+// Samples for a stroke replaced by its ideal shape, in canvas coordinates
+// like a baked stroke: the outline at the stroke's median width, with the
+// drawing time spread evenly along it so the shape reads as drawn at a steady pace
+inline StrokeSamples ShapeSamples(const Stroke& stroke, const RecognizedShape& shape) {
+    StrokeSamples samples;
+    std::vector<sf::Vector2f> outline = ShapeOutline(shape);
+    if (outline.size() < 2 || stroke.size() == 0) return samples;
+    std::vector<float> widths = stroke.widths();
+    std::nth_element(widths.begin(), widths.begin() + widths.size() / 2, widths.end());
+    float width = widths[widths.size() / 2] * TransformScale(stroke.transform);
+    float duration = stroke.times().back() - stroke.times().front();
+
+    double total = 0.0;
+    for (size_t i = 1; i < outline.size(); ++i) total += shape_fit::Length(outline[i] - outline[i - 1]);
+    double along = 0.0;
+    for (size_t i = 0; i < outline.size(); ++i) {
+        if (i > 0) along += shape_fit::Length(outline[i] - outline[i - 1]);
+        samples.push(outline[i], width, total > 0.0 ? static_cast<float>(along / total) * duration : 0.0f);
+    }
+    return samples;
+}
+
+#endif // SHAPE_RECOGNITION_H
@@ -0,0 +1,227 @@
+#ifndef SOFTWARE_RASTER_H
+#define SOFTWARE_RASTER_H
+
+#include <SFML/Graphics/Color.hpp>
+#include <SFML/Graphics/Image.hpp>
+#include <SFML/Graphics/Transform.hpp>
+#include <SFML/System/Vector2.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include "stroke_history.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SOFTWARE_RASTER_SSE2 1
+#endif
+
+// Rows per band; each worker thread rasterizes whole bands
+const unsigned RASTER_BAND_ROWS = 32;
+
+// RGBA pixels in the same layout as sf::Image
+struct RasterImage {
+    unsigned width = 0;
+    unsigned height = 0;
+    std::vector<std::uint8_t> pixels;
+
+    sf::Image toImage() const {
+        return sf::Image(sf::Vector2u(width, height), pixels.data());
+    }
+};
+
+// A segment with a radius at each end; a circle when a == b
+struct RasterCapsule {
+    sf::Vector2f a, b;
+    float radiusA, radiusB;
+};
+
+// CPU rasterizer for exporting drawings without a window or GPU. Strokes are
+// rendered from the stroke model itself: every segment is a capsule whose
+// coverage at a pixel comes from the distance to the segment, which gives
+// anti-aliased edges and round joins for free. Each scanline only visits the
+// pixels within reach of the segment. The image is split into horizontal
+// bands that worker threads rasterize and composite independently, so no
+// locking is needed.
+class SoftwareRasterizer {
+public:
+    SoftwareRasterizer(unsigned width, unsigned height, unsigned threads = 0)
+        : threadCount(threads ? threads : std::max(1u, std::thread::hardware_concurrency())) {
+        target.width = width;
+        target.height = height;
+        target.pixels.assign(static_cast<size_t>(width) * height * 4, 0);
+    }
+
+    void clear(sf::Color color) {
+        if (target.pixels.empty()) return;
+        const std::uint8_t rgba[4] = {color.r, color.g, color.b, color.a};
+        std::copy(rgba, rgba + 4, target.pixels.begin());
+        // Double the filled prefix each time instead of writing byte by byte
+        for (size_t filled = 4; filled < target.pixels.size(); filled *= 2) {
+            size_t count = std::min(filled, target.pixels.size() - filled);
+            std::copy_n(target.pixels.begin(), count, target.pixels.begin() + filled);
+        }
+    }
+
+    // Draws strokes in canvas coordinates; view maps the canvas onto the image
+    void drawStrokes(const std::vector<StrokePtr>& strokes, sf::Color color, const sf::Transform& view = sf::Transform::Identity) {
+        std::vector<RasterCapsule> capsules;
+        for (const auto& stroke : strokes) {
+            sf::Transform toImage = view * stroke->transform;
+            float scale = TransformScale(toImage);
+            const auto& points = stroke->points();
+            const auto& widths = stroke->widths();
+            for (size_t i = 0; i + 1 < points.size(); ++i) {
+                capsules.push_back(RasterCapsule{toImage.transformPoint(points[i]), toImage.transformPoint(points[i + 1]),
+                                                 widths[i] * scale / 2.0f, widths[i + 1] * scale / 2.0f});
+            }
+        }
+        drawCapsules(capsules, color);
+    }
+
+    void drawCircles(const std::vector<sf::Vector2f>& centers, float radius, sf::Color color, const sf::Transform& view = sf::Transform::Identity) {
+        std::vector<RasterCapsule> capsules;
+        for (const auto& center : centers) {
+            sf::Vector2f p = view.transformPoint(center);
+            capsules.push_back(RasterCapsule{p, p, radius, radius});
+        }
+        drawCapsules(capsules, color);
+    }
+
+    // One pass: coverage of all capsules is merged (max, so overlaps don't
+    // darken) and then blended over the image with color
+    void drawCapsules(const std::vector<RasterCapsule>& capsules, sf::Color color) {
+        unsigned bandCount = (target.height + RASTER_BAND_ROWS - 1) / RASTER_BAND_ROWS;
+        std::vector<std::vector<uint32_t>> bands(bandCount);
+        for (uint32_t i = 0; i < capsules.size(); ++i) {
+            const RasterCapsule& c = capsules[i];
+            float reach = std::max(c.radiusA, c.radiusB) + 1.0f;
+            float top = std::min(c.a.y, c.b.y) - reach, bottom = std::max(c.a.y, c.b.y) + reach;
+            if (bottom < 0.0f || top >= target.height) continue;
+            unsigned first = static_cast<unsigned>(std::max(0.0f, top)) / RASTER_BAND_ROWS;
+            unsigned last = std::min(static_cast<unsigned>(bottom), target.height - 1) / RASTER_BAND_ROWS;
+            for (unsigned band = first; band <= last; ++band) bands[band].push_back(i);
+        }
+
+        std::atomic<unsigned> nextBand{0};
+        auto worker = [&]() {
+            std::vector<float> coverage(static_cast<size_t>(target.width) * RASTER_BAND_ROWS, 0.0f);
+            std::vector<int> spanMin(RASTER_BAND_ROWS), spanMax(RASTER_BAND_ROWS);
+            for (unsigned band = nextBand++; band < bandCount; band = nextBand++) {
+                if (bands[band].empty()) continue;
+                std::fill(spanMin.begin(), spanMin.end(), static_cast<int>(target.width));
+                std::fill(spanMax.begin(), spanMax.end(), -1);
+                unsigned y0 = band * RASTER_BAND_ROWS;
+                unsigned rows = std::min(RASTER_BAND_ROWS, target.height - y0);
+                for (uint32_t i : bands[band]) {
+                    rasterCapsule(capsules[i], y0, rows, coverage, spanMin, spanMax);
+                }
+                composite(y0, rows, coverage, spanMin, spanMax, color);
+            }
+        };
+
+        unsigned threads = std::min(threadCount, std::max(1u, bandCount));
+        std::vector<std::thread> pool;
+        for (unsigned t = 1; t < threads; ++t) pool.emplace_back(worker);
+        worker();
+        for (auto& thread : pool) thread.join();
+    }
+
+    const RasterImage& image() const { return target; }
+
+private:
+    // Accumulates one capsule's coverage into rows [y0, y0 + rows) of the band
+    void rasterCapsule(const RasterCapsule& c, unsigned y0, unsigned rows, std::vector<float>& coverage,
+                       std::vector<int>& spanMin, std::vector<int>& spanMax) const {
+        float reach = std::max(c.radiusA, c.radiusB) + 0.5f;
+        sf::Vector2f ab = c.b - c.a;
+        float lengthSq = ab.x * ab.x + ab.y * ab.y;
+        float length = std::sqrt(lengthSq);
+        sf::Vector2f n = length > 0.0f ? sf::Vector2f(-ab.y, ab.x) / length : sf::Vector2f(0.0f, 0.0f);
+
+        float boxMinX = std::min(c.a.x, c.b.x) - reach, boxMaxX = std::max(c.a.x, c.b.x) + reach;
+        int rowFirst = std::max(static_cast<int>(y0), static_cast<int>(std::floor(std::min(c.a.y, c.b.y) - reach)));
+        int rowLast = std::min(static_cast<int>(y0 + rows) - 1, static_cast<int>(std::ceil(std::max(c.a.y, c.b.y) + reach)));
+
+        for (int y = rowFirst; y <= rowLast; ++y) {
+            float py = y + 0.5f;
+            // Pixels of this row within reach of the segment's line
+            float xMin = boxMinX, xMax = boxMaxX;
+            if (std::abs(n.x) > 1e-3f) {
+                float x0 = c.a.x - (n.y * (py - c.a.y) + reach) / n.x;
+                float x1 = c.a.x - (n.y * (py - c.a.y) - reach) / n.x;
+                xMin = std::max(xMin, std::min(x0, x1));
+                xMax = std::min(xMax, std::max(x0, x1));
+            }
+            int first = std::max(0, static_cast<int>(std::floor(xMin)));
+            int last = std::min(static_cast<int>(target.width) - 1, static_cast<int>(std::ceil(xMax)));
+            if (first > last) continue;
+
+            unsigned row = y - y0;
+            float* line = &coverage[static_cast<size_t>(row) * target.width];
+            int x = first;
+#ifdef SOFTWARE_RASTER_SSE2
+            // Four pixels at a time, branch free; the square root is cheap in SIMD
+            const __m128 abx = _mm_set1_ps(ab.x), aby = _mm_set1_ps(ab.y);
+            const __m128 inverseLengthSq = _mm_set1_ps(lengthSq > 0.0f ? 1.0f / lengthSq : 0.0f);
+            const __m128 py4 = _mm_set1_ps(py - c.a.y);
+            const __m128 radiusA = _mm_set1_ps(c.radiusA + 0.5f), radiusDelta = _mm_set1_ps(c.radiusB - c.radiusA);
+            const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+            for (; x + 3 <= last; x += 4) {
+                __m128 px = _mm_add_ps(_mm_set1_ps(x + 0.5f - c.a.x), _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f));
+                __m128 t = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(px, abx), _mm_mul_ps(py4, aby)), inverseLengthSq);
+                t = _mm_min_ps(_mm_max_ps(t, zero), one);
+                __m128 dx = _mm_sub_ps(px, _mm_mul_ps(abx, t));
+                __m128 dy = _mm_sub_ps(py4, _mm_mul_ps(aby, t));
+                __m128 distance = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)));
+                __m128 outer = _mm_add_ps(radiusA, _mm_mul_ps(radiusDelta, t));
+                __m128 value = _mm_min_ps(_mm_max_ps(_mm_sub_ps(outer, distance), zero), one);
+                _mm_storeu_ps(line + x, _mm_max_ps(_mm_loadu_ps(line + x), value));
+            }
+#endif
+            for (; x <= last; ++x) {
+                if (line[x] >= 1.0f) continue;
+                sf::Vector2f p(x + 0.5f - c.a.x, py - c.a.y);
+                float t = lengthSq > 0.0f ? std::clamp((p.x * ab.x + p.y * ab.y) / lengthSq, 0.0f, 1.0f) : 0.0f;
+                sf::Vector2f d = p - ab * t;
+                float distanceSq = d.x * d.x + d.y * d.y;
+                float radius = c.radiusA + (c.radiusB - c.radiusA) * t;
+                // Box-filtered edge: full inside, a 1 px ramp across the outline.
+                // Only pixels on the ramp need the square root.
+                float outer = radius + 0.5f, inner = std::max(radius - 0.5f, 0.0f);
+                if (distanceSq >= outer * outer) continue;
+                float value = distanceSq <= inner * inner ? 1.0f : std::clamp(outer - std::sqrt(distanceSq), 0.0f, 1.0f);
+                line[x] = std::max(line[x], value);
+            }
+            spanMin[row] = std::min(spanMin[row], first);
+            spanMax[row] = std::max(spanMax[row], last);
+        }
+    }
+
+    // Blends color over the touched span of each row and resets the coverage
+    void composite(unsigned y0, unsigned rows, std::vector<float>& coverage,
+                   const std::vector<int>& spanMin, const std::vector<int>& spanMax, sf::Color color) {
+        float alpha = color.a / 255.0f;
+        for (unsigned row = 0; row < rows; ++row) {
+            float* line = &coverage[static_cast<size_t>(row) * target.width];
+            std::uint8_t* out = &target.pixels[(static_cast<size_t>(y0 + row) * target.width) * 4];
+            for (int x = spanMin[row]; x <= spanMax[row]; ++x) {
+                float a = line[x] * alpha;
+                line[x] = 0.0f;
+                if (a <= 0.0f) continue;
+                std::uint8_t* px = out + 4 * x;
+                px[0] = static_cast<std::uint8_t>(px[0] + (color.r - px[0]) * a + 0.5f);
+                px[1] = static_cast<std::uint8_t>(px[1] + (color.g - px[1]) * a + 0.5f);
+                px[2] = static_cast<std::uint8_t>(px[2] + (color.b - px[2]) * a + 0.5f);
+                px[3] = static_cast<std::uint8_t>(px[3] + (255 - px[3]) * a + 0.5f);
+            }
+        }
+    }
+
+    unsigned threadCount;
+    RasterImage target;
+};
+
+#endif // SOFTWARE_RASTER_H
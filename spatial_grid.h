@@ -0,0 +1,243 @@
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+#include <SFML/System/Vector2.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "stroke_history.h"
+
+// Distance from point p to the segment a-b
+inline float DistanceToSegment(sf::Vector2f p, sf::Vector2f a, sf::Vector2f b) {
+    sf::Vector2f ab = b - a;
+    float lengthSq = ab.x * ab.x + ab.y * ab.y;
+    float t = lengthSq > 0.0f ? ((p.x - a.x) * ab.x + (p.y - a.y) * ab.y) / lengthSq : 0.0f;
+    t = std::clamp(t, 0.0f, 1.0f);
+    sf::Vector2f d = p - (a + ab * t);
+    return std::sqrt(d.x * d.x + d.y * d.y);
+}
+
+// Segment i of a stroke runs from point i to point i + 1
+struct SegmentRef {
+    uint32_t strokeId;
+    uint32_t index;
+};
+
+// Uniform grid spatial hash over stroke segments, using the same CELL_SIZE
+// cells as the mouse loop. Each segment is stored in every cell its padded
+// bounding box touches, so a query only looks at the segments near it.
+// Segments are stored in canvas coordinates, so a stroke whose transform
+// changes is removed and inserted again.
+//
+// Cells refer to segments of runs: the geometry a stroke was inserted with.
+// Pieces the eraser cuts out of a stroke stay on its run, each covering the
+// run's segments it still has, so a cut only drops the erased segments. A
+// segment the cut shortened keeps its cells, which still cover it.
+class SegmentGrid {
+public:
+    // padding should be half the line thickness so a query hits what is drawn
+    SegmentGrid(float cellSize, float padding) : cellSize(cellSize), padding(padding) {}
+
+    void insert(const StrokePtr& stroke) {
+        uint32_t run = nextRun++;
+        runs[run] = Run{stroke, {RunPiece{0, static_cast<uint32_t>(stroke->size() - 1), stroke->id}}};
+        strokes[stroke->id] = Placed{stroke, run};
+        forEachSegmentCell(*stroke, 0, stroke->size() - 1, [&](uint32_t index, uint64_t key) {
+            cells[key].push_back(RunRef{run, index});
+            ++entryCount;
+        });
+    }
+
+    void remove(const StrokePtr& stroke) {
+        auto it = strokes.find(stroke->id);
+        if (it == strokes.end()) return;
+        Run& run = runs.at(it->second.run);
+        auto piece = std::find_if(run.pieces.begin(), run.pieces.end(), [&](const RunPiece& p) { return p.strokeId == stroke->id; });
+        uint32_t begin = piece->begin, end = piece->end;
+        run.pieces.erase(piece);
+        removeSegments(it->second.run, begin, end);
+        if (run.pieces.empty()) runs.erase(it->second.run);
+        strokes.erase(it);
+    }
+
+    // stroke was cut into pieces (see SplitStroke); they take over its
+    // segments and only the ones erased leave the cells
+    void split(const StrokePtr& stroke, const std::vector<StrokePtr>& pieces, const std::vector<PieceOrigin>& origins) {
+        auto it = strokes.find(stroke->id);
+        if (it == strokes.end()) {
+            for (const auto& piece : pieces) insert(piece);
+            return;
+        }
+        uint32_t runId = it->second.run;
+        Run& run = runs.at(runId);
+        auto piece = std::find_if(run.pieces.begin(), run.pieces.end(), [&](const RunPiece& p) { return p.strokeId == stroke->id; });
+        uint32_t begin = piece->begin, end = piece->end;
+        piece = run.pieces.erase(piece);
+        strokes.erase(it);
+
+        std::vector<RunPiece> added;
+        for (size_t p = 0; p < pieces.size(); ++p) {
+            uint32_t first = begin + static_cast<uint32_t>(origins[p].offset);
+            added.push_back(RunPiece{first, first + static_cast<uint32_t>(pieces[p]->size() - 1), pieces[p]->id});
+            strokes[pieces[p]->id] = Placed{pieces[p], runId};
+        }
+        run.pieces.insert(piece, added.begin(), added.end());
+
+        // Segments between the pieces were erased
+        uint32_t next = begin;
+        for (const auto& p : added) {
+            removeSegments(runId, next, p.begin);
+            next = std::max(next, p.end);
+        }
+        removeSegments(runId, next, end);
+        if (run.pieces.empty()) runs.erase(runId);
+    }
+
+    void clear() {
+        cells.clear();
+        strokes.clear();
+        runs.clear();
+        entryCount = 0;
+    }
+
+    // Segments whose drawn outline lies within radius of center
+    std::vector<SegmentRef> query(sf::Vector2f center, float radius) const {
+        std::vector<SegmentRef> hits;
+        float reach = radius + padding;
+        int minX = cellOf(center.x - reach), maxX = cellOf(center.x + reach);
+        int minY = cellOf(center.y - reach), maxY = cellOf(center.y + reach);
+
+        for (int y = minY; y <= maxY; ++y) {
+            for (int x = minX; x <= maxX; ++x) {
+                auto it = cells.find(key(x, y));
+                if (it == cells.end()) continue;
+                for (const auto& ref : it->second) {
+                    forEachOwner(ref, [&](const Stroke& stroke, uint32_t index) {
+                        if (DistanceToSegment(center, stroke.point(index), stroke.point(index + 1)) <= reach) {
+                            hits.push_back(SegmentRef{stroke.id, index});
+                        }
+                    });
+                }
+            }
+        }
+
+        // A segment crossing several cells is found once per cell
+        std::sort(hits.begin(), hits.end(), [](const SegmentRef& a, const SegmentRef& b) {
+            return a.strokeId != b.strokeId ? a.strokeId < b.strokeId : a.index < b.index;
+        });
+        hits.erase(std::unique(hits.begin(), hits.end(), [](const SegmentRef& a, const SegmentRef& b) {
+            return a.strokeId == b.strokeId && a.index == b.index;
+        }), hits.end());
+        return hits;
+    }
+
+    StrokePtr stroke(uint32_t id) const {
+        auto it = strokes.find(id);
+        return it == strokes.end() ? nullptr : it->second.stroke;
+    }
+
+    float linePadding() const { return padding; }
+    size_t cellCount() const { return cells.size(); }
+    size_t entries() const { return entryCount; }
+
+private:
+    // A cell entry: segment of a run, which the pieces on it resolve to strokes
+    struct RunRef {
+        uint32_t run;
+        uint32_t segment;
+    };
+
+    // Segments [begin, end) of a run belong to stroke strokeId as its
+    // segments from 0. Neighbouring pieces share a segment when a cut fell
+    // inside it.
+    struct RunPiece {
+        uint32_t begin, end;
+        uint32_t strokeId;
+    };
+
+    struct Run {
+        StrokePtr source;               // the stroke the cells were computed from
+        std::vector<RunPiece> pieces;   // in order along the run
+    };
+
+    struct Placed {
+        StrokePtr stroke;
+        uint32_t run;
+    };
+
+    // Calls fn(stroke, index) for the strokes holding a cell entry's segment
+    template <typename Fn>
+    void forEachOwner(const RunRef& ref, Fn&& fn) const {
+        const Run& run = runs.at(ref.run);
+        auto piece = std::upper_bound(run.pieces.begin(), run.pieces.end(), ref.segment,
+                                      [](uint32_t segment, const RunPiece& p) { return segment < p.begin; });
+        while (piece != run.pieces.begin()) {
+            --piece;
+            if (piece->end <= ref.segment) break;
+            fn(*strokes.at(piece->strokeId).stroke, ref.segment - piece->begin);
+        }
+    }
+
+    bool covered(const Run& run, uint32_t index) const {
+        for (const auto& piece : run.pieces) {
+            if (piece.begin <= index && index < piece.end) return true;
+        }
+        return false;
+    }
+
+    // Takes the run's segments [begin, end) that no piece holds any more out of the cells
+    void removeSegments(uint32_t runId, uint32_t begin, uint32_t end) {
+        if (begin >= end) return;
+        const Run& run = runs.at(runId);
+        auto edge = [&](uint32_t index) { return (index == begin || index + 1 == end) && covered(run, index); };
+        forEachSegmentCell(*run.source, begin, end, [&](uint32_t index, uint64_t key) {
+            if (edge(index)) return;
+            auto it = cells.find(key);
+            if (it == cells.end()) return;
+            auto& refs = it->second;
+            for (size_t i = 0; i < refs.size(); ++i) {
+                if (refs[i].run == runId && refs[i].segment == index) {
+                    refs[i] = refs.back();
+                    refs.pop_back();
+                    --entryCount;
+                    break;
+                }
+            }
+            if (refs.empty()) cells.erase(it);
+        });
+    }
+
+    int cellOf(float v) const {
+        return static_cast<int>(std::floor(v / cellSize));
+    }
+
+    static uint64_t key(int x, int y) {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(y);
+    }
+
+    template <typename Fn>
+    void forEachSegmentCell(const Stroke& stroke, size_t begin, size_t end, Fn&& fn) const {
+        for (size_t i = begin; i < end; ++i) {
+            sf::Vector2f a = stroke.point(i), b = stroke.point(i + 1);
+            int minX = cellOf(std::min(a.x, b.x) - padding), maxX = cellOf(std::max(a.x, b.x) + padding);
+            int minY = cellOf(std::min(a.y, b.y) - padding), maxY = cellOf(std::max(a.y, b.y) + padding);
+            for (int y = minY; y <= maxY; ++y) {
+                for (int x = minX; x <= maxX; ++x) {
+                    fn(static_cast<uint32_t>(i), key(x, y));
+                }
+            }
+        }
+    }
+
+    float cellSize;
+    float padding;
+    std::unordered_map<uint64_t, std::vector<RunRef>> cells;
+    std::unordered_map<uint32_t, Run> runs;
+    std::unordered_map<uint32_t, Placed> strokes;
+    uint32_t nextRun = 0;
+    size_t entryCount = 0;
+};
+
+#endif // SPATIAL_GRID_H
@@ -0,0 +1,259 @@
+#ifndef STIPPLE_H
+#define STIPPLE_H
+
+#include <SFML/Graphics/Image.hpp>
+#include <SFML/System/Vector2.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <thread>
+#include <vector>
+
+// Which pixels count as ink. Auto takes the image's median as its background
+// and weights pixels by how far they are from it towards the other end: dark
+// strokes on a light page, or light text and lines on a dark screenshot.
+enum class StippleTone { Auto, Dark, Light };
+
+// Working pixels per icon that are enough to place it well
+const size_t STIPPLE_PIXELS_PER_ICON = 512;
+
+// How much ink each pixel of an image holds, at a working resolution: big
+// images are box-averaged down to at most maxPixels, since Lloyd relaxation
+// only needs a few hundred pixels per icon (STIPPLE_PIXELS_PER_ICON).
+class DensityMap {
+public:
+    DensityMap() = default;
+
+    // pixels holds channels bytes per pixel: 1 (grey), 3 (RGB) or 4 (RGBA)
+    DensityMap(const uint8_t* pixels, unsigned imageWidth, unsigned imageHeight, unsigned channels, size_t maxPixels,
+               StippleTone tone = StippleTone::Auto) {
+        if (!pixels || imageWidth == 0 || imageHeight == 0) return;
+        double area = static_cast<double>(imageWidth) * imageHeight;
+        factor = std::max(1u, static_cast<unsigned>(std::ceil(std::sqrt(area / std::max<size_t>(maxPixels, 1)))));
+        width = (imageWidth + factor - 1) / factor;
+        height = (imageHeight + factor - 1) / factor;
+
+        // Luminance and coverage of each working pixel, from the source pixels it covers
+        std::vector<float> luminance(static_cast<size_t>(width) * height), coverage(luminance.size());
+        for (unsigned y = 0; y < height; ++y) {
+            for (unsigned x = 0; x < width; ++x) {
+                float light = 0.0f, opaque = 0.0f;
+                unsigned n = 0;
+                for (unsigned sy = y * factor; sy < std::min((y + 1) * factor, imageHeight); ++sy) {
+                    for (unsigned sx = x * factor; sx < std::min((x + 1) * factor, imageWidth); ++sx) {
+                        const uint8_t* p = pixels + (static_cast<size_t>(sy) * imageWidth + sx) * channels;
+                        float l = channels >= 3 ? (0.299f * p[0] + 0.587f * p[1] + 0.114f * p[2]) / 255.0f : p[0] / 255.0f;
+                        float a = channels == 4 ? p[3] / 255.0f : 1.0f;
+                        light += l * a;
+                        opaque += a;
+                        ++n;
+                    }
+                }
+                size_t i = static_cast<size_t>(y) * width + x;
+                luminance[i] = opaque > 0.0f ? light / opaque : 0.0f;
+                coverage[i] = opaque / n;
+            }
+        }
+
+        float background = tone == StippleTone::Dark ? 1.0f : 0.0f;
+        if (tone == StippleTone::Auto) {
+            std::vector<float> sorted = luminance;
+            std::nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2, sorted.end());
+            background = sorted[sorted.size() / 2];
+        }
+        bool lightInk = tone == StippleTone::Light || (tone == StippleTone::Auto && background < 0.5f);
+        weights.resize(luminance.size());
+        for (size_t i = 0; i < weights.size(); ++i) {
+            float ink = lightInk ? (luminance[i] - background) / std::max(1.0f - background, 1e-3f)
+                                 : (background - luminance[i]) / std::max(background, 1e-3f);
+            weights[i] = std::max(ink, 0.0f) * coverage[i];
+        }
+    }
+
+    static DensityMap fromImage(const sf::Image& image, size_t maxPixels, StippleTone tone = StippleTone::Auto) {
+        return DensityMap(image.getPixelsPtr(), image.getSize().x, image.getSize().y, 4, maxPixels, tone);
+    }
+
+    bool empty() const { return weights.empty(); }
+    float weight(unsigned x, unsigned y) const { return weights[static_cast<size_t>(y) * width + x]; }
+
+    unsigned width = 0, height = 0;
+    unsigned factor = 1; // image pixels per working pixel, each way
+    std::vector<float> weights;
+};
+
+struct StippleSettings {
+    int maxIterations = 100;
+    // Stop once icons move less than this share of their spacing on average;
+    // by then the layout is within a few percent of where it would settle
+    float tolerance = 0.005f;
+    unsigned threads = 0; // 0: one per core
+    uint32_t seed = 1;
+};
+
+struct StippleResult {
+    std::vector<sf::Vector2f> points; // image pixels
+    int iterations = 0;
+    bool converged = false;
+    float lastMove = 0.0f; // average move of the last iteration, in image pixels
+};
+
+// count points spread like the ink of the image (weighted Lloyd relaxation,
+// "weighted Voronoi stippling"). Points start where a stratified draw from
+// the ink puts them; then every iteration gives each working pixel to its
+// nearest point and moves each point to the ink-weighted centre of its
+// pixels, until the points barely move.
+//
+// The nearest point is found per block of pixels a grid cell wide: the
+// points any pixel of the block could be nearest to are collected once from
+// the surrounding cells, so a pixel only compares a handful of them. Rows of
+// blocks are shared between threads, each summing into its own totals.
+// A point whose region holds no ink is moved to a fresh spot drawn from the ink.
+inline StippleResult StippleDensity(const DensityMap& density, int count, const StippleSettings& settings = {}) {
+    StippleResult result;
+    if (count <= 0 || density.empty()) return result;
+    const int w = static_cast<int>(density.width), h = static_cast<int>(density.height);
+
+    // Running total of ink in pixel order, for drawing spots in proportion to it
+    std::vector<double> cumulative(density.weights.size());
+    double ink = 0.0;
+    for (size_t i = 0; i < cumulative.size(); ++i) cumulative[i] = ink += density.weights[i];
+    if (ink <= 0.0) return result;
+    std::mt19937 rng(settings.seed);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    auto drawInk = [&](double at) {
+        size_t i = std::lower_bound(cumulative.begin(), cumulative.end(), at) - cumulative.begin();
+        i = std::min(i, cumulative.size() - 1);
+        return sf::Vector2f((i % w) + static_cast<float>(unit(rng)), (i / w) + static_cast<float>(unit(rng)));
+    };
+
+    std::vector<sf::Vector2f> points(count);
+    for (int k = 0; k < count; ++k) points[k] = drawInk((k + unit(rng)) * ink / count);
+
+    // Grid cells of about one point each
+    const int cell = std::max(4, static_cast<int>(std::sqrt(static_cast<double>(w) * h / count)));
+    const int gx = (w + cell - 1) / cell, gy = (h + cell - 1) / cell;
+    std::vector<int> cellStart(static_cast<size_t>(gx) * gy + 1), cellPoints(count);
+
+    unsigned threads = settings.threads ? settings.threads : std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min<unsigned>(threads, static_cast<unsigned>(gy));
+    struct Totals {
+        std::vector<double> weight, x, y;
+    };
+    std::vector<Totals> totals(threads);
+
+    const float spacing = static_cast<float>(cell);
+    for (int iteration = 0; iteration < settings.maxIterations; ++iteration) {
+        // Bucket the points by cell (counting sort)
+        std::fill(cellStart.begin(), cellStart.end(), 0);
+        auto cellOf = [&](sf::Vector2f p) {
+            int cx = std::clamp(static_cast<int>(p.x) / cell, 0, gx - 1), cy = std::clamp(static_cast<int>(p.y) / cell, 0, gy - 1);
+            return cy * gx + cx;
+        };
+        for (const auto& p : points) ++cellStart[cellOf(p) + 1];
+        for (size_t c = 1; c < cellStart.size(); ++c) cellStart[c] += cellStart[c - 1];
+        std::vector<int> fill(cellStart.begin(), cellStart.end() - 1);
+        for (int i = 0; i < count; ++i) cellPoints[fill[cellOf(points[i])]++] = i;
+
+        std::atomic<int> nextRow{0};
+        auto worker = [&](Totals& sum) {
+            sum.weight.assign(count, 0.0);
+            sum.x.assign(count, 0.0);
+            sum.y.assign(count, 0.0);
+            std::vector<int> candidates;
+            for (int by = nextRow++; by < gy; by = nextRow++) {
+                for (int bx = 0; bx < gx; ++bx) {
+                    float x0 = static_cast<float>(bx * cell), y0 = static_cast<float>(by * cell);
+                    float x1 = static_cast<float>(std::min((bx + 1) * cell, w)), y1 = static_cast<float>(std::min((by + 1) * cell, h));
+                    // Farthest and nearest a point can be from any pixel centre of the block
+                    auto farthest = [&](sf::Vector2f p) {
+                        float dx = std::max(std::abs(p.x - x0 - 0.5f), std::abs(p.x - x1 + 0.5f));
+                        float dy = std::max(std::abs(p.y - y0 - 0.5f), std::abs(p.y - y1 + 0.5f));
+                        return dx * dx + dy * dy;
+                    };
+                    auto nearest = [&](sf::Vector2f p) {
+                        float dx = std::max({x0 + 0.5f - p.x, 0.0f, p.x - x1 + 0.5f});
+                        float dy = std::max({y0 + 0.5f - p.y, 0.0f, p.y - y1 + 0.5f});
+                        return dx * dx + dy * dy;
+                    };
+                    // Grow rings of cells until none further out can beat the
+                    // best guaranteed distance found so far
+                    candidates.clear();
+                    float bound = INFINITY;
+                    for (int ring = 0; ring <= std::max(gx, gy); ++ring) {
+                        float gap = std::max(ring - 1, 0) * spacing;
+                        if (gap * gap > bound) break;
+                        for (int cy = by - ring; cy <= by + ring; ++cy) {
+                            if (cy < 0 || cy >= gy) continue;
+                            bool edgeRow = cy == by - ring || cy == by + ring;
+                            for (int cx = bx - ring; cx <= bx + ring; cx += edgeRow ? 1 : 2 * std::max(ring, 1)) {
+                                if (cx < 0 || cx >= gx) continue;
+                                int c = cy * gx + cx;
+                                for (int k = cellStart[c]; k < cellStart[c + 1]; ++k) {
+                                    candidates.push_back(cellPoints[k]);
+                                    bound = std::min(bound, farthest(points[cellPoints[k]]));
+                                }
+                            }
+                        }
+                    }
+                    candidates.erase(std::remove_if(candidates.begin(), candidates.end(),
+                                                    [&](int i) { return nearest(points[i]) > bound; }), candidates.end());
+
+                    for (int y = static_cast<int>(y0); y < static_cast<int>(y1); ++y) {
+                        for (int x = static_cast<int>(x0); x < static_cast<int>(x1); ++x) {
+                            float weight = density.weights[static_cast<size_t>(y) * w + x];
+                            if (weight <= 0.0f) continue;
+                            sf::Vector2f centre(x + 0.5f, y + 0.5f);
+                            int best = candidates[0];
+                            float bestDistance = INFINITY;
+                            for (int i : candidates) {
+                                sf::Vector2f d = points[i] - centre;
+                                float distance = d.x * d.x + d.y * d.y;
+                                if (distance < bestDistance) {
+                                    bestDistance = distance;
+                                    best = i;
+                                }
+                            }
+                            sum.weight[best] += weight;
+                            sum.x[best] += weight * centre.x;
+                            sum.y[best] += weight * centre.y;
+                        }
+                    }
+                }
+            }
+        };
+        std::vector<std::thread> pool;
+        for (unsigned t = 1; t < threads; ++t) pool.emplace_back(worker, std::ref(totals[t]));
+        worker(totals[0]);
+        for (auto& thread : pool) thread.join();
+
+        double moved = 0.0;
+        for (int i = 0; i < count; ++i) {
+            double weight = 0.0, x = 0.0, y = 0.0;
+            for (const Totals& sum : totals) {
+                weight += sum.weight[i];
+                x += sum.x[i];
+                y += sum.y[i];
+            }
+            sf::Vector2f target = weight > 0.0 ? sf::Vector2f(static_cast<float>(x / weight), static_cast<float>(y / weight))
+                                               : drawInk(unit(rng) * ink);
+            sf::Vector2f d = target - points[i];
+            moved += std::sqrt(d.x * d.x + d.y * d.y);
+            points[i] = target;
+        }
+        result.iterations = iteration + 1;
+        result.lastMove = static_cast<float>(moved / count) * density.factor;
+        if (moved / count < settings.tolerance * spacing) {
+            result.converged = true;
+            break;
+        }
+    }
+
+    for (auto& p : points) p *= static_cast<float>(density.factor);
+    result.points = std::move(points);
+    return result;
+}
+
+#endif // STIPPLE_H
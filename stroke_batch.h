@@ -0,0 +1,557 @@
+#ifndef STROKE_BATCH_H
+#define STROKE_BATCH_H
+
+#include <SFML/Graphics/RenderStates.hpp>
+#include <SFML/Graphics/RenderTarget.hpp>
+#include <SFML/Graphics/Vertex.hpp>
+#include <SFML/Graphics/VertexBuffer.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "stroke_bvh.h"
+#include "stroke_history.h"
+#include "stroke_lod.h"
+#include "stroke_tessellator.h"
+
+// Every stroke, finished or live, tessellated and unrolled into one triangle list in
+// canvas coordinates, so all finished strokes take one draw call. Strokes own
+// contiguous ranges of the list; the live stroke is always the last range and
+// grows as points arrive. Only the range touched since the last draw is
+// uploaded to the vertex buffer.
+//
+// Removed strokes leave degenerate holes that are squeezed out once they make
+// up half of the list, so removal stays O(stroke) instead of O(drawing).
+//
+// A stroke the eraser cuts keeps its triangles: each piece reuses the stretch
+// of the old range between the cuts and only the joins and caps next to a
+// cut are tessellated again, appended as extra spans of the piece's range.
+//
+// For zoomed-out views each stroke also has a pyramid of simplified copies,
+// built lazily level by level from the one below, so what gets submitted
+// follows the pixels a stroke covers rather than the points it was drawn with.
+class StrokeBatch {
+public:
+    explicit StrokeBatch(const StrokeStyle& style = StrokeStyle{}, sf::Color color = sf::Color::White)
+        : style(style), color(color), tessellator(style, color), buffer(sf::PrimitiveType::Triangles, sf::VertexBuffer::Usage::Dynamic) {}
+
+    const StrokeStyle& strokeStyle() const { return style; }
+
+    // Re-tessellates every finished stroke with the new style
+    void setStyle(const StrokeStyle& newStyle) {
+        style = newStyle;
+        tessellator = StrokeTessellator(style, color);
+        std::vector<StrokePtr> strokes;
+        for (const auto& [id, range] : ranges) strokes.push_back(range.stroke);
+        std::sort(strokes.begin(), strokes.end(), [](const StrokePtr& a, const StrokePtr& b) { return a->id < b->id; });
+        std::vector<sf::Vertex> live = takeLive();
+        vertices.clear();
+        ranges.clear();
+        holeVertices = 0;
+        liveFirst = 0;
+        for (const auto& stroke : strokes) add(stroke);
+        restoreLive(live);
+        markDirty(0, vertices.size());
+    }
+
+    void add(const StrokePtr& stroke) {
+        std::vector<sf::Vertex> live = takeLive();
+        Range range;
+        range.stroke = stroke;
+        appendWhole(range);
+        ranges[stroke->id] = std::move(range);
+        restoreLive(live);
+    }
+
+    void remove(const StrokePtr& stroke) {
+        auto it = ranges.find(stroke->id);
+        if (it == ranges.end()) return;
+        for (const Span& span : it->second.spans) fillHole(span);
+        ranges.erase(it);
+        if (holeVertices > vertices.size() / 2) compact();
+    }
+
+    // stroke was cut into pieces (see SplitStroke). A piece keeps the old
+    // triangles between its cuts and only the joins next to a cut and the
+    // new caps are tessellated; pieces too short for that, and pieces of a
+    // transformed stroke, are tessellated whole. Returns the canvas area
+    // whose triangles changed.
+    Box split(const StrokePtr& stroke, const std::vector<StrokePtr>& pieces, const std::vector<PieceOrigin>& origins) {
+        Box changed;
+        auto it = ranges.find(stroke->id);
+        if (it == ranges.end()) {
+            for (const auto& piece : pieces) changed = Union(changed, bounds(piece));
+            for (const auto& piece : pieces) add(piece);
+            return changed;
+        }
+        Range parent = std::move(it->second);
+        ranges.erase(it);
+        std::vector<sf::Vertex> live = takeLive();
+
+        const std::vector<uint32_t>& kept = parent.kept;
+        const std::vector<size_t>& marks = parent.marks;
+        size_t m = kept.size();
+        size_t stripLength = parent.count > 0 ? parent.count / 3 + 2 : 0;
+        bool reusable = stroke->transform == sf::Transform::Identity && m >= 2 && stripLength > 0;
+        std::vector<std::pair<size_t, size_t>> reused; // parent triangles taken over by the pieces
+
+        for (size_t p = 0; p < pieces.size(); ++p) {
+            const StrokeSamples& samples = pieces[p]->samples();
+            const PieceOrigin& origin = origins[p];
+            Range range;
+            range.stroke = pieces[p];
+
+            // Parent samples the piece has unchanged, and the kept points
+            // [first, last) whose caps and joins it can take over: the first
+            // and last of those joins have both their neighbours in the piece
+            size_t firstExact = origin.offset + (origin.clippedStart ? 1 : 0);
+            size_t lastExact = origin.offset + samples.size() - 1 - (origin.clippedEnd ? 1 : 0);
+            bool atStart = firstExact == 0;
+            bool atEnd = lastExact + 1 == stroke->size() && !origin.clippedEnd;
+            size_t first = 0, last = 0;
+            if (reusable && samples.size() >= 2 && firstExact <= lastExact) {
+                first = atStart ? 0 : std::lower_bound(kept.begin(), kept.end(), firstExact) - kept.begin() + 1;
+                last = atEnd ? m : std::upper_bound(kept.begin(), kept.end(), lastExact) - kept.begin() - 1;
+            }
+            if (!reusable || first >= last || first > m || last > m) {
+                changed = Union(changed, appendWhole(range));
+                ranges[pieces[p]->id] = std::move(range);
+                continue;
+            }
+
+            // Kept points of the piece: found afresh up to the one before the
+            // reused stretch and after it, the parent's in between
+            std::vector<uint32_t> pieceKept;
+            if (!atStart) {
+                for (size_t i = 0; i <= kept[first - 1] - origin.offset; ++i) StrokeTessellator::AdvanceKept(pieceKept, samples, i, style.tolerance);
+            }
+            size_t head = pieceKept.size();
+            for (size_t j = first; j < last; ++j) pieceKept.push_back(static_cast<uint32_t>(kept[j] - origin.offset));
+            if (!atEnd) {
+                std::vector<uint32_t> tail{static_cast<uint32_t>(kept[last] - origin.offset)};
+                for (size_t i = tail[0] + 1; i < samples.size(); ++i) StrokeTessellator::AdvanceKept(tail, samples, i, style.tolerance);
+                pieceKept.insert(pieceKept.end(), tail.begin(), tail.end());
+            }
+            size_t middleEnd = head + (last - first);
+            size_t reusedStrip = (last < m ? marks[last] : stripLength) - marks[first];
+
+            // New strip ahead of the reused one, joined to its first two vertices
+            std::vector<sf::Vertex> strip = tessellator.tessellateKept(samples, pieceKept, 0, head);
+            range.marks.assign(tessellator.keptMarks().begin(), tessellator.keptMarks().begin() + head);
+            size_t headLength = strip.size();
+            if (headLength > 0) {
+                strip.push_back(stripVertex(parent, marks[first]));
+                strip.push_back(stripVertex(parent, marks[first] + 1));
+                changed = Union(changed, appendStrip(range, strip));
+            }
+            for (size_t j = first; j < last; ++j) range.marks.push_back(marks[j] - marks[first] + headLength);
+            size_t t0 = marks[first], t1 = marks[first] + reusedStrip - 2;
+            appendParentTriangles(range, parent, t0, t1);
+            reused.push_back({t0, t1});
+
+            // New strip after it, starting from its last two vertices
+            if (!atEnd) {
+                const std::vector<sf::Vertex>& tail = tessellator.tessellateKept(samples, pieceKept, middleEnd, pieceKept.size());
+                for (size_t j = middleEnd; j < pieceKept.size(); ++j) range.marks.push_back(tessellator.keptMarks()[j] + headLength + reusedStrip);
+                strip.clear();
+                strip.push_back(stripVertex(parent, marks[first] + reusedStrip - 2));
+                strip.push_back(stripVertex(parent, marks[first] + reusedStrip - 1));
+                strip.insert(strip.end(), tail.begin(), tail.end());
+                changed = Union(changed, appendStrip(range, strip));
+            }
+            range.kept = std::move(pieceKept);
+            ranges[pieces[p]->id] = std::move(range);
+        }
+
+        // Whatever the pieces didn't take over becomes a hole
+        std::sort(reused.begin(), reused.end());
+        size_t triangle = 0;
+        reused.push_back({parent.count / 3, parent.count / 3});
+        for (const auto& [t0, t1] : reused) {
+            Range hole;
+            appendParentTriangles(hole, parent, triangle, t0);
+            for (const Span& span : hole.spans) {
+                for (size_t v = span.first; v < span.first + span.count; ++v) changed.expand(vertices[v].position);
+                fillHole(span);
+            }
+            triangle = std::max(triangle, t1);
+        }
+
+        restoreLive(live);
+        if (holeVertices > vertices.size() / 2) compact();
+        return changed;
+    }
+
+    // newStroke shares oldStroke's geometry under a new transform, so its
+    // vertices are rewritten in place
+    void retransform(const StrokePtr& oldStroke, const StrokePtr& newStroke) {
+        auto it = ranges.find(oldStroke->id);
+        if (it == ranges.end()) {
+            add(newStroke);
+            return;
+        }
+        // A piece left by the eraser may tessellate to a different length on its own
+        const std::vector<sf::Vertex>& strip = tessellator.tessellate(newStroke->samples());
+        if (triangleVertices(strip.size()) != it->second.count) {
+            remove(oldStroke);
+            add(newStroke);
+            return;
+        }
+        Range range = std::move(it->second);
+        ranges.erase(it);
+        range.stroke = newStroke;
+        range.lods.clear();
+        range.kept = tessellator.keptIndices();
+        range.marks = tessellator.keptMarks();
+        size_t t = 0;
+        for (const Span& span : range.spans) {
+            writeStrip(span.first - 3 * t, strip, t, t + span.count / 3, newStroke->transform);
+            markDirty(span.first, span.count);
+            t += span.count / 3;
+        }
+        ranges[newStroke->id] = std::move(range);
+    }
+
+    // Drops every stroke, including the live one
+    void clear() {
+        vertices.clear();
+        ranges.clear();
+        liveFirst = 0;
+        holeVertices = 0;
+    }
+
+    // Mirrors the live stroke's strip after StrokeTessellator::append. Only
+    // the triangles from the first changed strip vertex on are rewritten.
+    void updateLive(const std::vector<sf::Vertex>& strip, size_t firstChanged) {
+        size_t firstTriangle = firstChanged >= 2 ? firstChanged - 2 : 0;
+        vertices.resize(liveFirst + triangleVertices(strip.size()));
+        writeStrip(liveFirst, strip, firstTriangle, strip.size(), sf::Transform::Identity);
+        size_t start = liveFirst + 3 * firstTriangle;
+        if (start < vertices.size()) markDirty(start, vertices.size() - start);
+    }
+
+    // The live stroke became stroke. Appending points one by one tessellates
+    // exactly like a whole stroke, so its vertices are already in place;
+    // liveTessellator (the one that built them) has its kept points.
+    void commitLive(const StrokePtr& stroke, const StrokeTessellator& liveTessellator) {
+        Range range;
+        range.spans.push_back(Span{liveFirst, vertices.size() - liveFirst});
+        range.count = vertices.size() - liveFirst;
+        range.stroke = stroke;
+        range.kept = liveTessellator.keptIndices();
+        range.marks = liveTessellator.keptMarks();
+        ranges[stroke->id] = std::move(range);
+        liveFirst = vertices.size();
+    }
+
+    void cancelLive() {
+        markDirty(liveFirst, vertices.size() - liveFirst);
+        vertices.resize(liveFirst);
+    }
+
+    // Draws every finished stroke with one draw call. Strokes in skip (e.g. a
+    // selection being dragged) are left out, which splits the call around them.
+    void draw(sf::RenderTarget& target, const sf::RenderStates& states = sf::RenderStates::Default,
+              const std::unordered_set<uint32_t>& skip = {}) {
+        upload();
+        size_t start = 0;
+        if (!skip.empty()) {
+            std::vector<std::pair<size_t, size_t>> skipped;
+            for (uint32_t id : skip) {
+                auto it = ranges.find(id);
+                if (it == ranges.end()) continue;
+                for (const Span& span : it->second.spans) skipped.push_back({span.first, span.count});
+            }
+            std::sort(skipped.begin(), skipped.end());
+            for (const auto& [first, count] : skipped) {
+                drawRange(target, start, first - start, states);
+                start = first + count;
+            }
+        }
+        drawRange(target, start, liveFirst - start, states);
+    }
+
+    void drawLive(sf::RenderTarget& target, const sf::RenderStates& states = sf::RenderStates::Default) {
+        upload();
+        drawRange(target, liveFirst, vertices.size() - liveFirst, states);
+    }
+
+    // Draws one stroke on its own, e.g. with a drag transform in states
+    void drawStroke(sf::RenderTarget& target, uint32_t id, const sf::RenderStates& states) {
+        auto it = ranges.find(id);
+        if (it == ranges.end()) return;
+        upload();
+        for (const Span& span : it->second.spans) drawRange(target, span.first, span.count, states);
+    }
+
+    // Draws finished strokes, each at the coarsest level of detail whose error
+    // stays under maxError canvas units. The simplified ones share a single
+    // draw call; strokes that need full detail come from the vertex buffer.
+    void drawStrokes(sf::RenderTarget& target, const std::vector<uint32_t>& ids, float maxError,
+                     const sf::RenderStates& states = sf::RenderStates::Default) {
+        std::vector<std::pair<size_t, size_t>> full;
+        lodScratch.clear();
+        for (uint32_t id : ids) {
+            auto it = ranges.find(id);
+            if (it == ranges.end()) continue;
+            Range& range = it->second;
+            int level = LodLevel(maxError / TransformScale(range.stroke->transform));
+            const std::vector<sf::Vertex>* simplified = level >= 0 ? &lodTriangles(range, level) : nullptr;
+            if (simplified && simplified->size() < range.count) {
+                lodScratch.insert(lodScratch.end(), simplified->begin(), simplified->end());
+            } else {
+                for (const Span& span : range.spans) full.push_back({span.first, span.count});
+            }
+        }
+
+        // Neighbouring full-detail ranges go out as one call
+        if (!full.empty()) {
+            upload();
+            std::sort(full.begin(), full.end());
+            size_t first = full[0].first, end = full[0].first + full[0].second;
+            for (size_t i = 1; i < full.size(); ++i) {
+                if (full[i].first != end) {
+                    drawRange(target, first, end - first, states);
+                    first = full[i].first;
+                }
+                end = full[i].first + full[i].second;
+            }
+            drawRange(target, first, end - first, states);
+        }
+        if (!lodScratch.empty()) target.draw(lodScratch.data(), lodScratch.size(), sf::PrimitiveType::Triangles, states);
+        lodSubmitted += lodScratch.size();
+    }
+
+    size_t vertexCount() const { return vertices.size(); }
+    size_t strokeCount() const { return ranges.size(); }
+    size_t uploadedVertices() const { return uploaded; }
+    // Vertices drawn from simplified levels so far
+    size_t lodVertices() const { return lodSubmitted; }
+
+private:
+    // One level of a stroke's detail pyramid, as canvas-space triangles
+    struct Lod {
+        StrokeSamples samples;
+        std::vector<sf::Vertex> triangles;
+    };
+
+    // Vertices [first, first + count) of the list
+    struct Span {
+        size_t first;
+        size_t count;
+    };
+
+    // A stroke's triangles in order, usually one span; a piece left by the
+    // eraser has its new ends in spans of their own. kept and marks are the
+    // tessellator's kept points and their first strip vertices.
+    struct Range {
+        std::vector<Span> spans;
+        size_t count = 0;
+        StrokePtr stroke;
+        std::vector<Lod> lods;
+        std::vector<uint32_t> kept;
+        std::vector<size_t> marks;
+    };
+
+    // A strip of n vertices unrolls into n - 2 triangles
+    static size_t triangleVertices(size_t stripVertices) {
+        return stripVertices >= 3 ? 3 * (stripVertices - 2) : 0;
+    }
+
+    // Unrolls strip triangles [firstTriangle, endTriangle) into the list at offset
+    void writeStrip(size_t offset, const std::vector<sf::Vertex>& strip, size_t firstTriangle, size_t endTriangle, const sf::Transform& transform) {
+        bool identity = transform == sf::Transform::Identity;
+        for (size_t t = firstTriangle; t < endTriangle && t + 2 < strip.size(); ++t) {
+            sf::Vertex* out = &vertices[offset + 3 * t];
+            for (size_t v = 0; v < 3; ++v) {
+                out[v] = strip[t + v];
+                if (!identity) out[v].position = transform.transformPoint(out[v].position);
+            }
+        }
+    }
+
+    // Appends strip's triangles as a new span of range; returns their bounds
+    Box appendStrip(Range& range, const std::vector<sf::Vertex>& strip) {
+        Span span{vertices.size(), triangleVertices(strip.size())};
+        if (span.count == 0) return Box{};
+        vertices.resize(span.first + span.count);
+        writeStrip(span.first, strip, 0, strip.size(), range.stroke->transform);
+        markDirty(span.first, span.count);
+        range.spans.push_back(span);
+        range.count += span.count;
+        Box box;
+        for (size_t v = span.first; v < span.first + span.count; ++v) box.expand(vertices[v].position);
+        return box;
+    }
+
+    // Tessellates range's stroke whole into a new span
+    Box appendWhole(Range& range) {
+        Box box = appendStrip(range, tessellator.tessellate(range.stroke->samples()));
+        range.kept = tessellator.keptIndices();
+        range.marks = tessellator.keptMarks();
+        return box;
+    }
+
+    // Adds the spans holding from's triangles [t0, t1) to range
+    static void appendParentTriangles(Range& range, const Range& from, size_t t0, size_t t1) {
+        size_t t = 0;
+        for (const Span& span : from.spans) {
+            size_t end = t + span.count / 3;
+            size_t a = std::max(t, t0), b = std::min(end, t1);
+            if (a < b) {
+                range.spans.push_back(Span{span.first + 3 * (a - t), 3 * (b - a)});
+                range.count += 3 * (b - a);
+            }
+            t = end;
+        }
+    }
+
+    // Vertex v of the strip range's triangles were unrolled from
+    sf::Vertex stripVertex(const Range& range, size_t v) const {
+        size_t triangle = std::min(v, range.count / 3 - 1);
+        size_t t = 0;
+        for (const Span& span : range.spans) {
+            if (triangle < t + span.count / 3) return vertices[span.first + 3 * (triangle - t) + (v - triangle)];
+            t += span.count / 3;
+        }
+        return sf::Vertex{};
+    }
+
+    void fillHole(const Span& span) {
+        std::fill(vertices.begin() + span.first, vertices.begin() + span.first + span.count, sf::Vertex{});
+        markDirty(span.first, span.count);
+        holeVertices += span.count;
+    }
+
+    // Canvas bounds of a stroke's outline, for strokes that have no range yet
+    static Box bounds(const StrokePtr& stroke) {
+        Box box;
+        float reach = 0.0f;
+        for (size_t i = 0; i < stroke->size(); ++i) {
+            box.expand(stroke->point(i));
+            reach = std::max(reach, stroke->widths()[i] * TransformScale(stroke->transform) / 2.0f);
+        }
+        return box.padded(reach);
+    }
+
+    // Builds the pyramid up to level. Each level simplifies the one below with
+    // half its tolerance, so the errors add up to less than the level's own.
+    const std::vector<sf::Vertex>& lodTriangles(Range& range, int level) {
+        while (static_cast<int>(range.lods.size()) <= level) {
+            int k = static_cast<int>(range.lods.size());
+            const StrokeSamples& source = k == 0 ? range.stroke->samples() : range.lods.back().samples;
+            Lod lod;
+            lod.samples = SimplifySamples(source, LodTolerance(k) / 2.0f);
+            StrokeStyle lodStyle = style;
+            lodStyle.tolerance = std::max(style.tolerance, LodTolerance(k) / 2.0f);
+            std::vector<sf::Vertex> strip = TessellateStroke(lod.samples, lodStyle, color);
+            bool identity = range.stroke->transform == sf::Transform::Identity;
+            lod.triangles.reserve(triangleVertices(strip.size()));
+            for (size_t t = 0; t + 2 < strip.size(); ++t) {
+                for (size_t v = 0; v < 3; ++v) {
+                    lod.triangles.push_back(strip[t + v]);
+                    if (!identity) lod.triangles.back().position = range.stroke->transform.transformPoint(strip[t + v].position);
+                }
+            }
+            range.lods.push_back(std::move(lod));
+        }
+        return range.lods[level].triangles;
+    }
+
+    // Moves the live stroke out of the way so finished strokes can be appended
+    std::vector<sf::Vertex> takeLive() {
+        std::vector<sf::Vertex> live(vertices.begin() + liveFirst, vertices.end());
+        vertices.resize(liveFirst);
+        return live;
+    }
+
+    void restoreLive(const std::vector<sf::Vertex>& live) {
+        liveFirst = vertices.size();
+        vertices.insert(vertices.end(), live.begin(), live.end());
+        markDirty(liveFirst, live.size());
+    }
+
+    void compact() {
+        std::vector<sf::Vertex> live = takeLive();
+        std::vector<Span*> ordered;
+        for (auto& [id, range] : ranges) {
+            for (Span& span : range.spans) ordered.push_back(&span);
+        }
+        std::sort(ordered.begin(), ordered.end(), [](const Span* a, const Span* b) { return a->first < b->first; });
+
+        size_t next = 0;
+        for (Span* span : ordered) {
+            std::copy(vertices.begin() + span->first, vertices.begin() + span->first + span->count, vertices.begin() + next);
+            span->first = next;
+            next += span->count;
+        }
+        vertices.resize(next);
+        holeVertices = 0;
+        markDirty(0, vertices.size());
+        restoreLive(live);
+    }
+
+    void markDirty(size_t first, size_t count) {
+        if (count == 0) return;
+        dirtyBegin = std::min(dirtyBegin, first);
+        dirtyEnd = std::max(dirtyEnd, first + count);
+    }
+
+    // Sends the dirty range to the GPU, growing the buffer geometrically. If
+    // the driver refuses, the strokes are drawn from the vertex array from
+    // then on rather than from a buffer that is stale or empty.
+    void upload() {
+        if (!useBuffer) return;
+        if (buffer.getVertexCount() < vertices.size()) {
+            if (!buffer.create(std::max<size_t>(vertices.size() * 2, 1024))) {
+                bufferFailed("allocate");
+                return;
+            }
+            dirtyBegin = 0;
+            dirtyEnd = vertices.size();
+        }
+        dirtyEnd = std::min(dirtyEnd, vertices.size());
+        if (dirtyBegin < dirtyEnd) {
+            if (!buffer.update(&vertices[dirtyBegin], dirtyEnd - dirtyBegin, static_cast<unsigned int>(dirtyBegin))) {
+                bufferFailed("update");
+                return;
+            }
+            uploaded += dirtyEnd - dirtyBegin;
+        }
+        dirtyBegin = SIZE_MAX;
+        dirtyEnd = 0;
+    }
+
+    void bufferFailed(const char* operation) {
+        std::cout << "Could not " << operation << " the stroke vertex buffer, drawing from memory instead" << std::endl;
+        useBuffer = false;
+    }
+
+    void drawRange(sf::RenderTarget& target, size_t first, size_t count, const sf::RenderStates& states) {
+        if (count == 0) return;
+        if (useBuffer) {
+            target.draw(buffer, first, count, states);
+        } else {
+            target.draw(&vertices[first], count, sf::PrimitiveType::Triangles, states);
+        }
+    }
+
+    StrokeStyle style;
+    sf::Color color;
+    StrokeTessellator tessellator;
+    std::vector<sf::Vertex> vertices;
+    std::unordered_map<uint32_t, Range> ranges;
+    size_t liveFirst = 0;
+    size_t holeVertices = 0;
+    size_t dirtyBegin = SIZE_MAX;
+    size_t dirtyEnd = 0;
+    size_t uploaded = 0;
+    std::vector<sf::Vertex> lodScratch;
+    size_t lodSubmitted = 0;
+    sf::VertexBuffer buffer;
+    bool useBuffer = sf::VertexBuffer::isAvailable();
+};
+
+#endif // STROKE_BATCH_H
@@ -0,0 +1,554 @@
+#ifndef STROKE_BVH_H
+#define STROKE_BVH_H
+
+#include <SFML/Graphics/Transform.hpp>
+#include <SFML/System/Vector2.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+#include "spatial_grid.h"
+#include "stroke_history.h"
+
+// Axis-aligned bounding box
+struct Box {
+    float minX = std::numeric_limits<float>::max();
+    float minY = std::numeric_limits<float>::max();
+    float maxX = -std::numeric_limits<float>::max();
+    float maxY = -std::numeric_limits<float>::max();
+
+    bool empty() const { return minX > maxX; }
+
+    void expand(sf::Vector2f p) {
+        minX = std::min(minX, p.x);
+        minY = std::min(minY, p.y);
+        maxX = std::max(maxX, p.x);
+        maxY = std::max(maxY, p.y);
+    }
+
+    Box padded(float amount) const {
+        return Box{minX - amount, minY - amount, maxX + amount, maxY + amount};
+    }
+
+    float perimeter() const {
+        return 2.0f * ((maxX - minX) + (maxY - minY));
+    }
+
+    bool contains(const Box& other) const {
+        return minX <= other.minX && minY <= other.minY && other.maxX <= maxX && other.maxY <= maxY;
+    }
+
+    bool contains(sf::Vector2f p) const {
+        return minX <= p.x && p.x <= maxX && minY <= p.y && p.y <= maxY;
+    }
+
+    bool intersects(const Box& other) const {
+        return minX <= other.maxX && other.minX <= maxX && minY <= other.maxY && other.minY <= maxY;
+    }
+};
+
+inline Box Union(const Box& a, const Box& b) {
+    return Box{std::min(a.minX, b.minX), std::min(a.minY, b.minY), std::max(a.maxX, b.maxX), std::max(a.maxY, b.maxY)};
+}
+
+// Bounding box of a box after transform
+inline Box TransformBox(const sf::Transform& transform, const Box& box) {
+    Box result;
+    result.expand(transform.transformPoint({box.minX, box.minY}));
+    result.expand(transform.transformPoint({box.maxX, box.minY}));
+    result.expand(transform.transformPoint({box.minX, box.maxY}));
+    result.expand(transform.transformPoint({box.maxX, box.maxY}));
+    return result;
+}
+
+// Number of segments covered by one chunk bounding box inside a stroke
+const size_t BVH_CHUNK_SEGMENTS = 32;
+
+// Id used for the stroke that is still being drawn (history ids start at 1)
+const uint32_t LIVE_STROKE_ID = 0;
+
+// Top-level dynamic AABB tree over strokes, plus per-stroke bounding boxes
+// over runs of BVH_CHUNK_SEGMENTS segments. Leaves are inserted by the
+// cheapest perimeter increase and the tree is kept balanced with rotations,
+// so culling and picking stay logarithmic in the number of strokes. The
+// live stroke gets a fattened box so growing it rarely touches the tree.
+// Chunk boxes are kept in the stroke's local space; queries are mapped into
+// it, so changing a stroke's transform only moves its leaf. A piece the
+// eraser cut out of a stroke keeps the chunk boxes it lies in, with its
+// segments shifted against the chunk boundaries, so only the chunks at
+// its ends are measured again.
+class StrokeIndex {
+public:
+    // padding should be half the line thickness so boxes cover what is drawn
+    explicit StrokeIndex(float padding, float liveMargin = 32.0f) : padding(padding), liveMargin(liveMargin) {}
+
+    void insert(const StrokePtr& stroke) {
+        Entry& entry = entries[stroke->id];
+        entry.stroke = stroke;
+        entry.points = &stroke->points();
+        setTransform(entry, stroke->transform);
+        rebuildChunks(entry, 0);
+        entry.localBox = strokeBox(entry);
+        entry.leaf = insertLeaf(stroke->id, worldBox(entry));
+    }
+
+    // Switches an indexed stroke to a new version that shares its geometry
+    // but has a different transform, without touching its chunk boxes
+    void retransform(const StrokePtr& oldStroke, const StrokePtr& newStroke) {
+        auto it = entries.find(oldStroke->id);
+        if (it == entries.end() || it->second.points != &newStroke->points()) {
+            remove(oldStroke);
+            insert(newStroke);
+            return;
+        }
+
+        Entry entry = std::move(it->second);
+        entries.erase(it);
+        entry.stroke = newStroke;
+        setTransform(entry, newStroke->transform);
+        removeLeaf(entry.leaf);
+        nodes[entry.leaf].box = worldBox(entry);
+        nodes[entry.leaf].strokeId = newStroke->id;
+        insertLeaf(entry.leaf);
+        entries[newStroke->id] = std::move(entry);
+    }
+
+    // stroke was cut into pieces (see SplitStroke); each piece takes over the
+    // chunks it lies in and only the ones at its ends are recomputed
+    void split(const StrokePtr& stroke, const std::vector<StrokePtr>& pieces, const std::vector<PieceOrigin>& origins) {
+        auto it = entries.find(stroke->id);
+        if (it == entries.end() || it->second.transformed) {
+            remove(stroke);
+            for (const auto& piece : pieces) insert(piece);
+            return;
+        }
+        Entry parent = std::move(it->second);
+        entries.erase(it);
+        if (parent.leaf != NULL_NODE) {
+            removeLeaf(parent.leaf);
+            freeNode(parent.leaf);
+        }
+
+        for (size_t p = 0; p < pieces.size(); ++p) {
+            Entry& entry = entries[pieces[p]->id];
+            entry.stroke = pieces[p];
+            entry.points = &pieces[p]->points();
+            setTransform(entry, pieces[p]->transform);
+            size_t shifted = origins[p].offset + parent.shift;
+            size_t firstChunk = shifted / BVH_CHUNK_SEGMENTS;
+            entry.shift = shifted % BVH_CHUNK_SEGMENTS;
+            size_t segmentCount = entry.points->size() - 1;
+            size_t chunkCount = (segmentCount + entry.shift + BVH_CHUNK_SEGMENTS - 1) / BVH_CHUNK_SEGMENTS;
+            entry.chunks.assign(parent.chunks.begin() + std::min(firstChunk, parent.chunks.size()),
+                                parent.chunks.begin() + std::min(firstChunk + chunkCount, parent.chunks.size()));
+            entry.chunks.resize(chunkCount);
+            // The end chunks hold clipped segments or ones the piece doesn't have
+            rebuildChunk(entry, 0);
+            if (chunkCount > 1) rebuildChunk(entry, chunkCount - 1);
+            entry.localBox = strokeBox(entry);
+            entry.leaf = insertLeaf(pieces[p]->id, worldBox(entry));
+        }
+    }
+
+    void remove(uint32_t id) {
+        auto it = entries.find(id);
+        if (it == entries.end()) return;
+        if (it->second.leaf != NULL_NODE) {
+            removeLeaf(it->second.leaf);
+            freeNode(it->second.leaf);
+        }
+        entries.erase(it);
+    }
+
+    void remove(const StrokePtr& stroke) {
+        remove(stroke->id);
+    }
+
+    void clear() {
+        // The live stroke survives a clear of the finished strokes
+        auto live = entries.find(LIVE_STROKE_ID);
+        const std::vector<sf::Vector2f>* livePoints = live != entries.end() ? live->second.points : nullptr;
+        entries.clear();
+        nodes.clear();
+        freeList = NULL_NODE;
+        root = NULL_NODE;
+        if (livePoints) updateLive(*livePoints);
+    }
+
+    // Tracks the stroke being drawn. Only the chunks touched by new points are
+    // recomputed, and the tree is only updated when the stroke leaves its
+    // fattened box.
+    void updateLive(const std::vector<sf::Vector2f>& points) {
+        if (points.size() < 2) {
+            remove(LIVE_STROKE_ID);
+            return;
+        }
+
+        Entry& entry = entries[LIVE_STROKE_ID];
+        entry.points = &points;
+        size_t firstDirty = entry.chunks.empty() ? 0 : entry.chunks.size() - 1;
+        rebuildChunks(entry, firstDirty);
+
+        // The live stroke has no transform and only its last chunks can have grown
+        for (size_t c = firstDirty; c < entry.chunks.size(); ++c) {
+            entry.localBox = Union(entry.localBox, entry.chunks[c]);
+        }
+        Box box = entry.localBox;
+        if (entry.leaf == NULL_NODE) {
+            entry.leaf = insertLeaf(LIVE_STROKE_ID, box.padded(liveMargin));
+        } else if (!nodes[entry.leaf].box.contains(box)) {
+            removeLeaf(entry.leaf);
+            nodes[entry.leaf].box = box.padded(liveMargin);
+            insertLeaf(entry.leaf);
+        }
+    }
+
+    // Calls fn(id, points, firstSegment, endSegment) for every run of segments
+    // whose chunk box overlaps view. points are in the stroke's local space.
+    template <typename Fn>
+    void forEachVisible(const Box& view, Fn&& fn) const {
+        queryTree(view, [&](uint32_t id) {
+            const Entry& entry = entries.at(id);
+            Box local = localQuery(entry, view);
+            for (size_t c = 0; c < entry.chunks.size(); ++c) {
+                if (!entry.chunks[c].intersects(local)) continue;
+
+                // Merge neighbouring visible chunks into one run
+                size_t first = chunkFirst(entry, c);
+                while (c + 1 < entry.chunks.size() && entry.chunks[c + 1].intersects(local)) ++c;
+                fn(id, *entry.points, first, chunkEnd(entry, c));
+            }
+        });
+    }
+
+    // Ids of the finished strokes whose drawn outline overlaps box
+    std::vector<uint32_t> queryBox(const Box& box) const {
+        std::vector<uint32_t> ids;
+        queryTree(box, [&](uint32_t id) {
+            if (id == LIVE_STROKE_ID) return;
+            const Entry& entry = entries.at(id);
+            Box local = localQuery(entry, box);
+            for (size_t c = 0; c < entry.chunks.size(); ++c) {
+                if (!entry.chunks[c].intersects(local)) continue;
+                for (size_t i = chunkFirst(entry, c), end = chunkEnd(entry, c); i < end; ++i) {
+                    Box segment;
+                    segment.expand(worldPoint(entry, i));
+                    segment.expand(worldPoint(entry, i + 1));
+                    if (segment.padded(padding).intersects(box)) {
+                        ids.push_back(id);
+                        return;
+                    }
+                }
+            }
+        });
+        return ids;
+    }
+
+    // Finished stroke closest to p within tolerance of its drawn outline, or nullptr
+    StrokePtr pick(sf::Vector2f p, float tolerance) const {
+        float reach = tolerance + padding;
+        Box probe{p.x - reach, p.y - reach, p.x + reach, p.y + reach};
+        StrokePtr best;
+        float bestDistance = reach;
+
+        queryTree(probe, [&](uint32_t id) {
+            if (id == LIVE_STROKE_ID) return;
+            const Entry& entry = entries.at(id);
+            Box local = localQuery(entry, probe);
+            for (size_t c = 0; c < entry.chunks.size(); ++c) {
+                if (!entry.chunks[c].intersects(local)) continue;
+                for (size_t i = chunkFirst(entry, c), end = chunkEnd(entry, c); i < end; ++i) {
+                    float distance = DistanceToSegment(p, worldPoint(entry, i), worldPoint(entry, i + 1));
+                    if (distance <= bestDistance) {
+                        bestDistance = distance;
+                        best = entry.stroke;
+                    }
+                }
+            }
+        });
+        return best;
+    }
+
+    // The indexed version of a finished stroke, or nullptr
+    StrokePtr stroke(uint32_t id) const {
+        auto it = entries.find(id);
+        return it == entries.end() ? nullptr : it->second.stroke;
+    }
+
+    // Bounds of a stroke's drawn outline, or an empty box if it isn't indexed
+    Box bounds(uint32_t id) const {
+        auto it = entries.find(id);
+        return it == entries.end() ? Box{} : worldBox(it->second);
+    }
+
+    size_t size() const { return entries.size(); }
+    int height() const { return root == NULL_NODE ? 0 : nodes[root].height; }
+
+private:
+    static const int NULL_NODE = -1;
+
+    struct Node {
+        Box box;
+        int parent = NULL_NODE;
+        int child1 = NULL_NODE;
+        int child2 = NULL_NODE;
+        int height = 0; // leaves are 0, free nodes -1
+        uint32_t strokeId = 0;
+
+        bool isLeaf() const { return child1 == NULL_NODE; }
+    };
+
+    struct Entry {
+        StrokePtr stroke;
+        const std::vector<sf::Vector2f>* points = nullptr; // local space
+        sf::Transform transform;
+        sf::Transform inverse;
+        bool transformed = false;
+        size_t shift = 0;   // chunk c covers segments [c * BVH_CHUNK_SEGMENTS - shift, ...)
+        std::vector<Box> chunks;
+        Box localBox;
+        int leaf = NULL_NODE;
+    };
+
+    static void setTransform(Entry& entry, const sf::Transform& transform) {
+        entry.transform = transform;
+        entry.inverse = transform.getInverse();
+        entry.transformed = transform != sf::Transform::Identity;
+    }
+
+    static Box worldBox(const Entry& entry) {
+        return entry.transformed ? TransformBox(entry.transform, entry.localBox) : entry.localBox;
+    }
+
+    // A canvas-space query box mapped (conservatively) into the stroke's local space
+    static Box localQuery(const Entry& entry, const Box& box) {
+        return entry.transformed ? TransformBox(entry.inverse, box) : box;
+    }
+
+    static sf::Vector2f worldPoint(const Entry& entry, size_t i) {
+        const sf::Vector2f& p = (*entry.points)[i];
+        return entry.transformed ? entry.transform.transformPoint(p) : p;
+    }
+
+    // Segments [chunkFirst, chunkEnd) of chunk c
+    static size_t chunkFirst(const Entry& entry, size_t c) {
+        return c > 0 ? c * BVH_CHUNK_SEGMENTS - entry.shift : 0;
+    }
+
+    static size_t chunkEnd(const Entry& entry, size_t c) {
+        return std::min(entry.points->size() - 1, (c + 1) * BVH_CHUNK_SEGMENTS - entry.shift);
+    }
+
+    void rebuildChunks(Entry& entry, size_t firstChunk) {
+        const auto& points = *entry.points;
+        size_t segmentCount = points.size() > 1 ? points.size() - 1 : 0;
+        size_t chunkCount = (segmentCount + entry.shift + BVH_CHUNK_SEGMENTS - 1) / BVH_CHUNK_SEGMENTS;
+        entry.chunks.resize(chunkCount);
+        for (size_t c = firstChunk; c < chunkCount; ++c) rebuildChunk(entry, c);
+    }
+
+    void rebuildChunk(Entry& entry, size_t c) {
+        Box box;
+        for (size_t i = chunkFirst(entry, c), last = chunkEnd(entry, c); i <= last; ++i) box.expand((*entry.points)[i]);
+        entry.chunks[c] = box.padded(padding);
+    }
+
+    static Box strokeBox(const Entry& entry) {
+        Box box;
+        for (const auto& chunk : entry.chunks) box = Union(box, chunk);
+        return box;
+    }
+
+    template <typename Fn>
+    void queryTree(const Box& box, Fn&& fn) const {
+        if (root == NULL_NODE) return;
+        std::vector<int> stack;
+        stack.push_back(root);
+        while (!stack.empty()) {
+            const Node& node = nodes[stack.back()];
+            stack.pop_back();
+            if (!node.box.intersects(box)) continue;
+            if (node.isLeaf()) {
+                fn(node.strokeId);
+            } else {
+                stack.push_back(node.child1);
+                stack.push_back(node.child2);
+            }
+        }
+    }
+
+    int allocateNode() {
+        if (freeList == NULL_NODE) {
+            nodes.emplace_back();
+            return static_cast<int>(nodes.size() - 1);
+        }
+        int index = freeList;
+        freeList = nodes[index].parent;
+        nodes[index] = Node{};
+        return index;
+    }
+
+    void freeNode(int index) {
+        nodes[index].parent = freeList;
+        nodes[index].height = -1;
+        freeList = index;
+    }
+
+    int insertLeaf(uint32_t id, const Box& box) {
+        int leaf = allocateNode();
+        nodes[leaf].box = box;
+        nodes[leaf].strokeId = id;
+        insertLeaf(leaf);
+        return leaf;
+    }
+
+    void insertLeaf(int leaf) {
+        if (root == NULL_NODE) {
+            root = leaf;
+            nodes[root].parent = NULL_NODE;
+            return;
+        }
+
+        // Walk down to the sibling that grows the total perimeter the least
+        Box leafBox = nodes[leaf].box;
+        int index = root;
+        while (!nodes[index].isLeaf()) {
+            const Node& node = nodes[index];
+            float combined = Union(node.box, leafBox).perimeter();
+            float cost = 2.0f * combined;
+            float inheritance = 2.0f * (combined - node.box.perimeter());
+
+            auto childCost = [&](int child) {
+                const Node& c = nodes[child];
+                float grown = Union(leafBox, c.box).perimeter();
+                return (c.isLeaf() ? grown : grown - c.box.perimeter()) + inheritance;
+            };
+            float cost1 = childCost(node.child1);
+            float cost2 = childCost(node.child2);
+
+            if (cost < cost1 && cost < cost2) break;
+            index = cost1 < cost2 ? node.child1 : node.child2;
+        }
+
+        int sibling = index;
+        int oldParent = nodes[sibling].parent;
+        int newParent = allocateNode();
+        nodes[newParent].parent = oldParent;
+        nodes[newParent].box = Union(leafBox, nodes[sibling].box);
+        nodes[newParent].height = nodes[sibling].height + 1;
+        nodes[newParent].child1 = sibling;
+        nodes[newParent].child2 = leaf;
+        nodes[sibling].parent = newParent;
+        nodes[leaf].parent = newParent;
+
+        if (oldParent == NULL_NODE) {
+            root = newParent;
+        } else if (nodes[oldParent].child1 == sibling) {
+            nodes[oldParent].child1 = newParent;
+        } else {
+            nodes[oldParent].child2 = newParent;
+        }
+
+        refitFrom(nodes[leaf].parent);
+    }
+
+    void removeLeaf(int leaf) {
+        if (leaf == root) {
+            root = NULL_NODE;
+            return;
+        }
+
+        int parent = nodes[leaf].parent;
+        int grandParent = nodes[parent].parent;
+        int sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+
+        if (grandParent == NULL_NODE) {
+            root = sibling;
+            nodes[sibling].parent = NULL_NODE;
+            freeNode(parent);
+            return;
+        }
+
+        if (nodes[grandParent].child1 == parent) {
+            nodes[grandParent].child1 = sibling;
+        } else {
+            nodes[grandParent].child2 = sibling;
+        }
+        nodes[sibling].parent = grandParent;
+        freeNode(parent);
+        refitFrom(grandParent);
+    }
+
+    // Rebalance and refit boxes and heights from index up to the root
+    void refitFrom(int index) {
+        while (index != NULL_NODE) {
+            index = balance(index);
+            Node& node = nodes[index];
+            node.height = 1 + std::max(nodes[node.child1].height, nodes[node.child2].height);
+            node.box = Union(nodes[node.child1].box, nodes[node.child2].box);
+            index = node.parent;
+        }
+    }
+
+    // Rotates the taller grandchild up if a's children differ in height by
+    // more than one. Returns the index of the subtree's new root.
+    int balance(int iA) {
+        Node& a = nodes[iA];
+        if (a.isLeaf() || a.height < 2) return iA;
+
+        int iB = a.child1;
+        int iC = a.child2;
+        int diff = nodes[iC].height - nodes[iB].height;
+        if (diff > 1) return rotateUp(iA, iC, iB, false);
+        if (diff < -1) return rotateUp(iA, iB, iC, true);
+        return iA;
+    }
+
+    // Makes child (iUp) the parent of iA; iOther is iA's remaining child.
+    // upIsChild1 tells which side of iA the promoted node came from.
+    int rotateUp(int iA, int iUp, int iOther, bool upIsChild1) {
+        Node& a = nodes[iA];
+        Node& up = nodes[iUp];
+        int iF = up.child1;
+        int iG = up.child2;
+
+        up.child1 = iA;
+        up.parent = a.parent;
+        a.parent = iUp;
+
+        if (up.parent == NULL_NODE) {
+            root = iUp;
+        } else if (nodes[up.parent].child1 == iA) {
+            nodes[up.parent].child1 = iUp;
+        } else {
+            nodes[up.parent].child2 = iUp;
+        }
+
+        // The taller grandchild stays with the promoted node, the other moves under a
+        int iKeep = nodes[iF].height > nodes[iG].height ? iF : iG;
+        int iMove = iKeep == iF ? iG : iF;
+        up.child2 = iKeep;
+        if (upIsChild1) {
+            a.child1 = iMove;
+        } else {
+            a.child2 = iMove;
+        }
+        nodes[iMove].parent = iA;
+
+        a.box = Union(nodes[iOther].box, nodes[iMove].box);
+        a.height = 1 + std::max(nodes[iOther].height, nodes[iMove].height);
+        up.box = Union(a.box, nodes[iKeep].box);
+        up.height = 1 + std::max(a.height, nodes[iKeep].height);
+        return iUp;
+    }
+
+    float padding;
+    float liveMargin;
+    std::vector<Node> nodes;
+    int freeList = NULL_NODE;
+    int root = NULL_NODE;
+    std::unordered_map<uint32_t, Entry> entries;
+};
+
+#endif // STROKE_BVH_H
@@ -0,0 +1,356 @@
+#ifndef STROKE_HISTORY_H
+#define STROKE_HISTORY_H
+
+#include <SFML/Graphics/Transform.hpp>
+#include <SFML/System/Vector2.hpp>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// Samples captured for a stroke: local-space points, the drawn width at each
+// point and the capture time in seconds since the stroke started. The three
+// vectors always have the same length.
+struct StrokeSamples {
+    std::vector<sf::Vector2f> points;
+    std::vector<float> widths;
+    std::vector<float> times;
+
+    size_t size() const { return points.size(); }
+
+    void push(sf::Vector2f point, float width, float time) {
+        points.push_back(point);
+        widths.push_back(width);
+        times.push_back(time);
+    }
+
+    void clear() {
+        points.clear();
+        widths.clear();
+        times.clear();
+    }
+};
+
+// Where a piece cut out of a stroke lies in it: piece sample k is the
+// stroke's sample offset + k, except a first or last sample interpolated
+// on a segment the cut went through
+struct PieceOrigin {
+    size_t offset = 0;
+    bool clippedStart = false;
+    bool clippedEnd = false;
+};
+
+// Shared by every version of a stroke that only differs in its transform
+using StrokeGeometry = std::shared_ptr<const StrokeSamples>;
+
+// A finished stroke. Strokes are never modified after they are committed,
+// so every version of the drawing can share the same geometry. Moving,
+// scaling or rotating a stroke makes a new version with a different
+// transform; the points are only rewritten when the transform is baked.
+struct Stroke {
+    uint32_t id = 0;
+    StrokeGeometry geometry;
+    sf::Transform transform;
+
+    const StrokeSamples& samples() const { return *geometry; }
+    const std::vector<sf::Vector2f>& points() const { return geometry->points; }
+    const std::vector<float>& widths() const { return geometry->widths; }
+    const std::vector<float>& times() const { return geometry->times; }
+    size_t size() const { return geometry->size(); }
+
+    // Point i in canvas coordinates
+    sf::Vector2f point(size_t i) const {
+        return transform.transformPoint(geometry->points[i]);
+    }
+
+    std::vector<sf::Vector2f> worldPoints() const {
+        std::vector<sf::Vector2f> world;
+        world.reserve(size());
+        for (const auto& p : points()) world.push_back(transform.transformPoint(p));
+        return world;
+    }
+};
+
+using StrokePtr = std::shared_ptr<const Stroke>;
+
+// Average scale factor of a transform, used to keep widths right when baking
+inline float TransformScale(const sf::Transform& transform) {
+    const float* m = transform.getMatrix();
+    return std::sqrt(std::abs(m[0] * m[5] - m[1] * m[4]));
+}
+
+// One cell of a persistent singly linked list of strokes (newest first).
+// Versions share their tails, so adding a stroke never copies the others.
+struct StrokeNode {
+    StrokePtr stroke;
+    mutable std::shared_ptr<const StrokeNode> next;
+    size_t count = 0;
+
+    ~StrokeNode() {
+        // Unlink iteratively so dropping a long list can't overflow the stack
+        std::shared_ptr<const StrokeNode> node = std::move(next);
+        while (node && node.use_count() == 1) {
+            node = std::move(node->next);
+        }
+    }
+};
+
+using StrokeList = std::shared_ptr<const StrokeNode>;
+
+inline size_t StrokeCount(const StrokeList& list) {
+    return list ? list->count : 0;
+}
+
+inline StrokeList PushStroke(const StrokeList& list, StrokePtr stroke) {
+    auto node = std::make_shared<StrokeNode>();
+    node->stroke = std::move(stroke);
+    node->next = list;
+    node->count = StrokeCount(list) + 1;
+    return node;
+}
+
+// Returns a version without the given strokes. Only the nodes in front of the
+// deepest removed stroke are rebuilt; the rest of the list stays shared.
+inline StrokeList RemoveStrokes(const StrokeList& list, const std::unordered_set<uint32_t>& ids) {
+    std::vector<const StrokeNode*> kept;
+    size_t found = 0;
+    const StrokeNode* node = list.get();
+    for (; node && found < ids.size(); node = node->next.get()) {
+        if (ids.count(node->stroke->id)) {
+            ++found;
+        } else {
+            kept.push_back(node);
+        }
+    }
+
+    // Share the untouched tail, then rebuild the kept nodes in front of it
+    StrokeList result = list;
+    while (result.get() != node) result = result->next;
+    for (auto it = kept.rbegin(); it != kept.rend(); ++it) {
+        result = PushStroke(result, (*it)->stroke);
+    }
+    return result;
+}
+
+// Strokes of a version in drawing order (oldest first)
+inline std::vector<StrokePtr> CollectStrokes(const StrokeList& list) {
+    std::vector<StrokePtr> strokes(StrokeCount(list));
+    size_t i = strokes.size();
+    for (const StrokeNode* node = list.get(); node; node = node->next.get()) {
+        strokes[--i] = node->stroke;
+    }
+    return strokes;
+}
+
+// What changed between two neighbouring versions, so caches can update
+// just the affected strokes instead of rebuilding everything
+struct StrokeDelta {
+    std::vector<StrokePtr> added;
+    std::vector<StrokePtr> removed;
+};
+
+// Memory held by the history, as reported by StrokeHistory::memoryUsage()
+struct HistoryMemory {
+    size_t entries = 0;
+    size_t strokes = 0;         // distinct strokes reachable from any version
+    size_t geometryBytes = 0;   // point, width and time data of those strokes
+    size_t overheadBytes = 0;   // list nodes, entries and delta bookkeeping
+};
+
+// Undo/redo stack over an append-only stroke log. Every edit produces a new
+// version that shares all untouched strokes with the previous one, so undo
+// and redo just move a cursor and never copy geometry.
+class StrokeHistory {
+public:
+    explicit StrokeHistory(size_t maxDepth = 256) : maxDepth(maxDepth) {
+        entries.push_back(Entry{});
+    }
+
+    const StrokeList& current() const {
+        return entries[cursor].version;
+    }
+
+    // Adds a finished stroke and returns it
+    StrokePtr commit(StrokeSamples samples) {
+        StrokePtr stroke = makeStroke(std::move(samples));
+
+        Entry entry;
+        entry.version = PushStroke(current(), stroke);
+        entry.change.added.push_back(stroke);
+        push(std::move(entry));
+        return stroke;
+    }
+
+    // Removes some strokes and adds new ones as a single edit (used by the
+    // eraser to split strokes). With merge, the change is folded into the
+    // previous edit so a whole eraser drag is undone in one step.
+    std::vector<StrokePtr> replace(const std::vector<StrokePtr>& removed, std::vector<StrokeSamples> added, bool merge) {
+        std::unordered_set<uint32_t> removedIds;
+        for (const auto& stroke : removed) removedIds.insert(stroke->id);
+
+        Entry entry;
+        entry.version = RemoveStrokes(current(), removedIds);
+        for (auto& samples : added) {
+            StrokePtr stroke = makeStroke(std::move(samples));
+            entry.version = PushStroke(entry.version, stroke);
+            entry.change.added.push_back(stroke);
+        }
+        return apply(std::move(entry), removed, std::move(removedIds), merge);
+    }
+
+    // Applies transform on top of the strokes' current transforms. The new
+    // versions share geometry with the old ones, so this costs the same for
+    // a 10-point stroke as for a 50k-point one.
+    std::vector<StrokePtr> retransform(const std::vector<StrokePtr>& strokes, const sf::Transform& transform, bool merge) {
+        std::unordered_set<uint32_t> removedIds;
+        for (const auto& stroke : strokes) removedIds.insert(stroke->id);
+
+        Entry entry;
+        entry.version = RemoveStrokes(current(), removedIds);
+        for (const auto& old : strokes) {
+            auto stroke = std::make_shared<Stroke>();
+            stroke->id = nextId++;
+            stroke->geometry = old->geometry;
+            stroke->transform = transform * old->transform;
+            entry.version = PushStroke(entry.version, stroke);
+            entry.change.added.push_back(stroke);
+        }
+        return apply(std::move(entry), strokes, std::move(removedIds), merge);
+    }
+
+    // Rewrites the strokes' points with their transforms applied. Widths are
+    // scaled by the transform's average scale so the strokes look the same.
+    std::vector<StrokePtr> bake(const std::vector<StrokePtr>& strokes) {
+        std::vector<StrokeSamples> baked;
+        for (const auto& stroke : strokes) {
+            float scale = TransformScale(stroke->transform);
+            StrokeSamples samples = stroke->samples();
+            samples.points = stroke->worldPoints();
+            for (auto& width : samples.widths) width *= scale;
+            baked.push_back(std::move(samples));
+        }
+        return replace(strokes, std::move(baked), false);
+    }
+
+    // Removes every stroke. Returns false if there was nothing to clear.
+    bool clear() {
+        if (!current()) return false;
+
+        Entry entry;
+        entry.change.removed = CollectStrokes(current());
+        push(std::move(entry));
+        return true;
+    }
+
+    bool canUndo() const { return cursor > 0; }
+    bool canRedo() const { return cursor + 1 < entries.size(); }
+
+    // Steps back one version; delta receives the strokes to add and remove
+    bool undo(StrokeDelta& delta) {
+        if (!canUndo()) return false;
+        const StrokeDelta& change = entries[cursor].change;
+        delta.added = change.removed;
+        delta.removed = change.added;
+        --cursor;
+        return true;
+    }
+
+    bool redo(StrokeDelta& delta) {
+        if (!canRedo()) return false;
+        ++cursor;
+        delta = entries[cursor].change;
+        return true;
+    }
+
+    HistoryMemory memoryUsage() const {
+        HistoryMemory usage;
+        usage.entries = entries.size();
+        usage.overheadBytes = entries.size() * sizeof(Entry);
+
+        std::unordered_set<const StrokeNode*> nodes;
+        std::unordered_set<const Stroke*> strokes;
+        std::unordered_set<const StrokeSamples*> geometries;
+        auto countStroke = [&](const StrokePtr& stroke) {
+            strokes.insert(stroke.get());
+            if (geometries.insert(stroke->geometry.get()).second) {
+                usage.geometryBytes += stroke->points().capacity() * sizeof(sf::Vector2f)
+                                     + (stroke->widths().capacity() + stroke->times().capacity()) * sizeof(float);
+            }
+        };
+
+        for (const auto& entry : entries) {
+            for (const StrokeNode* node = entry.version.get(); node; node = node->next.get()) {
+                if (!nodes.insert(node).second) break; // rest of the list is shared
+                countStroke(node->stroke);
+            }
+            for (const auto& stroke : entry.change.added) countStroke(stroke);
+            for (const auto& stroke : entry.change.removed) countStroke(stroke);
+            usage.overheadBytes += (entry.change.added.capacity() + entry.change.removed.capacity()) * sizeof(StrokePtr);
+        }
+
+        usage.strokes = strokes.size();
+        usage.overheadBytes += nodes.size() * sizeof(StrokeNode) + strokes.size() * sizeof(Stroke);
+        return usage;
+    }
+
+private:
+    struct Entry {
+        StrokeList version;
+        StrokeDelta change; // how this version differs from the one before it
+    };
+
+    StrokePtr makeStroke(StrokeSamples samples) {
+        auto stroke = std::make_shared<Stroke>();
+        stroke->id = nextId++;
+        stroke->geometry = std::make_shared<const StrokeSamples>(std::move(samples));
+        return stroke;
+    }
+
+    // Records an edit that removed some strokes and added entry.change.added
+    std::vector<StrokePtr> apply(Entry entry, const std::vector<StrokePtr>& removed, std::unordered_set<uint32_t> removedIds, bool merge) {
+        std::vector<StrokePtr> result = entry.change.added;
+
+        if (merge && canUndo() && !canRedo()) {
+            // Strokes both added and removed within the merged edit never existed before it
+            Entry& last = entries[cursor];
+            std::vector<StrokePtr> lastAdded;
+            for (const auto& stroke : last.change.added) {
+                if (!removedIds.count(stroke->id)) lastAdded.push_back(stroke);
+                else removedIds.erase(stroke->id);
+            }
+            for (const auto& stroke : removed) {
+                if (removedIds.count(stroke->id)) last.change.removed.push_back(stroke);
+            }
+            lastAdded.insert(lastAdded.end(), entry.change.added.begin(), entry.change.added.end());
+            last.change.added = std::move(lastAdded);
+            last.version = std::move(entry.version);
+        } else {
+            entry.change.removed = removed;
+            push(std::move(entry));
+        }
+        return result;
+    }
+
+    void push(Entry entry) {
+        // A new edit discards the redo branch
+        entries.erase(entries.begin() + cursor + 1, entries.end());
+        entries.push_back(std::move(entry));
+
+        // Keep memory bounded by forgetting the oldest versions
+        while (entries.size() > maxDepth + 1) {
+            entries.pop_front();
+        }
+        entries.front().change = StrokeDelta{};
+        cursor = entries.size() - 1;
+    }
+
+    std::deque<Entry> entries;
+    size_t cursor = 0;
+    size_t maxDepth;
+    uint32_t nextId = 1;
+};
+
+#endif // STROKE_HISTORY_H
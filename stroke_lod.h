@@ -0,0 +1,78 @@
+#ifndef STROKE_LOD_H
+#define STROKE_LOD_H
+
+#include <SFML/System/Vector2.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "stroke_history.h"
+
+// Level k of a stroke's detail pyramid deviates from the stroke by at most
+// LOD_BASE_TOLERANCE * 2^k units of its own geometry
+const float LOD_BASE_TOLERANCE = 0.5f;
+const int LOD_LEVELS = 10;
+
+// Coarsest level whose error stays under tolerance, or -1 for full detail
+inline int LodLevel(float tolerance) {
+    if (!(tolerance >= LOD_BASE_TOLERANCE)) return -1;
+    int level = static_cast<int>(std::floor(std::log2(tolerance / LOD_BASE_TOLERANCE)));
+    return std::min(level, LOD_LEVELS - 1);
+}
+
+inline float LodTolerance(int level) {
+    return std::ldexp(LOD_BASE_TOLERANCE, level);
+}
+
+// Douglas-Peucker: keeps the first and last sample and every sample needed so
+// that no dropped one lies further than tolerance from the simplified line.
+// Widths count too: a sample whose half width differs from the interpolated
+// one by more than tolerance is kept, so width changes survive.
+inline StrokeSamples SimplifySamples(const StrokeSamples& samples, float tolerance) {
+    size_t n = samples.size();
+    if (n <= 2) return samples;
+    const auto& points = samples.points;
+    const auto& widths = samples.widths;
+
+    std::vector<uint8_t> keep(n, 0);
+    keep[0] = keep[n - 1] = 1;
+    std::vector<std::pair<size_t, size_t>> spans{{0, n - 1}};
+    float toleranceSq = tolerance * tolerance;
+    while (!spans.empty()) {
+        auto [first, last] = spans.back();
+        spans.pop_back();
+        if (last <= first + 1) continue;
+
+        sf::Vector2f a = points[first], ab = points[last] - a;
+        float lengthSq = ab.x * ab.x + ab.y * ab.y;
+        float worst = -1.0f;
+        size_t worstIndex = first;
+        for (size_t i = first + 1; i < last; ++i) {
+            sf::Vector2f ap = points[i] - a;
+            float t = lengthSq > 0.0f ? std::clamp((ap.x * ab.x + ap.y * ab.y) / lengthSq, 0.0f, 1.0f) : 0.0f;
+            sf::Vector2f d = ap - ab * t;
+            float distanceSq = d.x * d.x + d.y * d.y;
+            float along = static_cast<float>(i - first) / (last - first);
+            float widthError = 0.5f * (widths[i] - (widths[first] + (widths[last] - widths[first]) * along));
+            float error = std::max(distanceSq, widthError * widthError);
+            if (error > worst) {
+                worst = error;
+                worstIndex = i;
+            }
+        }
+        if (worst > toleranceSq) {
+            keep[worstIndex] = 1;
+            spans.push_back({first, worstIndex});
+            spans.push_back({worstIndex, last});
+        }
+    }
+
+    StrokeSamples simplified;
+    for (size_t i = 0; i < n; ++i) {
+        if (keep[i]) simplified.push(points[i], widths[i], samples.times[i]);
+    }
+    return simplified;
+}
+
+#endif // STROKE_LOD_H
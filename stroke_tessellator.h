@@ -0,0 +1,340 @@
+#ifndef STROKE_TESSELLATOR_H
+#define STROKE_TESSELLATOR_H
+
+#include <SFML/Graphics/Color.hpp>
+#include <SFML/Graphics/Vertex.hpp>
+#include <SFML/System/Vector2.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "stroke_history.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define STROKE_TESSELLATOR_SSE2 1
+#endif
+
+enum class JoinStyle {
+    Miter,
+    Bevel,
+    Round
+};
+
+inline const char* JoinStyleName(JoinStyle join) {
+    switch (join) {
+        case JoinStyle::Miter: return "miter";
+        case JoinStyle::Bevel: return "bevel";
+        default: return "round";
+    }
+}
+
+struct StrokeStyle {
+    JoinStyle join = JoinStyle::Round;
+    bool roundCaps = true;
+    float miterLimit = 4.0f;    // longest miter, in half widths, before it falls back to a bevel
+    float tolerance = 0.25f;    // px the outline may deviate from the true curve
+};
+
+// Longest run of nearly collinear points merged into one segment
+const size_t TESSELLATOR_MAX_RUN = 16;
+// Most triangles spent on one round join or on half a cap
+const int TESSELLATOR_MAX_ARC_STEPS = 16;
+
+// Unit direction and length of the segments between consecutive points:
+// dirs[i] and lengths[i] describe points[i] -> points[i + 1]. Zero-length
+// segments get a zero direction. Four segments at a time with SSE2; the
+// scalar tail does the same operations, so both give identical results.
+inline void SegmentDirections(const sf::Vector2f* points, size_t count, sf::Vector2f* dirs, float* lengths) {
+    size_t segments = count > 1 ? count - 1 : 0;
+    size_t i = 0;
+#ifdef STROKE_TESSELLATOR_SSE2
+    const float* xy = reinterpret_cast<const float*>(points);
+    for (; i + 4 <= segments; i += 4) {
+        // Points i..i+4 as x0 y0 x1 y1 ...; deinterleave into x and y lanes
+        __m128 a = _mm_loadu_ps(xy + 2 * i);        // x0 y0 x1 y1
+        __m128 b = _mm_loadu_ps(xy + 2 * i + 4);    // x2 y2 x3 y3
+        __m128 c = _mm_loadu_ps(xy + 2 * i + 2);    // x1 y1 x2 y2
+        __m128 d = _mm_loadu_ps(xy + 2 * i + 6);    // x3 y3 x4 y4
+        __m128 x0 = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 y0 = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        __m128 x1 = _mm_shuffle_ps(c, d, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 y1 = _mm_shuffle_ps(c, d, _MM_SHUFFLE(3, 1, 3, 1));
+
+        __m128 dx = _mm_sub_ps(x1, x0);
+        __m128 dy = _mm_sub_ps(y1, y0);
+        __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)));
+        __m128 nonZero = _mm_cmpgt_ps(length, _mm_setzero_ps());
+        __m128 safe = _mm_or_ps(_mm_and_ps(nonZero, length), _mm_andnot_ps(nonZero, _mm_set1_ps(1.0f)));
+        dx = _mm_and_ps(nonZero, _mm_div_ps(dx, safe));
+        dy = _mm_and_ps(nonZero, _mm_div_ps(dy, safe));
+
+        // Interleave back into Vector2f pairs
+        float* out = reinterpret_cast<float*>(dirs + i);
+        _mm_storeu_ps(out, _mm_unpacklo_ps(dx, dy));
+        _mm_storeu_ps(out + 4, _mm_unpackhi_ps(dx, dy));
+        _mm_storeu_ps(lengths + i, length);
+    }
+#endif
+    for (; i < segments; ++i) {
+        float dx = points[i + 1].x - points[i].x;
+        float dy = points[i + 1].y - points[i].y;
+        float length = std::sqrt(dx * dx + dy * dy);
+        dirs[i] = length > 0.0f ? sf::Vector2f(dx / length, dy / length) : sf::Vector2f();
+        lengths[i] = length;
+    }
+}
+
+// Steps needed for an arc of angle radians so its chords stay within
+// tolerance of the circle
+inline int ArcSteps(float angle, float radius, float tolerance) {
+    if (radius <= tolerance) return 1;
+    float step = 2.0f * std::acos(1.0f - tolerance / radius);
+    return std::clamp(static_cast<int>(std::ceil(angle / step)), 1, TESSELLATOR_MAX_ARC_STEPS);
+}
+
+// Turns a variable-width polyline into one continuous triangle strip with
+// proper joins and caps. Nearly collinear points are merged first, so
+// straight runs cost two vertices and only curves get more; round joins and
+// caps are subdivided by the curvature tolerance.
+//
+// Points can be appended one at a time for the stroke being drawn. Only the
+// join before the new point and the end cap are rewritten, and append()
+// reports the first strip vertex that changed. Tessellating a whole stroke
+// gives exactly the same strip as appending its points one by one.
+class StrokeTessellator {
+public:
+    explicit StrokeTessellator(const StrokeStyle& style = StrokeStyle{}, sf::Color color = sf::Color::White)
+        : style(style), color(color) {}
+
+    void reset() {
+        kept.clear();
+        marks.clear();
+        vertices.clear();
+    }
+
+    // Takes in samples' last point; returns the first strip vertex that changed
+    size_t append(const StrokeSamples& samples) {
+        if (samples.size() == 0) return vertices.size();
+        AdvanceKept(kept, samples, samples.size() - 1, style.tolerance);
+        marks.resize(kept.size());
+
+        size_t m = kept.size();
+        if (m < 2) return vertices.size();
+
+        // The group before the new point (start cap or join) and the end cap change
+        sf::Vector2f points[3];
+        sf::Vector2f dirs[2];
+        float lengths[2];
+        size_t first = m >= 3 ? m - 3 : 0;
+        for (size_t j = first; j < m; ++j) points[j - first] = samples.points[kept[j]];
+        SegmentDirections(points, m - first, dirs, lengths);
+
+        size_t changed = marks[m - 2];
+        vertices.resize(changed);
+        if (m == 2) {
+            emitStart(samples, dirs[0]);
+        } else {
+            emitJoin(samples, m - 2, dirs[0], dirs[1], lengths[0], lengths[1]);
+        }
+        marks[m - 1] = vertices.size();
+        emitEnd(samples, dirs[m - first - 2]);
+        return changed;
+    }
+
+    // The whole stroke in one pass, with segment directions computed four at a time
+    const std::vector<sf::Vertex>& tessellate(const StrokeSamples& samples) {
+        reset();
+        for (size_t i = 0; i < samples.size(); ++i) AdvanceKept(kept, samples, i, style.tolerance);
+        marks.resize(kept.size());
+        size_t m = kept.size();
+        if (m < 2) return vertices;
+
+        std::vector<sf::Vector2f> points(m);
+        for (size_t j = 0; j < m; ++j) points[j] = samples.points[kept[j]];
+        std::vector<sf::Vector2f> dirs(m - 1);
+        std::vector<float> lengths(m - 1);
+        SegmentDirections(points.data(), m, dirs.data(), lengths.data());
+
+        marks[0] = 0;
+        emitStart(samples, dirs[0]);
+        for (size_t j = 1; j + 1 < m; ++j) {
+            marks[j] = vertices.size();
+            emitJoin(samples, j, dirs[j - 1], dirs[j], lengths[j - 1], lengths[j]);
+        }
+        marks[m - 1] = vertices.size();
+        emitEnd(samples, dirs[m - 2]);
+        return vertices;
+    }
+
+    // Only the caps and joins of kept points [first, last), for a stroke
+    // whose kept points are given instead of found. Each comes out exactly
+    // as tessellate() emits it, so a stroke cut in two can keep its strip
+    // and redo just the joins next to the cut. Marks count from first's.
+    const std::vector<sf::Vertex>& tessellateKept(const StrokeSamples& samples, std::vector<uint32_t> keptPoints, size_t first, size_t last) {
+        kept = std::move(keptPoints);
+        marks.assign(kept.size(), 0);
+        vertices.clear();
+        size_t m = kept.size();
+        if (m < 2 || first >= last) return vertices;
+
+        // Directions of the segments on either side of the points emitted
+        size_t from = first > 0 ? first - 1 : 0, to = std::min(last, m - 1);
+        std::vector<sf::Vector2f> points(to - from + 1);
+        for (size_t j = from; j <= to; ++j) points[j - from] = samples.points[kept[j]];
+        std::vector<sf::Vector2f> dirs(points.size() - 1);
+        std::vector<float> lengths(points.size() - 1);
+        SegmentDirections(points.data(), points.size(), dirs.data(), lengths.data());
+
+        for (size_t j = first; j < last; ++j) {
+            marks[j] = vertices.size();
+            if (j == 0) {
+                emitStart(samples, dirs[0]);
+            } else if (j == m - 1) {
+                emitEnd(samples, dirs[j - 1 - from]);
+            } else {
+                emitJoin(samples, j, dirs[j - 1 - from], dirs[j - from], lengths[j - 1 - from], lengths[j - from]);
+            }
+        }
+        return vertices;
+    }
+
+    const std::vector<sf::Vertex>& strip() const { return vertices; }
+    size_t keptPoints() const { return kept.size(); }
+    // Sample index of each kept point, and the first strip vertex of its cap or join
+    const std::vector<uint32_t>& keptIndices() const { return kept; }
+    const std::vector<size_t>& keptMarks() const { return marks; }
+
+    // Adds sample i to the kept points, first dropping the previous kept
+    // point if it (and the run merged into it) lies within tolerance of the
+    // chord that skips it and its width is close enough to interpolate
+    static void AdvanceKept(std::vector<uint32_t>& kept, const StrokeSamples& samples, size_t i, float tolerance) {
+        if (kept.size() >= 2 && i - kept[kept.size() - 2] <= TESSELLATOR_MAX_RUN) {
+            size_t a = kept[kept.size() - 2];
+            sf::Vector2f pa = samples.points[a], pq = samples.points[i];
+            float wa = samples.widths[a], wq = samples.widths[i];
+            sf::Vector2f chord = pq - pa;
+            float chordLengthSq = chord.x * chord.x + chord.y * chord.y;
+            bool droppable = chordLengthSq > 0.0f;
+            for (size_t k = a + 1; k < i && droppable; ++k) {
+                sf::Vector2f v = samples.points[k] - pa;
+                float t = (v.x * chord.x + v.y * chord.y) / chordLengthSq;
+                float cross = v.x * chord.y - v.y * chord.x;
+                float deviation = std::abs(cross) / std::sqrt(chordLengthSq);
+                float width = wa + (wq - wa) * std::clamp(t, 0.0f, 1.0f);
+                droppable = t > 0.0f && t < 1.0f && deviation <= tolerance
+                         && std::abs(samples.widths[k] - width) <= tolerance;
+            }
+            if (droppable) {
+                kept.back() = static_cast<uint32_t>(i);
+                return;
+            }
+        }
+        kept.push_back(static_cast<uint32_t>(i));
+    }
+
+private:
+    static sf::Vector2f normalOf(sf::Vector2f d) { return sf::Vector2f(-d.y, d.x); }
+
+    void pair(sf::Vector2f left, sf::Vector2f right) {
+        vertices.push_back(sf::Vertex{left, color});
+        vertices.push_back(sf::Vertex{right, color});
+    }
+
+    float radiusAt(const StrokeSamples& samples, size_t j) const {
+        return samples.widths[kept[j]] / 2.0f;
+    }
+
+    // Half disc behind the first point, or a flat end
+    void emitStart(const StrokeSamples& samples, sf::Vector2f d) {
+        sf::Vector2f p = samples.points[kept[0]];
+        float r = radiusAt(samples, 0);
+        sf::Vector2f n = normalOf(d);
+        int steps = style.roundCaps ? ArcSteps(3.14159265f / 2.0f, r, style.tolerance) : 0;
+        for (int k = steps; k >= 0; --k) {
+            float phi = 3.14159265f / 2.0f * k / std::max(steps, 1);
+            float c = std::cos(phi), s = std::sin(phi);
+            pair(p + (n * c - d * s) * r, p + (-n * c - d * s) * r);
+        }
+    }
+
+    void emitEnd(const StrokeSamples& samples, sf::Vector2f d) {
+        size_t j = kept.size() - 1;
+        sf::Vector2f p = samples.points[kept[j]];
+        float r = radiusAt(samples, j);
+        sf::Vector2f n = normalOf(d);
+        int steps = style.roundCaps ? ArcSteps(3.14159265f / 2.0f, r, style.tolerance) : 0;
+        for (int k = 0; k <= steps; ++k) {
+            float phi = 3.14159265f / 2.0f * k / std::max(steps, 1);
+            float c = std::cos(phi), s = std::sin(phi);
+            pair(p + (n * c + d * s) * r, p + (-n * c + d * s) * r);
+        }
+    }
+
+    void emitJoin(const StrokeSamples& samples, size_t j, sf::Vector2f d0, sf::Vector2f d1, float length0, float length1) {
+        sf::Vector2f p = samples.points[kept[j]];
+        float r = radiusAt(samples, j);
+        if (d0 == sf::Vector2f()) d0 = d1;
+        if (d1 == sf::Vector2f()) d1 = d0;
+        sf::Vector2f n0 = normalOf(d0), n1 = normalOf(d1);
+
+        float cross = d0.x * d1.y - d0.y * d1.x;
+        float dot = d0.x * d1.x + d0.y * d1.y;
+        if (std::abs(cross) < 1e-4f && dot > 0.0f) {
+            pair(p + n1 * r, p - n1 * r);
+            return;
+        }
+
+        // The inner side of the turn meets at the miter point, pulled in so
+        // short segments next to a sharp turn don't fold over
+        sf::Vector2f t = n0 + n1;
+        float tLength = std::sqrt(t.x * t.x + t.y * t.y);
+        t = tLength > 1e-6f ? t / tLength : d0;
+        float cosHalf = std::max(t.x * n0.x + t.y * n0.y, 1e-3f);
+        float miterLength = r / cosHalf;
+        float innerLength = std::min({miterLength, r * style.miterLimit, std::max(std::min(length0, length1), r)});
+
+        bool leftInner = cross > 0.0f; // turning towards +normal
+        float side = leftInner ? 1.0f : -1.0f;
+        sf::Vector2f inner = p + t * (innerLength * side);
+        auto emitOuter = [&](sf::Vector2f outer) {
+            if (leftInner) pair(inner, outer);
+            else pair(outer, inner);
+        };
+
+        JoinStyle join = style.join;
+        if (join == JoinStyle::Miter && miterLength > r * style.miterLimit) join = JoinStyle::Bevel;
+
+        if (join == JoinStyle::Miter) {
+            emitOuter(p - t * (miterLength * side));
+        } else if (join == JoinStyle::Bevel) {
+            emitOuter(p - n0 * (r * side));
+            emitOuter(p - n1 * (r * side));
+        } else {
+            // Arc on the outer side from the incoming to the outgoing normal
+            float angle = std::acos(std::clamp(dot, -1.0f, 1.0f));
+            int steps = ArcSteps(angle, r, style.tolerance);
+            sf::Vector2f from = -n0 * side;
+            float turn = leftInner ? angle : -angle; // direction from -n0 towards -n1
+            for (int k = 0; k <= steps; ++k) {
+                float a = turn * k / steps;
+                float c = std::cos(a), s = std::sin(a);
+                sf::Vector2f offset(from.x * c - from.y * s, from.x * s + from.y * c);
+                emitOuter(p + offset * r);
+            }
+        }
+    }
+
+    StrokeStyle style;
+    sf::Color color;
+    std::vector<uint32_t> kept;     // indices of the samples that made it into the outline
+    std::vector<size_t> marks;      // first strip vertex of each kept point's cap or join
+    std::vector<sf::Vertex> vertices;
+};
+
+inline std::vector<sf::Vertex> TessellateStroke(const StrokeSamples& samples, const StrokeStyle& style, sf::Color color) {
+    StrokeTessellator tessellator(style, color);
+    return tessellator.tessellate(samples);
+}
+
+#endif // STROKE_TESSELLATOR_H
@@ -0,0 +1,55 @@
+#ifndef STROKE_WIDTH_H
+#define STROKE_WIDTH_H
+
+#include <SFML/System/Vector2.hpp>
+#include <algorithm>
+#include <cmath>
+
+// Maps drawing speed to line width: slow sections are drawn at maxWidth and
+// fast ones at minWidth, like ink pooling under a slow pen
+struct WidthCurve {
+    const char* name;
+    float minWidth;
+    float maxWidth;
+    float slowSpeed;    // px/s at or below which the width is maxWidth
+    float fastSpeed;    // px/s at or above which the width is minWidth
+    float exponent;     // 1 is linear; below 1 thins out quickly, above 1 holds the width longer
+    float smoothing;    // 0..1 weight of the previous speed estimate
+};
+
+inline float WidthForSpeed(const WidthCurve& curve, float speed) {
+    if (curve.fastSpeed <= curve.slowSpeed) return curve.maxWidth;
+    float t = std::clamp((speed - curve.slowSpeed) / (curve.fastSpeed - curve.slowSpeed), 0.0f, 1.0f);
+    t = std::pow(t, curve.exponent);
+    return curve.maxWidth + (curve.minWidth - curve.maxWidth) * t;
+}
+
+// Turns capture timestamps into per-point widths for the stroke being drawn.
+// Speed is smoothed so a single jittery mouse sample doesn't pinch the line.
+class WidthTracker {
+public:
+    void reset() {
+        hasPoint = false;
+        speed = 0.0f;
+    }
+
+    float next(const WidthCurve& curve, sf::Vector2f point, float time) {
+        if (hasPoint && time > lastTime) {
+            sf::Vector2f d = point - lastPoint;
+            float sampleSpeed = std::sqrt(d.x * d.x + d.y * d.y) / (time - lastTime);
+            speed = curve.smoothing * speed + (1.0f - curve.smoothing) * sampleSpeed;
+        }
+        hasPoint = true;
+        lastPoint = point;
+        lastTime = time;
+        return WidthForSpeed(curve, speed);
+    }
+
+private:
+    bool hasPoint = false;
+    sf::Vector2f lastPoint;
+    float lastTime = 0.0f;
+    float speed = 0.0f;
+};
+
+#endif // STROKE_WIDTH_H
@@ -0,0 +1,132 @@
+// Timing test for animated icon moves against the simulated desktop, so it runs
+// without Explorer. Build like the app, e.g.
+//   g++ -std=c++17 -O2 test_animation.cpp -lsfml-graphics -lsfml-system
+// Returns non-zero if any check fails.
+#include <SFML/System/Clock.hpp>
+#include <SFML/System/Sleep.hpp>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include "icon_animation.h"
+
+static int failures = 0;
+
+static void check(bool ok, const std::string& what) {
+    std::cout << (ok ? "  ok    " : "  FAIL  ") << what << std::endl;
+    if (!ok) ++failures;
+}
+
+static float ms(sf::Time t) { return t.asSeconds() * 1000.0f; }
+
+struct RunResult {
+    sf::Time elapsed;
+    bool onTarget = true;
+    bool monotonic = true; // no icon ever moved away from its target
+};
+
+// Animates every icon of the desktop to a random spot, sleeping between ticks
+// like the app's frame loop would, and checks every icon's progress after each tick
+static RunResult animate(SimulatedDesktop& desktop, IconAnimator& animator, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> x(0, 1800), y(0, 1000);
+    std::vector<IconTransition> transitions;
+    for (const IconRecord& icon : desktop.icons()) transitions.push_back(IconTransition{icon.index, icon.position, sf::Vector2i(x(rng), y(rng))});
+
+    auto distance = [](sf::Vector2i a, sf::Vector2i b) { return std::hypot(float(a.x - b.x), float(a.y - b.y)); };
+    std::vector<float> remaining;
+    for (const auto& t : transitions) remaining.push_back(distance(t.from, t.to));
+
+    RunResult result;
+    sf::Clock clock;
+    animator.start(transitions, clock.getElapsedTime());
+    while (animator.update(clock.getElapsedTime())) {
+        std::vector<IconRecord> icons = desktop.icons();
+        for (size_t i = 0; i < transitions.size(); ++i) {
+            float d = distance(icons[transitions[i].index].position, transitions[i].to);
+            if (d > remaining[i] + 1.5f) result.monotonic = false; // rounding may wobble a pixel
+            remaining[i] = std::min(remaining[i], d);
+        }
+        sf::Time wait = animator.nextTick() - clock.getElapsedTime();
+        if (wait > sf::Time::Zero) sf::sleep(wait);
+    }
+    result.elapsed = clock.getElapsedTime();
+
+    std::vector<IconRecord> icons = desktop.icons();
+    for (const auto& t : transitions) {
+        if (icons[t.index].position != t.to) result.onTarget = false;
+    }
+    return result;
+}
+
+static void report(const IconAnimator& animator, const RunResult& run) {
+    const AnimationStats& stats = animator.stats();
+    std::cout << "  " << ms(run.elapsed) << " ms, " << stats.ticks << " ticks, " << stats.moves << " moves, "
+              << ms(stats.ipcTime) << " ms in moves (worst tick " << ms(stats.worstTick) << " ms), "
+              << animator.tickRate() << " ticks/s, " << ms(animator.moveCostEstimate()) * 1000.0f << " us/move" << std::endl;
+}
+
+int main() {
+    std::cout << "Easing" << std::endl;
+    for (Easing easing : {Easing::Linear, Easing::EaseOutCubic, Easing::EaseInOutCubic}) {
+        bool ordered = true;
+        for (int i = 1; i <= 100; ++i) ordered = ordered && Ease(easing, i / 100.0f) >= Ease(easing, (i - 1) / 100.0f);
+        check(Ease(easing, 0.0f) == 0.0f && std::abs(Ease(easing, 1.0f) - 1.0f) < 1e-6f && ordered, "starts at 0, ends at 1, never goes back");
+    }
+
+    AnimationSettings settings;
+    settings.duration = sf::milliseconds(500);
+    sf::Time slack = sf::milliseconds(40); // sleep granularity and scheduling
+
+    std::cout << "Cheap moves: 100 icons, 20 us per move" << std::endl;
+    {
+        SimulatedDesktop desktop = SimulatedDesktop::grid(100);
+        desktop.setMoveLatency(sf::microseconds(20));
+        IconAnimator animator(desktop, settings);
+        RunResult run = animate(desktop, animator, 1);
+        report(animator, run);
+        check(run.onTarget, "every icon ends on its target");
+        check(run.monotonic, "icons only ever get closer to their targets");
+        check(run.elapsed <= settings.duration + sf::seconds(2.0f / settings.maxTickRate) + slack, "done within the duration plus a tick");
+        check(animator.tickRate() >= settings.maxTickRate * 0.9f, "ticks at the maximum rate");
+        check(animator.stats().ticks >= settings.duration.asSeconds() * settings.maxTickRate * 0.7f, "smooth: a tick every frame");
+        check(animator.stats().ticksOverBudget == 0, "no tick over the budget");
+    }
+
+    std::cout << "Expensive moves: 2000 icons, 100 us per move" << std::endl;
+    {
+        sf::Time latency = sf::microseconds(100);
+        SimulatedDesktop desktop = SimulatedDesktop::grid(2000);
+        desktop.setMoveLatency(latency);
+        IconAnimator animator(desktop, settings);
+        RunResult run = animate(desktop, animator, 2);
+        report(animator, run);
+        const AnimationStats& stats = animator.stats();
+        check(run.onTarget, "every icon ends on its target");
+        check(run.monotonic, "icons only ever get closer to their targets");
+        // A tick preempted by the OS may overrun now and then
+        check(stats.ticksOverBudget <= stats.ticks / 5, "ticks keep within the budget");
+        check(animator.tickRate() < settings.maxTickRate * 0.75f, "tick rate drops for expensive moves");
+        float cost = animator.moveCostEstimate() / latency;
+        check(cost > 0.8f && cost < 2.0f, "measured move cost matches the desktop's");
+        check(stats.ipcTime / run.elapsed <= settings.dutyCycle + 0.1f, "desktop left idle most of the time");
+        // After the duration the icons still lagging get sent in full batches,
+        // each followed by the idle time the duty cycle asks for
+        sf::Time flush = animator.moveCostEstimate() * 2000.0f / settings.dutyCycle;
+        sf::Time bound = settings.duration + flush * 1.25f + slack;
+        check(run.elapsed <= bound, "done within the duration plus one flush (" + std::to_string(ms(bound)) + " ms)");
+    }
+
+    std::cout << "Zero duration: straight to the targets" << std::endl;
+    {
+        SimulatedDesktop desktop = SimulatedDesktop::grid(50);
+        AnimationSettings instant = settings;
+        instant.duration = sf::Time::Zero;
+        IconAnimator animator(desktop, instant);
+        RunResult run = animate(desktop, animator, 3);
+        check(run.onTarget && animator.stats().moves == 50, "each icon moved once, to its target");
+        check(run.elapsed < sf::milliseconds(100), "done in a few ticks");
+    }
+
+    std::cout << (failures ? "FAILED: " + std::to_string(failures) + " checks" : std::string("All checks passed")) << std::endl;
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,287 @@
+#ifndef TEXT_OUTLINE_H
+#define TEXT_OUTLINE_H
+
+#include <SFML/Graphics/Font.hpp>
+#include <SFML/Graphics/Image.hpp>
+#include <SFML/Graphics/Rect.hpp>
+#include <SFML/System/Vector2.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "layout.h"
+
+// Outlines of where coverage >= threshold in a width x height bitmap, by
+// marching squares: closed loops through the pixel centres, placed between
+// two pixels by their coverage so edges land at sub-pixel precision. The
+// bitmap is treated as surrounded by empty pixels, so every loop closes.
+// Where a cell's corners alternate, its average decides whether the two
+// covered corners connect.
+inline std::vector<std::vector<sf::Vector2f>> TraceContours(const uint8_t* coverage, unsigned width, unsigned height, size_t stride,
+                                                            uint8_t threshold = 128) {
+    // Corners are the pixels plus a border of empty ones
+    const int cw = static_cast<int>(width) + 2, ch = static_cast<int>(height) + 2;
+    auto value = [&](int x, int y) -> int {
+        if (x < 1 || y < 1 || x > static_cast<int>(width) || y > static_cast<int>(height)) return 0;
+        return coverage[static_cast<size_t>(y - 1) * stride + (x - 1)];
+    };
+    // Edge ids: 2 * corner for the edge to the right, 2 * corner + 1 for the one below
+    auto horizontal = [&](int x, int y) { return 2 * (y * cw + x); };
+    auto vertical = [&](int x, int y) { return 2 * (y * cw + x) + 1; };
+    auto crossing = [&](int edge) {
+        int corner = edge / 2, x = corner % cw, y = corner / cw;
+        int x2 = edge % 2 ? x : x + 1, y2 = edge % 2 ? y + 1 : y;
+        float a = static_cast<float>(value(x, y)), b = static_cast<float>(value(x2, y2));
+        float t = (threshold - a) / (b - a);
+        return sf::Vector2f(x - 0.5f + (x2 - x) * t, y - 0.5f + (y2 - y) * t);
+    };
+
+    // Each cell links the edge where its boundary, walked clockwise, leaves
+    // the covered region to the edge where it comes back in. A shared edge is
+    // walked the other way by the neighbouring cell, so the links chain up.
+    std::vector<int> next(static_cast<size_t>(cw) * ch * 2, -1);
+    for (int y = 0; y + 1 < ch; ++y) {
+        for (int x = 0; x + 1 < cw; ++x) {
+            bool in[4] = {value(x, y) >= threshold, value(x + 1, y) >= threshold,
+                          value(x + 1, y + 1) >= threshold, value(x, y + 1) >= threshold};
+            if (in[0] == in[1] && in[1] == in[2] && in[2] == in[3]) continue;
+            int edges[4] = {horizontal(x, y), vertical(x + 1, y), horizontal(x, y + 1), vertical(x, y)};
+            bool saddle = in[0] == in[2] && in[1] == in[3];
+            bool centre = (value(x, y) + value(x + 1, y) + value(x + 1, y + 1) + value(x, y + 1)) >= 4 * threshold;
+            for (int i = 0; i < 4; ++i) {
+                if (!in[i] || in[(i + 1) % 4]) continue;
+                // Leaving at edge i; back in at the next edge, or on a saddle
+                // whose centre is empty, the previous one
+                int back = (i + 1) % 4;
+                if (saddle && !centre) back = (i + 3) % 4;
+                else while (!(!in[back] && in[(back + 1) % 4])) back = (back + 1) % 4;
+                next[edges[i]] = edges[back];
+            }
+        }
+    }
+
+    std::vector<std::vector<sf::Vector2f>> loops;
+    for (size_t start = 0; start < next.size(); ++start) {
+        if (next[start] < 0) continue;
+        std::vector<sf::Vector2f> loop;
+        for (int edge = static_cast<int>(start); next[edge] >= 0;) {
+            loop.push_back(crossing(edge));
+            int following = next[edge];
+            next[edge] = -1;
+            edge = following;
+        }
+        if (loop.size() >= 3) loops.push_back(std::move(loop));
+    }
+    return loops;
+}
+
+// Ramer-Douglas-Peucker on an open polyline: keeps the ends and every point
+// further than tolerance from the simplified line
+inline void SimplifyPolyline(const std::vector<sf::Vector2f>& points, size_t first, size_t last, float tolerance, std::vector<sf::Vector2f>& out) {
+    float worst = 0.0f;
+    size_t index = first;
+    sf::Vector2f a = points[first], d = points[last] - a;
+    float length = std::sqrt(d.x * d.x + d.y * d.y);
+    for (size_t i = first + 1; i < last; ++i) {
+        sf::Vector2f p = points[i] - a;
+        float distance = length > 0.0f ? std::abs(d.x * p.y - d.y * p.x) / length : std::sqrt(p.x * p.x + p.y * p.y);
+        if (distance > worst) {
+            worst = distance;
+            index = i;
+        }
+    }
+    if (worst > tolerance) {
+        SimplifyPolyline(points, first, index, tolerance, out);
+        SimplifyPolyline(points, index, last, tolerance, out);
+    } else {
+        out.push_back(points[last]);
+    }
+}
+
+// A closed loop simplified the same way, split at the point furthest from its
+// first one; the result ends on its first point again
+inline std::vector<sf::Vector2f> SimplifyLoop(const std::vector<sf::Vector2f>& loop, float tolerance) {
+    if (loop.size() < 4) {
+        std::vector<sf::Vector2f> closed = loop;
+        if (!closed.empty()) closed.push_back(closed.front());
+        return closed;
+    }
+    size_t far = 0;
+    float farthest = 0.0f;
+    for (size_t i = 1; i < loop.size(); ++i) {
+        sf::Vector2f d = loop[i] - loop[0];
+        if (d.x * d.x + d.y * d.y > farthest) {
+            farthest = d.x * d.x + d.y * d.y;
+            far = i;
+        }
+    }
+    std::vector<sf::Vector2f> points = loop;
+    points.push_back(loop.front());
+    std::vector<sf::Vector2f> out{points.front()};
+    SimplifyPolyline(points, 0, far, tolerance, out);
+    SimplifyPolyline(points, far, points.size() - 1, tolerance, out);
+    return out;
+}
+
+// A character's outline in pixels at the size it was traced, relative to the
+// pen on the baseline; each loop ends on its first point
+struct GlyphOutline {
+    float advance = 0.0f;
+    std::vector<std::vector<sf::Vector2f>> loops;
+};
+
+// Glyph outlines traced once per font, character size and character.
+// sf::Font has FreeType render each glyph into its texture; reading the
+// texture back is the slow part, so all glyphs a text still needs share one read.
+class GlyphOutlineCache {
+public:
+    // Glyphs are traced this far apart from their coverage; under a pixel
+    // keeps curves round once scaled up
+    static constexpr float TOLERANCE = 0.35f;
+
+    const GlyphOutline& glyph(const sf::Font& font, unsigned size, char32_t c) {
+        prepare(font, size, std::u32string(1, c));
+        return outlines[std::make_tuple(&font, size, c)];
+    }
+
+    void prepare(const sf::Font& font, unsigned size, const std::u32string& text) {
+        std::vector<char32_t> missing;
+        for (char32_t c : text) {
+            if (c == U'\n' || outlines.count(std::make_tuple(&font, size, c))) continue;
+            if (std::find(missing.begin(), missing.end(), c) == missing.end()) missing.push_back(c);
+        }
+        if (missing.empty()) return;
+
+        std::vector<sf::Glyph> rendered;
+        for (char32_t c : missing) rendered.push_back(font.getGlyph(c, size, false));
+        sf::Image page = font.getTexture(size).copyToImage();
+        const uint8_t* pixels = page.getPixelsPtr();
+        size_t pageWidth = page.getSize().x;
+
+        std::vector<uint8_t> coverage;
+        for (size_t i = 0; i < missing.size(); ++i) {
+            const sf::Glyph& glyph = rendered[i];
+            GlyphOutline& outline = outlines[std::make_tuple(&font, size, missing[i])];
+            outline.advance = glyph.advance;
+            sf::IntRect rect = glyph.textureRect;
+            if (rect.size.x <= 0 || rect.size.y <= 0 || !pixels) continue;
+
+            // The page is white with the coverage in alpha
+            coverage.resize(static_cast<size_t>(rect.size.x) * rect.size.y);
+            for (int y = 0; y < rect.size.y; ++y) {
+                for (int x = 0; x < rect.size.x; ++x) {
+                    coverage[static_cast<size_t>(y) * rect.size.x + x] = pixels[((rect.position.y + y) * pageWidth + rect.position.x + x) * 4 + 3];
+                }
+            }
+            sf::Vector2f scale(glyph.bounds.size.x / rect.size.x, glyph.bounds.size.y / rect.size.y);
+            for (auto& loop : TraceContours(coverage.data(), rect.size.x, rect.size.y, rect.size.x)) {
+                std::vector<sf::Vector2f> simplified = SimplifyLoop(loop, TOLERANCE);
+                for (auto& p : simplified) p = glyph.bounds.position + sf::Vector2f(p.x * scale.x, p.y * scale.y);
+                outline.loops.push_back(std::move(simplified));
+            }
+        }
+    }
+
+    size_t glyphCount() const { return outlines.size(); }
+    void clear() { outlines.clear(); }
+
+private:
+    std::map<std::tuple<const sf::Font*, unsigned, char32_t>, GlyphOutline> outlines;
+};
+
+// The outlines of a text, lines split at '\n' and each centred, scaled to fit
+// inside box and centred in it. Glyphs are traced at size pixels; bigger
+// sizes give finer outlines and cost more the first time a character is used.
+inline std::vector<std::vector<sf::Vector2f>> TextLoops(GlyphOutlineCache& cache, const sf::Font& font, const std::u32string& text,
+                                                        sf::FloatRect box, unsigned size = 96) {
+    cache.prepare(font, size, text);
+    std::vector<std::vector<sf::Vector2f>> loops;
+    std::vector<size_t> lineStarts{0};
+    std::vector<float> lineWidths;
+    float pen = 0.0f, baseline = 0.0f, lineSpacing = font.getLineSpacing(size);
+    char32_t previous = 0;
+    for (char32_t c : text) {
+        if (c == U'\n') {
+            lineWidths.push_back(pen);
+            lineStarts.push_back(loops.size());
+            pen = 0.0f;
+            baseline += lineSpacing;
+            previous = 0;
+            continue;
+        }
+        if (previous) pen += font.getKerning(previous, c, size);
+        const GlyphOutline& glyph = cache.glyph(font, size, c);
+        for (const auto& loop : glyph.loops) {
+            loops.push_back(loop);
+            for (auto& p : loops.back()) p += sf::Vector2f(pen, baseline);
+        }
+        pen += glyph.advance;
+        previous = c;
+    }
+    lineWidths.push_back(pen);
+    lineStarts.push_back(loops.size());
+
+    // Centre each line, then fit the whole block into the box
+    float widest = *std::max_element(lineWidths.begin(), lineWidths.end());
+    for (size_t line = 0; line + 1 < lineStarts.size(); ++line) {
+        float shift = (widest - lineWidths[line]) / 2.0f;
+        for (size_t i = lineStarts[line]; i < lineStarts[line + 1]; ++i) {
+            for (auto& p : loops[i]) p.x += shift;
+        }
+    }
+    float left = INFINITY, top = INFINITY, right = -INFINITY, bottom = -INFINITY;
+    for (const auto& loop : loops) {
+        for (sf::Vector2f p : loop) {
+            left = std::min(left, p.x);
+            right = std::max(right, p.x);
+            top = std::min(top, p.y);
+            bottom = std::max(bottom, p.y);
+        }
+    }
+    if (loops.empty() || right <= left || bottom <= top) return {};
+    float scale = std::min(box.size.x / (right - left), box.size.y / (bottom - top));
+    sf::Vector2f offset = box.position + (box.size - sf::Vector2f(right - left, bottom - top) * scale) / 2.0f;
+    for (auto& loop : loops) {
+        for (auto& p : loop) p = offset + (p - sf::Vector2f(left, top)) * scale;
+    }
+    return loops;
+}
+
+// Icons spelling out a text along its glyph outlines. The loops are kept
+// with their running lengths, so only a change of text, font or box traces
+// anything again; placing icons is then the same path layout strokes use.
+class TextLayout {
+public:
+    void set(const sf::Font& font, const std::u32string& newText, sf::FloatRect newBox) {
+        if (&font == currentFont && newText == text && newBox == box) return;
+        currentFont = &font;
+        text = newText;
+        box = newBox;
+        progress.clear();
+        for (const auto& loop : TextLoops(cache, font, text, box)) {
+            progress.push_back(MakeProgress(loop, std::vector<float>(loop.size(), 0.0f)));
+        }
+    }
+
+    std::vector<sf::Vector2f> place(int count) const {
+        std::vector<const StrokeProgress*> loops;
+        for (const auto& loop : progress) loops.push_back(&loop);
+        return PlaceAroundLoops(loops, count);
+    }
+
+    bool empty() const { return progress.empty(); }
+    size_t loopCount() const { return progress.size(); }
+    const GlyphOutlineCache& glyphs() const { return cache; }
+
+private:
+    GlyphOutlineCache cache;
+    const sf::Font* currentFont = nullptr;
+    std::u32string text;
+    sf::FloatRect box;
+    std::vector<StrokeProgress> progress;
+};
+
+#endif // TEXT_OUTLINE_H
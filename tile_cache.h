@@ -0,0 +1,283 @@
+#ifndef TILE_CACHE_H
+#define TILE_CACHE_H
+
+#include <SFML/Graphics/RectangleShape.hpp>
+#include <SFML/Graphics/RenderTexture.hpp>
+#include <SFML/Graphics/Sprite.hpp>
+#include <SFML/Graphics/View.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <list>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "stroke_batch.h"
+#include "stroke_bvh.h"
+
+// Pixels along a tile's side
+const unsigned TILE_SIZE = 256;
+const size_t TILE_BYTES = static_cast<size_t>(TILE_SIZE) * TILE_SIZE * 4;
+// Zoom levels tiles are rendered at, as powers of two
+const int MIN_TILE_LEVEL = -8;
+const int MAX_TILE_LEVEL = 8;
+
+// A tile at zoom level L covers TILE_SIZE / 2^L canvas units
+struct TileKey {
+    int level, x, y;
+    bool operator==(const TileKey& other) const { return level == other.level && x == other.x && y == other.y; }
+};
+
+struct TileKeyHash {
+    size_t operator()(const TileKey& key) const {
+        uint64_t packed = (static_cast<uint64_t>(static_cast<uint32_t>(key.x)) << 32) ^ static_cast<uint32_t>(key.y);
+        return std::hash<uint64_t>()(packed * 31 + static_cast<uint64_t>(key.level + 64));
+    }
+};
+
+// Level whose tiles are closest to one texel per screen pixel
+inline int TileLevel(float pixelsPerUnit) {
+    int level = static_cast<int>(std::lround(std::log2(std::max(pixelsPerUnit, 1e-6f))));
+    return std::clamp(level, MIN_TILE_LEVEL, MAX_TILE_LEVEL);
+}
+
+inline float TileWorldSize(int level) {
+    return std::ldexp(static_cast<float>(TILE_SIZE), -level);
+}
+
+inline Box TileBox(const TileKey& key) {
+    float size = TileWorldSize(key.level);
+    return Box{key.x * size, key.y * size, (key.x + 1) * size, (key.y + 1) * size};
+}
+
+// Calls f for every tile of a level that overlaps box
+template <typename F>
+void ForEachTile(const Box& box, int level, F f) {
+    if (box.empty()) return;
+    float size = TileWorldSize(level);
+    int x0 = static_cast<int>(std::floor(box.minX / size)), x1 = static_cast<int>(std::floor(box.maxX / size));
+    int y0 = static_cast<int>(std::floor(box.minY / size)), y1 = static_cast<int>(std::floor(box.maxY / size));
+    for (int y = y0; y <= y1; ++y) {
+        for (int x = x0; x <= x1; ++x) f(TileKey{level, x, y});
+    }
+}
+
+inline long long TileCount(const Box& box, int level) {
+    if (box.empty()) return 0;
+    float size = TileWorldSize(level);
+    long long w = static_cast<long long>(std::floor(box.maxX / size)) - static_cast<long long>(std::floor(box.minX / size)) + 1;
+    long long h = static_cast<long long>(std::floor(box.maxY / size)) - static_cast<long long>(std::floor(box.minY / size)) + 1;
+    return w * h;
+}
+
+// Finished strokes rasterized into fixed-size tiles over an unbounded canvas.
+// Only the tiles the view touches are rendered, each from the strokes the BVH
+// finds inside it, so a frame's cost depends on what is on screen and not on
+// how large the drawing is. Rendered tiles stay cached, least recently used
+// first out once the memory budget is exceeded; edits mark the cached tiles
+// they touch stale and a stale tile is re-rendered the next time it is seen.
+class TiledStrokeLayer {
+public:
+    // overdraw is how far a drawn stroke can reach past its indexed bounds
+    explicit TiledStrokeLayer(float overdraw, size_t memoryBudget = 64 * 1024 * 1024)
+        : overdraw(overdraw), budget(memoryBudget) {}
+
+    void setMemoryBudget(size_t bytes) { budget = bytes; }
+
+    // Marks a canvas region to be re-rendered
+    void invalidate(const Box& box) {
+        if (box.empty()) return;
+        forEachCachedTile(box.padded(overdraw + 1.0f), [](Tile& tile) { tile.stale = true; });
+    }
+
+    void invalidateAll() {
+        for (Tile& tile : tiles) tile.stale = true;
+        pending.clear();
+    }
+
+    // A stroke just finished drawing; visible tiles just get it painted on top
+    void addStroke(uint32_t id) {
+        pending.push_back(id);
+    }
+
+    // A stroke was cut into pieces; if it was still to be painted, they are
+    void replaceStroke(uint32_t id, const std::vector<StrokePtr>& pieces) {
+        auto it = std::find(pending.begin(), pending.end(), id);
+        if (it == pending.end()) return;
+        pending.erase(it);
+        for (const auto& piece : pieces) pending.push_back(piece->id);
+    }
+
+    // Brings the tiles under view up to date. Strokes in hidden (a selection
+    // being dragged) are kept off the tiles.
+    void update(StrokeBatch& batch, const StrokeIndex& index, const std::unordered_set<uint32_t>& hidden,
+                const sf::View& view, sf::Vector2u targetSize) {
+        if (hidden != hiddenIds) {
+            for (uint32_t id : hidden) {
+                if (!hiddenIds.count(id)) invalidate(index.bounds(id));
+            }
+            for (uint32_t id : hiddenIds) {
+                if (!hidden.count(id)) invalidate(index.bounds(id));
+            }
+            hiddenIds = hidden;
+        }
+
+        ++frame;
+        sf::Vector2f center = view.getCenter(), size = view.getSize();
+        // A rotated view would need a larger box; the canvas view is never rotated
+        Box viewBox{center.x - size.x / 2.0f, center.y - size.y / 2.0f, center.x + size.x / 2.0f, center.y + size.y / 2.0f};
+        level = TileLevel(targetSize.x / std::abs(size.x));
+
+        // Newly finished strokes: paint onto visible tiles, other cached tiles go stale
+        visible.clear();
+        ForEachTile(viewBox, level, [&](const TileKey& key) { visible.push_back(key); });
+        for (const TileKey& key : visible) {
+            auto it = lookup.find(key);
+            if (it != lookup.end()) it->second->visibleFrame = frame;
+        }
+        for (uint32_t id : pending) {
+            if (hiddenIds.count(id)) continue;
+            forEachCachedTile(index.bounds(id).padded(overdraw + 1.0f), [&](Tile& tile) {
+                if (tile.visibleFrame == frame) tile.extra.push_back(id);
+                else tile.stale = true;
+            });
+        }
+        pending.clear();
+
+        for (const TileKey& key : visible) {
+            Tile& tile = fetch(key);
+            if (tile.stale) {
+                render(tile, batch, index);
+            } else if (!tile.extra.empty()) {
+                tile.texture->setView(tileView(key));
+                batch.drawStrokes(*tile.texture, tile.extra, 0.5f * TileWorldSize(key.level) / TILE_SIZE);
+                tile.texture->display();
+            }
+            tile.extra.clear();
+        }
+        evict();
+    }
+
+    // Draws the visible tiles; the target's view must be the one passed to update
+    void draw(sf::RenderTarget& target) const {
+        float scale = TileWorldSize(level) / TILE_SIZE;
+        for (const TileKey& key : visible) {
+            auto it = lookup.find(key);
+            if (it == lookup.end()) continue;
+            sf::Sprite sprite(it->second->texture->getTexture());
+            Box box = TileBox(key);
+            sprite.setPosition(sf::Vector2f(box.minX, box.minY));
+            sprite.setScale(sf::Vector2f(scale, scale));
+            target.draw(sprite);
+        }
+    }
+
+    size_t tileCount() const { return tiles.size(); }
+    size_t memoryUsage() const { return (tiles.size() + spare.size()) * TILE_BYTES; }
+    size_t visibleTiles() const { return visible.size(); }
+    // Tiles rendered from the stroke model and evicted so far
+    size_t tileRenders() const { return renders; }
+    size_t evictions() const { return evicted; }
+
+private:
+    struct Tile {
+        TileKey key;
+        std::unique_ptr<sf::RenderTexture> texture;
+        bool stale = true;
+        uint64_t visibleFrame = 0;
+        std::vector<uint32_t> extra; // finished strokes to paint over it
+    };
+    using TileList = std::list<Tile>;
+
+    // Cached tiles overlapping box, at every level that has any
+    template <typename F>
+    void forEachCachedTile(const Box& box, F f) {
+        for (const auto& [tileLevel, count] : levels) {
+            if (TileCount(box, tileLevel) > static_cast<long long>(count)) {
+                // Fewer cached tiles than tiles in the box: scan the cache instead
+                for (Tile& tile : tiles) {
+                    if (tile.key.level == tileLevel && TileBox(tile.key).intersects(box)) f(tile);
+                }
+            } else {
+                ForEachTile(box, tileLevel, [&](const TileKey& key) {
+                    auto it = lookup.find(key);
+                    if (it != lookup.end()) f(*it->second);
+                });
+            }
+        }
+    }
+
+    // The cached tile for key, made most recently used; created stale if missing
+    Tile& fetch(const TileKey& key) {
+        auto it = lookup.find(key);
+        if (it != lookup.end()) {
+            tiles.splice(tiles.begin(), tiles, it->second);
+            it->second->visibleFrame = frame;
+            return *it->second;
+        }
+        Tile tile;
+        tile.key = key;
+        tile.visibleFrame = frame;
+        if (!spare.empty()) {
+            tile.texture = std::move(spare.back());
+            spare.pop_back();
+        } else {
+            tile.texture = std::make_unique<sf::RenderTexture>();
+            if (!tile.texture->resize(sf::Vector2u(TILE_SIZE, TILE_SIZE))) std::cout << "Could not create a canvas tile" << std::endl;
+        }
+        tiles.push_front(std::move(tile));
+        lookup[key] = tiles.begin();
+        ++levels[key.level];
+        return tiles.front();
+    }
+
+    sf::View tileView(const TileKey& key) const {
+        Box box = TileBox(key);
+        return sf::View(sf::FloatRect({box.minX, box.minY}, {box.maxX - box.minX, box.maxY - box.minY}));
+    }
+
+    void render(Tile& tile, StrokeBatch& batch, const StrokeIndex& index) {
+        sf::RenderTexture& texture = *tile.texture;
+        texture.setView(tileView(tile.key));
+        texture.clear(sf::Color::Transparent);
+        std::vector<uint32_t> ids = index.queryBox(TileBox(tile.key).padded(overdraw));
+        ids.erase(std::remove_if(ids.begin(), ids.end(), [&](uint32_t id) { return hiddenIds.count(id) > 0; }), ids.end());
+        // Half a pixel of simplification is invisible at the tile's resolution
+        batch.drawStrokes(texture, ids, 0.5f * TileWorldSize(tile.key.level) / TILE_SIZE);
+        texture.display();
+        tile.stale = false;
+        ++renders;
+    }
+
+    // Drops least recently used tiles over the budget; tiles on screen stay.
+    // A few textures are kept for reuse so panning doesn't reallocate.
+    void evict() {
+        while (tiles.size() * TILE_BYTES > budget && !tiles.empty() && tiles.back().visibleFrame != frame) {
+            Tile& tile = tiles.back();
+            if (--levels[tile.key.level] == 0) levels.erase(tile.key.level);
+            lookup.erase(tile.key);
+            if (spare.size() < visible.size()) spare.push_back(std::move(tile.texture));
+            tiles.pop_back();
+            ++evicted;
+        }
+    }
+
+    float overdraw;
+    size_t budget;
+    int level = 0;
+    uint64_t frame = 0;
+    TileList tiles; // most recently used first
+    std::unordered_map<TileKey, TileList::iterator, TileKeyHash> lookup;
+    std::map<int, size_t> levels; // cached tiles per zoom level
+    std::vector<std::unique_ptr<sf::RenderTexture>> spare;
+    std::vector<TileKey> visible;
+    std::vector<uint32_t> pending;
+    std::unordered_set<uint32_t> hiddenIds;
+    size_t renders = 0;
+    size_t evicted = 0;
+};
+
+#endif // TILE_CACHE_H